@@ -0,0 +1,293 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../ExpressionParser/src/iterative_parser.h"
+#include "../ExpressionParser/src/lexer.h"
+#include "../ExpressionParser/src/rd_parser.h"
+
+#define BENCHMARK_DEFAULT_MIN_TIME 0.25
+
+/*
+ * Workload
+ *
+ * A generated expression exercising one shape of input
+ */
+struct Workload
+{
+  const char *name;
+  std::string expression;
+};
+
+/*
+ * Measurement
+ *
+ * The outcome of timing one stage on one workload
+ */
+struct Measurement
+{
+  size_t iterations;
+  double seconds;
+};
+
+/* Written by every timed loop so that the work cannot be optimised away */
+static volatile long long benchmark_sink = 0;
+
+/*
+ * Deep Nesting
+ *
+ * @param depth Number of nested parentheses
+ * @return "((( ... 1 + 1 ... )))"
+ */
+static std::string deepNesting(size_t depth)
+{
+  return std::string(depth, '(') + "1 + 1" + std::string(depth, ')');
+}
+
+/*
+ * Flat Chain
+ *
+ * @param terms Number of operands
+ * @return A long chain of single-digit operands joined by every operator, e.g. "1 + 2 - 3 * 4 / 5 ..."
+ */
+static std::string flatChain(size_t terms)
+{
+  const char operators[] = {'+', '-', '*', '/'};
+  std::string expression = "1";
+  for (size_t term = 1; term < terms; term++)
+  {
+    expression += ' ';
+    expression += operators[term % 4];
+    expression += ' ';
+    expression += static_cast<char>('1' + term % 9);
+  }
+  return expression;
+}
+
+/*
+ * Many Literals
+ *
+ * @param count Number of operands
+ * @return A sum of multi-digit literals, so that the time goes into scanning and converting digits
+ */
+static std::string manyLiterals(size_t count)
+{
+  std::string expression = "123456789";
+  for (size_t literal = 1; literal < count; literal++)
+  {
+    expression += literal % 2 == 0 ? " + " : " - ";
+    expression += std::to_string(100000000 + (literal * 7919) % 900000000);
+  }
+  return expression;
+}
+
+/*
+ * Unary Heavy
+ *
+ * @param terms Number of operands
+ * @param negations Number of negations applied to each operand
+ * @return operands each preceded by a run of negations, e.g. "----1 + ----2 ..."
+ */
+static std::string unaryHeavy(size_t terms, size_t negations)
+{
+  std::string expression;
+  for (size_t term = 0; term < terms; term++)
+  {
+    expression += term == 0 ? "" : " + ";
+    expression += std::string(negations, '-');
+    expression += static_cast<char>('1' + term % 9);
+  }
+  return expression;
+}
+
+/*
+ * Measure
+ *
+ * Runs an operation repeatedly, doubling the batch size until a batch takes at least the minimum time
+ *
+ * @param operation The work to time; returns a value which is folded into the sink
+ * @param min_time Seconds the measured batch must last
+ * @return Iterations and duration of the measured batch
+ */
+static Measurement measure(const std::function<long long()> &operation, double min_time)
+{
+  /* Warm caches and the parser's per-thread context */
+  benchmark_sink = benchmark_sink + operation();
+
+  for (size_t iterations = 1;; iterations *= 2)
+  {
+    long long checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t iteration = 0; iteration < iterations; iteration++)
+    {
+      checksum += operation();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    benchmark_sink = benchmark_sink + checksum;
+
+    if (elapsed.count() >= min_time)
+    {
+      return Measurement{.iterations = iterations, .seconds = elapsed.count()};
+    }
+  }
+}
+
+/*
+ * Report
+ *
+ * Writes one measurement as a line of JSON
+ *
+ * @param stage The stage measured
+ * @param workload The workload it was measured on
+ * @param unit What the rate counts
+ * @param units_per_iteration Units processed by each iteration
+ * @param measurement The timing
+ */
+static void report(const char *stage, const Workload &workload, const char *unit, size_t units_per_iteration,
+                   const Measurement &measurement)
+{
+  const double per_second =
+      static_cast<double>(units_per_iteration) * static_cast<double>(measurement.iterations) / measurement.seconds;
+  std::printf("{\"stage\":\"%s\",\"workload\":\"%s\",\"bytes\":%zu,\"iterations\":%zu,\"seconds\":%.6f,"
+              "\"unit\":\"%s\",\"per_iteration\":%zu,\"per_second\":%.1f,\"ns_per_iteration\":%.1f}\n",
+              stage, workload.name, workload.expression.size(), measurement.iterations, measurement.seconds, unit,
+              units_per_iteration, per_second, measurement.seconds * 1e9 / static_cast<double>(measurement.iterations));
+  std::fflush(stdout);
+}
+
+/*
+ * Main
+ *
+ * Usage: Benchmarks [--filter <text>] [--min-time <seconds>]
+ *
+ * For each workload, times lexing (tokens/s), parsing with each parser and tokenising mode (nodes/s) and evaluating
+ * the compiled expression with the interpreter and, where supported, as native code (evaluations/s). Only stages
+ * whose "stage/workload" name contains the filter text are run.
+ */
+int main(int argc, char **argv)
+{
+  const char *filter = "";
+  double min_time = BENCHMARK_DEFAULT_MIN_TIME;
+  for (int arg = 1; arg < argc; arg++)
+  {
+    if (std::strcmp(argv[arg], "--filter") == 0 && arg + 1 < argc)
+    {
+      filter = argv[++arg];
+    }
+    else if (std::strcmp(argv[arg], "--min-time") == 0 && arg + 1 < argc)
+    {
+      min_time = std::atof(argv[++arg]);
+    }
+    else
+    {
+      std::fprintf(stderr, "Usage: %s [--filter <text>] [--min-time <seconds>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const std::vector<Workload> workloads = {
+      {"small", "5 + 6 * (7 - 3) / -2"},
+      {"deep_nesting", deepNesting(500)},
+      {"flat_chain", flatChain(2000)},
+      {"many_literals", manyLiterals(1000)},
+      {"unary_heavy", unaryHeavy(200, 16)},
+  };
+
+  /* Optimisation is disabled so that parse and evaluation times reflect the whole tree */
+  AstOptimiser::Options unoptimised;
+  unoptimised.fold_constants = false;
+  unoptimised.simplify_identities = false;
+  const RDParser recursive_parser(unoptimised);
+  RDParser::Options tokenising_options;
+  tokenising_options.optimiser_options = unoptimised;
+  tokenising_options.tokenise_first = true;
+  const RDParser tokenising_parser(tokenising_options);
+  IterativeParser::Options iterative_options;
+  iterative_options.optimiser_options = unoptimised;
+  const IterativeParser iterative_parser(iterative_options);
+
+  auto selected = [filter](const char *stage, const Workload &workload)
+  { return std::strstr((std::string(stage) + "/" + workload.name).c_str(), filter) != nullptr; };
+
+  for (const Workload &workload : workloads)
+  {
+    const std::string &expression = workload.expression;
+
+    Lexer lexer;
+    lexer.Tokenise(expression);
+    const size_t token_count = lexer.getTokenCount();
+
+    const CompiledExpression compiled = recursive_parser.Compile(expression);
+    const size_t node_count = compiled.getNodeCount();
+
+    if (selected("lex", workload))
+    {
+      Measurement measurement = measure(
+          [&]
+          {
+            ExpressionParserErrors::ErrorInfo error;
+            lexer.clearTokens();
+            lexer.TryTokenise(expression, false, error);
+            return static_cast<long long>(lexer.getTokenCount());
+          },
+          min_time);
+      report("lex", workload, "tokens", token_count, measurement);
+    }
+
+    if (selected("parse_recursive", workload))
+    {
+      Measurement measurement = measure(
+          [&] { return static_cast<long long>(recursive_parser.TryCompile(expression).getValue().getNodeCount()); },
+          min_time);
+      report("parse_recursive", workload, "nodes", node_count, measurement);
+    }
+
+    if (selected("parse_tokenise_first", workload))
+    {
+      Measurement measurement = measure(
+          [&] { return static_cast<long long>(tokenising_parser.TryCompile(expression).getValue().getNodeCount()); },
+          min_time);
+      report("parse_tokenise_first", workload, "nodes", node_count, measurement);
+    }
+
+    if (selected("parse_iterative", workload))
+    {
+      Measurement measurement = measure(
+          [&] { return static_cast<long long>(iterative_parser.TryCompile(expression).getValue().getNodeCount()); },
+          min_time);
+      report("parse_iterative", workload, "nodes", node_count, measurement);
+    }
+
+    if (selected("parse_and_evaluate", workload))
+    {
+      Measurement measurement = measure(
+          [&] { return static_cast<long long>(recursive_parser.TryParse(expression).getValue()); }, min_time);
+      report("parse_and_evaluate", workload, "nodes", node_count, measurement);
+    }
+
+    if (selected("evaluate_interpreted", workload))
+    {
+      Measurement measurement =
+          measure([&] { return static_cast<long long>(compiled.TryEvaluate().getValue()); }, min_time);
+      report("evaluate_interpreted", workload, "evaluations", 1, measurement);
+    }
+
+    const CompiledExpression native = recursive_parser.Compile(expression);
+    if (selected("evaluate_native", workload) && native.CompileNative())
+    {
+      Measurement measurement =
+          measure([&] { return static_cast<long long>(native.TryEvaluate().getValue()); }, min_time);
+      report("evaluate_native", workload, "evaluations", 1, measurement);
+    }
+  }
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+/*
+ * Arena Constructor
+ *
+ * No memory is requested until the first allocation.
+ *
+ * @param block_size Minimum size in bytes of each block requested from the heap
+ */
+Arena::Arena(size_t block_size) : block_size(block_size), current_block(0), offset(0) {}
+
+/*
+ * Allocate
+ *
+ * Bumps the offset within the current block, moving on to the next retained block (or requesting a new one) when
+ * the current block cannot satisfy the request.
+ *
+ * @param size Number of bytes required
+ * @param alignment Required alignment of the returned address, a power of two
+ * @return Pointer to uninitialised memory, valid until the next Reset
+ */
+void *Arena::Allocate(size_t size, size_t alignment)
+{
+  while (current_block < blocks.size())
+  {
+    Block &block = blocks[current_block];
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+    const size_t aligned_offset = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+    if (aligned_offset + size <= block.size)
+    {
+      offset = aligned_offset + size;
+      return block.memory.get() + aligned_offset;
+    }
+
+    current_block++;
+    offset = 0;
+  }
+
+  /* No retained block has room left; oversized requests receive a block of their own */
+  const size_t new_block_size = std::max(block_size, size + alignment);
+  blocks.push_back(Block{.memory = std::unique_ptr<std::byte[]>(new std::byte[new_block_size]), .size = new_block_size});
+  current_block = blocks.size() - 1;
+  offset = 0;
+
+  return Allocate(size, alignment);
+}
+
+/*
+ * Reset
+ *
+ * Releases every allocation in O(1). Blocks are retained for reuse by subsequent allocations.
+ */
+void Arena::Reset()
+{
+  current_block = 0;
+  offset = 0;
+}
+
+/*
+ * Get Capacity
+ *
+ * @return Total size in bytes of the blocks owned by the arena
+ */
+size_t Arena::getCapacity() const
+{
+  size_t capacity = 0;
+  for (const Block &block : blocks)
+  {
+    capacity += block.size;
+  }
+  return capacity;
+}
\ No newline at end of file
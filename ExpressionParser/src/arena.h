@@ -0,0 +1,89 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define ARENA_DEFAULT_BLOCK_SIZE 16384
+
+/*
+ * Arena
+ *
+ * A bump allocator handing out memory from a list of contiguous blocks. Individual allocations are never freed;
+ * instead the whole arena is reset at once. Blocks are kept across resets so that, once the arena has grown to fit
+ * the largest workload, further allocations never touch the heap.
+ */
+class Arena
+{
+public:
+  Arena(size_t block_size = ARENA_DEFAULT_BLOCK_SIZE);
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *Allocate(size_t size, size_t alignment);
+
+  void Reset();
+
+  size_t getCapacity() const;
+
+  /*
+   * Create
+   *
+   * Constructs an object in arena memory. Destructors are never run, so only trivially destructible types may be
+   * created.
+   *
+   * @param args Arguments forwarded to the constructor of T
+   * @return Pointer to the newly constructed object, valid until the next Reset
+   */
+  template <typename T, typename... Args> T *Create(Args &&...args)
+  {
+    static_assert(std::is_trivially_destructible_v<T>, "Arena objects are released without running destructors");
+    return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  /*
+   * Allocate Array
+   *
+   * Reserves uninitialised room for an array of trivially destructible elements.
+   *
+   * @param count Number of elements in the array
+   * @return Pointer to the first element, valid until the next Reset
+   */
+  template <typename T> T *AllocateArray(size_t count)
+  {
+    static_assert(std::is_trivially_destructible_v<T>, "Arena objects are released without running destructors");
+    return static_cast<T *>(Allocate(count * sizeof(T), alignof(T)));
+  }
+
+private:
+  /*
+   * Arena Block
+   *
+   * A single contiguous region of arena memory
+   */
+  struct Block
+  {
+    std::unique_ptr<std::byte[]> memory;
+    size_t size;
+  };
+
+  /* Minimum size of each block requested from the heap */
+  size_t block_size;
+
+  /* All blocks owned by the arena, in the order they are filled */
+  std::vector<Block> blocks;
+
+  /* Index of the block currently being allocated from */
+  size_t current_block;
+
+  /* Offset of the next free byte within the current block */
+  size_t offset;
+};
@@ -0,0 +1,143 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+/*
+ * Arithmetic
+ *
+ * The operations of an expression on one value type. Each operation stores its result and returns false if the
+ * result cannot be represented by the type. Unchecked arithmetic always succeeds and wraps modulo 2^N: it is performed
+ * on the unsigned type of the same width, which compiles to the same machine instruction as the signed operation but
+ * has no undefined behaviour on overflow. Checked arithmetic uses the compiler's overflow builtins where they exist
+ * and the equivalent comparisons elsewhere.
+ *
+ * Division by zero is not an overflow and is tested by the caller before Divide is used.
+ */
+template <typename T, bool Checked> class Arithmetic
+{
+  static_assert(std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t>, "Arithmetic:: Unsupported value type");
+
+public:
+  using Limits = std::numeric_limits<T>;
+  using Unsigned = std::make_unsigned_t<T>;
+
+  /*
+   * Negate
+   *
+   * @param result Receives -operand
+   * @return False if the result is not representable
+   */
+  static constexpr bool Negate(T operand, T &result)
+  {
+    if constexpr (Checked)
+    {
+      if (operand == Limits::min())
+      {
+        return false;
+      }
+    }
+
+    result = static_cast<T>(Unsigned{0} - static_cast<Unsigned>(operand));
+    return true;
+  }
+
+  /*
+   * Add
+   *
+   * @param result Receives lhs + rhs
+   * @return False if the result is not representable
+   */
+  static constexpr bool Add(T lhs, T rhs, T &result)
+  {
+    if constexpr (Checked)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return !__builtin_add_overflow(lhs, rhs, &result);
+#else
+      if (rhs > 0 ? lhs > Limits::max() - rhs : lhs < Limits::min() - rhs)
+      {
+        return false;
+      }
+#endif
+    }
+
+    result = static_cast<T>(static_cast<Unsigned>(lhs) + static_cast<Unsigned>(rhs));
+    return true;
+  }
+
+  /*
+   * Subtract
+   *
+   * @param result Receives lhs - rhs
+   * @return False if the result is not representable
+   */
+  static constexpr bool Subtract(T lhs, T rhs, T &result)
+  {
+    if constexpr (Checked)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return !__builtin_sub_overflow(lhs, rhs, &result);
+#else
+      if (rhs < 0 ? lhs > Limits::max() + rhs : lhs < Limits::min() + rhs)
+      {
+        return false;
+      }
+#endif
+    }
+
+    result = static_cast<T>(static_cast<Unsigned>(lhs) - static_cast<Unsigned>(rhs));
+    return true;
+  }
+
+  /*
+   * Multiply
+   *
+   * @param result Receives lhs * rhs
+   * @return False if the result is not representable
+   */
+  static constexpr bool Multiply(T lhs, T rhs, T &result)
+  {
+    if constexpr (Checked)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return !__builtin_mul_overflow(lhs, rhs, &result);
+#else
+      const bool overflows = lhs > 0 ? (rhs > 0 ? lhs > Limits::max() / rhs : rhs < Limits::min() / lhs)
+                                     : (rhs > 0 ? lhs < Limits::min() / rhs : lhs != 0 && rhs < Limits::max() / lhs);
+      if (overflows)
+      {
+        return false;
+      }
+#endif
+    }
+
+    result = static_cast<T>(static_cast<Unsigned>(lhs) * static_cast<Unsigned>(rhs));
+    return true;
+  }
+
+  /*
+   * Divide
+   *
+   * @param result Receives lhs / rhs; rhs must not be zero
+   * @return False if the result is not representable
+   */
+  static constexpr bool Divide(T lhs, T rhs, T &result)
+  {
+    if (rhs == -1)
+    {
+      /* The only quotient which does not fit is the most negative value divided by -1. Dividing by -1 negates, so
+         unchecked arithmetic wraps to the dividend as Negate does instead of trapping in the machine's divide
+         instruction. */
+      return Negate(lhs, result);
+    }
+
+    result = lhs / rhs;
+    return true;
+  }
+};
\ No newline at end of file
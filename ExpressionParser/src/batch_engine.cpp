@@ -0,0 +1,302 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "batch_engine.h"
+#include "errors.h"
+
+#include <algorithm>
+#include <limits>
+
+/*
+ * Batch Engine Constructor
+ *
+ * Starts the pool's threads, which sleep until the first call to Run
+ *
+ * @param thread_count Number of threads evaluating chunks, including the caller of Run. Zero uses one per core.
+ * @param chunk_rows Number of rows in each chunk
+ */
+BatchEngine::BatchEngine(size_t thread_count, size_t chunk_rows)
+    : chunk_rows(std::max<size_t>(chunk_rows, 1)), generation(0), active_threads(0), stopping(false), error_count(0)
+{
+  if (thread_count == 0)
+  {
+    thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  for (size_t worker = 0; worker < thread_count; worker++)
+  {
+    workers.push_back(std::make_unique<Worker>());
+  }
+
+  for (size_t worker = 1; worker < thread_count; worker++)
+  {
+    threads.emplace_back(&BatchEngine::workerLoop, this, worker);
+  }
+}
+
+/*
+ * Batch Engine Destructor
+ *
+ * Stops and joins the pool's threads
+ */
+BatchEngine::~BatchEngine()
+{
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+
+  for (std::thread &thread : threads)
+  {
+    thread.join();
+  }
+}
+
+/*
+ * Run
+ *
+ * Evaluates every job, returning once all of their results have been written. The calling thread evaluates chunks
+ * alongside the pool. Calls from several threads are serialised.
+ *
+ * @param jobs The expressions and columns to evaluate
+ * @return Total number of rows flagged in the jobs' error masks
+ */
+size_t BatchEngine::Run(std::span<const Job> jobs)
+{
+  std::lock_guard<std::mutex> run_lock(run_mutex);
+
+  /* Report missing columns before any work is handed out, so that chunks cannot fail part way through */
+  job_first_chunk.clear();
+  uint64_t chunk_count = 0;
+  for (const Job &job : jobs)
+  {
+    if (job.columns.size() < job.expression->getVariableCount())
+    {
+      throw ExpressionParserErrors::UnboundVariableException(job.expression->getVariableName(job.columns.size()));
+    }
+
+    job_first_chunk.push_back(static_cast<uint32_t>(chunk_count));
+    chunk_count += getChunkCount(job.row_count);
+  }
+
+  if (chunk_count == 0)
+  {
+    return 0;
+  }
+
+  if (chunk_count > std::numeric_limits<uint32_t>::max())
+  {
+    throw std::length_error("BatchEngine:: Too many chunks in one run");
+  }
+
+  /* Deal out contiguous runs of chunks so that each worker starts on neighbouring rows */
+  const uint64_t worker_count = workers.size();
+  for (uint64_t worker = 0; worker < worker_count; worker++)
+  {
+    workers[worker]->range.store(packRange(static_cast<uint32_t>(chunk_count * worker / worker_count),
+                                           static_cast<uint32_t>(chunk_count * (worker + 1) / worker_count)),
+                                 std::memory_order_relaxed);
+  }
+
+  current_jobs = jobs;
+  error_count.store(0, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    generation++;
+    active_threads = threads.size();
+  }
+  wake.notify_all();
+
+  work(0);
+
+  std::unique_lock<std::mutex> lock(state_mutex);
+  finished.wait(lock, [this] { return active_threads == 0; });
+
+  return error_count.load(std::memory_order_relaxed);
+}
+
+/*
+ * Get Thread Count
+ *
+ * @return Number of threads evaluating chunks, including the caller of Run
+ */
+size_t BatchEngine::getThreadCount() const
+{
+  return workers.size();
+}
+
+/*
+ * Get Chunk Count
+ *
+ * @param row_count Number of rows in a job
+ * @return Number of chunks the job is split into, and so the size of its chunk_errors array
+ */
+size_t BatchEngine::getChunkCount(size_t row_count) const
+{
+  return (row_count + chunk_rows - 1) / chunk_rows;
+}
+
+/*
+ * Worker Loop
+ *
+ * Body of each of the pool's threads: wait for a run, take part in it and report back
+ *
+ * @param worker Index of the thread's worker
+ */
+void BatchEngine::workerLoop(size_t worker)
+{
+  uint64_t seen_generation = 0;
+
+  std::unique_lock<std::mutex> lock(state_mutex);
+  for (;;)
+  {
+    wake.wait(lock, [this, seen_generation] { return stopping || generation != seen_generation; });
+    if (stopping)
+    {
+      return;
+    }
+    seen_generation = generation;
+
+    lock.unlock();
+    work(worker);
+    lock.lock();
+
+    if (--active_threads == 0)
+    {
+      finished.notify_one();
+    }
+  }
+}
+
+/*
+ * Work
+ *
+ * Evaluates the worker's own chunks, then steals from the others until no chunks are left anywhere
+ *
+ * @param worker Index of the worker
+ */
+void BatchEngine::work(size_t worker)
+{
+  uint32_t chunk;
+  do
+  {
+    while (popChunk(worker, chunk))
+    {
+      evaluateChunk(worker, chunk);
+    }
+  } while (steal(worker));
+}
+
+/*
+ * Pop Chunk
+ *
+ * Takes the first chunk of a worker's range
+ *
+ * @param worker Index of the worker
+ * @param chunk Receives the index of the chunk taken
+ * @return True if a chunk was taken, false if the range is empty
+ */
+bool BatchEngine::popChunk(size_t worker, uint32_t &chunk)
+{
+  std::atomic<uint64_t> &range = workers[worker]->range;
+  uint64_t current = range.load(std::memory_order_acquire);
+  for (;;)
+  {
+    const uint32_t begin = static_cast<uint32_t>(current >> 32);
+    const uint32_t end = static_cast<uint32_t>(current);
+    if (begin >= end)
+    {
+      return false;
+    }
+
+    if (range.compare_exchange_weak(current, packRange(begin + 1, end), std::memory_order_acq_rel))
+    {
+      chunk = begin;
+      return true;
+    }
+  }
+}
+
+/*
+ * Steal
+ *
+ * Moves the back half of another worker's remaining chunks into the thief's (empty) range. Nobody else modifies an
+ * empty range, so the thief can store its new range directly once the victim's has been shortened.
+ *
+ * @param thief Index of the worker that has run out of chunks
+ * @return True if chunks were stolen, false if every worker's range is empty
+ */
+bool BatchEngine::steal(size_t thief)
+{
+  for (size_t offset = 1; offset < workers.size(); offset++)
+  {
+    std::atomic<uint64_t> &victim = workers[(thief + offset) % workers.size()]->range;
+    uint64_t current = victim.load(std::memory_order_acquire);
+    for (;;)
+    {
+      const uint32_t begin = static_cast<uint32_t>(current >> 32);
+      const uint32_t end = static_cast<uint32_t>(current);
+      if (begin >= end)
+      {
+        break;
+      }
+
+      const uint32_t split = end - (end - begin + 1) / 2;
+      if (victim.compare_exchange_weak(current, packRange(begin, split), std::memory_order_acq_rel))
+      {
+        workers[thief]->range.store(packRange(split, end), std::memory_order_release);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/*
+ * Evaluate Chunk
+ *
+ * Evaluates one chunk of rows of one job into the job's buffers
+ *
+ * @param worker Index of the worker evaluating the chunk
+ * @param chunk Index of the chunk within the current run
+ */
+void BatchEngine::evaluateChunk(size_t worker, uint32_t chunk)
+{
+  const size_t job_idx = std::upper_bound(job_first_chunk.begin(), job_first_chunk.end(), chunk) -
+                         job_first_chunk.begin() - 1;
+  const Job &job = current_jobs[job_idx];
+  const size_t job_chunk = chunk - job_first_chunk[job_idx];
+  const size_t first_row = job_chunk * chunk_rows;
+  const size_t row_count = std::min(chunk_rows, job.row_count - first_row);
+
+  std::vector<const int *> &columns = workers[worker]->columns;
+  columns.resize(job.columns.size());
+  for (size_t slot = 0; slot < job.columns.size(); slot++)
+  {
+    columns[slot] = job.columns[slot] + first_row;
+  }
+
+  const size_t errors = job.expression->EvaluateBatch(columns, row_count, job.results + first_row,
+                                                      job.error_mask + first_row);
+  if (job.chunk_errors != nullptr)
+  {
+    job.chunk_errors[job_chunk] = errors;
+  }
+  error_count.fetch_add(errors, std::memory_order_relaxed);
+}
+
+/*
+ * Pack Range
+ *
+ * @param begin First chunk of the range
+ * @param end One past the last chunk of the range
+ * @return The range as stored in Worker::range
+ */
+uint64_t BatchEngine::packRange(uint32_t begin, uint32_t end)
+{
+  return (static_cast<uint64_t>(begin) << 32) | end;
+}
\ No newline at end of file
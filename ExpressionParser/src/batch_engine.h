@@ -0,0 +1,133 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "compiled_expression.h"
+
+#define BATCH_ENGINE_CHUNK_ROWS 8192
+
+/*
+ * Batch Engine
+ *
+ * Evaluates compiled expressions over large column sets on a pool of worker threads. Every job (one expression over
+ * one set of columns) is split into chunks of rows small enough for their columns and results to stay in cache.
+ * The chunks of all jobs in a run are dealt out evenly between the workers up front; a worker that finishes its
+ * share steals half of the remaining chunks of another, so uneven expressions or rows still keep every core busy.
+ *
+ * Results and error masks are written straight into the caller's buffers. Rows that divide by zero are flagged in
+ * the error mask (see CompiledExpression::EvaluateBatch) and counted per chunk; they never abort the run.
+ */
+class BatchEngine
+{
+public:
+  /*
+   * Job
+   *
+   * One expression evaluated over one set of input columns
+   */
+  struct Job
+  {
+    /* The expression to evaluate; it must outlive the call to Run */
+    const CompiledExpression *expression;
+
+    /* One pointer per variable slot to an array of row_count values */
+    std::span<const int *const> columns;
+
+    /* Number of rows to evaluate */
+    size_t row_count;
+
+    /* Receives row_count results */
+    int *results;
+
+    /* Receives row_count flags; non-zero marks a row whose result is undefined (and set to 0) */
+    uint8_t *error_mask;
+
+    /* Optional. Receives the number of flagged rows of each chunk (see getChunkCount), so that callers can skip the
+       masks of chunks without errors */
+    size_t *chunk_errors;
+  };
+
+  explicit BatchEngine(size_t thread_count = 0, size_t chunk_rows = BATCH_ENGINE_CHUNK_ROWS);
+
+  BatchEngine(const BatchEngine &) = delete;
+  BatchEngine &operator=(const BatchEngine &) = delete;
+
+  ~BatchEngine();
+
+  size_t Run(std::span<const Job> jobs);
+
+  size_t getThreadCount() const;
+
+  size_t getChunkCount(size_t row_count) const;
+
+private:
+  /*
+   * Worker
+   *
+   * The chunks a worker has yet to evaluate, as a half-open range of chunk indices packed into one word (begin in
+   * the high half) so that the owner and thieves can both update it with a single compare-and-swap. Padded to a
+   * cache line so that updates by one worker do not slow down its neighbours.
+   */
+  struct alignas(64) Worker
+  {
+    std::atomic<uint64_t> range{0};
+
+    /* The current chunk's column pointers, offset to its first row; reused so that chunks do not allocate */
+    std::vector<const int *> columns;
+  };
+
+  void workerLoop(size_t worker);
+
+  void work(size_t worker);
+
+  bool popChunk(size_t worker, uint32_t &chunk);
+
+  bool steal(size_t thief);
+
+  void evaluateChunk(size_t worker, uint32_t chunk);
+
+  static uint64_t packRange(uint32_t begin, uint32_t end);
+
+  /* Number of rows in each chunk */
+  size_t chunk_rows;
+
+  /* Work ranges of every worker; worker 0 is the thread calling Run */
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  /* The pool's threads, running workers 1 onwards */
+  std::vector<std::thread> threads;
+
+  /* Serialises calls to Run */
+  std::mutex run_mutex;
+
+  /* Guards the fields the pool's threads wait on */
+  std::mutex state_mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+
+  /* Incremented by every call to Run to wake the pool */
+  uint64_t generation;
+
+  /* Number of pool threads still working on the current run */
+  size_t active_threads;
+
+  /* True once the engine is being destroyed */
+  bool stopping;
+
+  /* The current run's jobs, the index of each job's first chunk and the total number of flagged rows */
+  std::span<const Job> current_jobs;
+  std::vector<uint32_t> job_first_chunk;
+  std::atomic<size_t> error_count;
+};
\ No newline at end of file
@@ -0,0 +1,378 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "batch_kernels.h"
+#include "arithmetic.h"
+
+#ifdef BATCH_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/* GCC and Clang only emit vector instructions inside functions declared for the target; MSVC never needs this */
+#if defined(BATCH_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE42
+#define TARGET_AVX2
+#endif
+
+namespace
+{
+  /*
+   * Scalar Kernels
+   *
+   * Plain loops; used on CPUs without vector support and for the tail of every vector kernel.
+   */
+  void addScalar(const int *left, const int *right, int *out, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      Arithmetic<int32_t, false>::Add(left[i], right[i], out[i]);
+    }
+  }
+
+  void subtractScalar(const int *left, const int *right, int *out, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      Arithmetic<int32_t, false>::Subtract(left[i], right[i], out[i]);
+    }
+  }
+
+  void multiplyScalar(const int *left, const int *right, int *out, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      Arithmetic<int32_t, false>::Multiply(left[i], right[i], out[i]);
+    }
+  }
+
+  void divideScalar(const int *left, const int *right, int *out, uint8_t *error_mask, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      /* Undefined result encountered; flag the row and carry on with a harmless divisor */
+      const bool divide_by_zero = right[i] == 0;
+      error_mask[i] |= divide_by_zero;
+      int quotient = 0;
+      if (!divide_by_zero)
+      {
+        Arithmetic<int32_t, false>::Divide(left[i], right[i], quotient);
+      }
+      out[i] = quotient;
+    }
+  }
+
+  void negateScalar(const int *in, int *out, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      Arithmetic<int32_t, false>::Negate(in[i], out[i]);
+    }
+  }
+
+#ifdef BATCH_KERNELS_X86
+  /*
+   * Flag Zero Lanes
+   *
+   * Expands a movemask of zero-divisor lanes into the per-row error mask. Only reached when a block contains errors.
+   */
+  inline void flagZeroLanes(int zero_lanes, uint8_t *error_mask, size_t lane_count)
+  {
+    for (size_t lane = 0; lane < lane_count; lane++)
+    {
+      error_mask[lane] |= (zero_lanes >> lane) & 1;
+    }
+  }
+
+  /*
+   * SSE4.2 Kernels
+   *
+   * Four lanes per instruction. Integer division has no vector form at this width, so the divide kernel only
+   * vectorises the zero-divisor check and substitution.
+   */
+  TARGET_SSE42 void addSSE42(const int *left, const int *right, int *out, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_add_epi32(a, b));
+    }
+    addScalar(left + i, right + i, out + i, count - i);
+  }
+
+  TARGET_SSE42 void subtractSSE42(const int *left, const int *right, int *out, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_sub_epi32(a, b));
+    }
+    subtractScalar(left + i, right + i, out + i, count - i);
+  }
+
+  TARGET_SSE42 void multiplySSE42(const int *left, const int *right, int *out, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_mullo_epi32(a, b));
+    }
+    multiplyScalar(left + i, right + i, out + i, count - i);
+  }
+
+  TARGET_SSE42 void divideSSE42(const int *left, const int *right, int *out, uint8_t *error_mask, size_t count)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + i));
+      __m128i is_zero = _mm_cmpeq_epi32(b, zero);
+      int zero_lanes = _mm_movemask_ps(_mm_castsi128_ps(is_zero));
+
+      alignas(16) int divisors[4];
+      _mm_store_si128(reinterpret_cast<__m128i *>(divisors), _mm_blendv_epi8(b, one, is_zero));
+      for (size_t lane = 0; lane < 4; lane++)
+      {
+        Arithmetic<int32_t, false>::Divide(left[i + lane], divisors[lane], out[i + lane]);
+      }
+
+      if (zero_lanes)
+      {
+        flagZeroLanes(zero_lanes, error_mask + i, 4);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                         _mm_andnot_si128(is_zero, _mm_loadu_si128(reinterpret_cast<const __m128i *>(out + i))));
+      }
+    }
+    divideScalar(left + i, right + i, out + i, error_mask + i, count - i);
+  }
+
+  TARGET_SSE42 void negateSSE42(const int *in, int *out, size_t count)
+  {
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_sub_epi32(zero, a));
+    }
+    negateScalar(in + i, out + i, count - i);
+  }
+
+  /*
+   * AVX2 Kernels
+   *
+   * Eight lanes per instruction. Division converts to double precision, where every 32-bit quotient is represented
+   * exactly, and truncates back; this matches integer division (including INT_MIN / -1, which wraps to INT_MIN).
+   */
+  TARGET_AVX2 void addAVX2(const int *left, const int *right, int *out, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(left + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(right + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_add_epi32(a, b));
+    }
+    addScalar(left + i, right + i, out + i, count - i);
+  }
+
+  TARGET_AVX2 void subtractAVX2(const int *left, const int *right, int *out, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(left + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(right + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_sub_epi32(a, b));
+    }
+    subtractScalar(left + i, right + i, out + i, count - i);
+  }
+
+  TARGET_AVX2 void multiplyAVX2(const int *left, const int *right, int *out, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(left + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(right + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_mullo_epi32(a, b));
+    }
+    multiplyScalar(left + i, right + i, out + i, count - i);
+  }
+
+  TARGET_AVX2 void divideAVX2(const int *left, const int *right, int *out, uint8_t *error_mask, size_t count)
+  {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(left + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(right + i));
+      __m256i is_zero = _mm256_cmpeq_epi32(b, zero);
+      b = _mm256_blendv_epi8(b, one, is_zero);
+
+      __m128i low = _mm256_cvttpd_epi32(
+        _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(b))));
+      __m128i high = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)),
+                                                       _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1))));
+      __m256i quotient = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+
+      int zero_lanes = _mm256_movemask_ps(_mm256_castsi256_ps(is_zero));
+      if (zero_lanes)
+      {
+        flagZeroLanes(zero_lanes, error_mask + i, 8);
+        quotient = _mm256_andnot_si256(is_zero, quotient);
+      }
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), quotient);
+    }
+    divideScalar(left + i, right + i, out + i, error_mask + i, count - i);
+  }
+
+  TARGET_AVX2 void negateAVX2(const int *in, int *out, size_t count)
+  {
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_sub_epi32(zero, a));
+    }
+    negateScalar(in + i, out + i, count - i);
+  }
+
+  /*
+   * CPU Features
+   *
+   * Queries CPUID (and, for AVX, that the operating system saves the wider registers)
+   */
+  struct CpuFeatures
+  {
+    bool sse42;
+    bool avx2;
+  };
+
+  CpuFeatures detectCpuFeatures()
+  {
+#ifdef _MSC_VER
+    int registers[4];
+    __cpuid(registers, 0);
+    const int max_leaf = registers[0];
+
+    __cpuid(registers, 1);
+    const bool sse41 = (registers[2] >> 19) & 1;
+    const bool sse42 = (registers[2] >> 20) & 1;
+    const bool os_saves_avx = ((registers[2] >> 27) & 1) && ((registers[2] >> 28) & 1) && ((_xgetbv(0) & 6) == 6);
+
+    bool avx2 = false;
+    if (max_leaf >= 7 && os_saves_avx)
+    {
+      __cpuidex(registers, 7, 0);
+      avx2 = (registers[1] >> 5) & 1;
+    }
+
+    return CpuFeatures{.sse42 = sse41 && sse42, .avx2 = avx2};
+#else
+    __builtin_cpu_init();
+    return CpuFeatures{.sse42 = __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("sse4.2"),
+                       .avx2 = __builtin_cpu_supports("avx2") != 0};
+#endif
+  }
+#endif
+
+  const BatchKernels scalar_kernels{.instruction_set = BatchKernels::InstructionSet::Scalar,
+                                    .add = addScalar,
+                                    .subtract = subtractScalar,
+                                    .multiply = multiplyScalar,
+                                    .divide = divideScalar,
+                                    .negate = negateScalar};
+
+#ifdef BATCH_KERNELS_X86
+  const BatchKernels sse42_kernels{.instruction_set = BatchKernels::InstructionSet::SSE42,
+                                   .add = addSSE42,
+                                   .subtract = subtractSSE42,
+                                   .multiply = multiplySSE42,
+                                   .divide = divideSSE42,
+                                   .negate = negateSSE42};
+
+  const BatchKernels avx2_kernels{.instruction_set = BatchKernels::InstructionSet::AVX2,
+                                  .add = addAVX2,
+                                  .subtract = subtractAVX2,
+                                  .multiply = multiplyAVX2,
+                                  .divide = divideAVX2,
+                                  .negate = negateAVX2};
+#endif
+}
+
+/*
+ * Get
+ *
+ * @return The kernels for the widest instruction set the running CPU supports
+ */
+const BatchKernels &BatchKernels::Get()
+{
+  static const BatchKernels &selected = IsSupported(InstructionSet::AVX2)    ? Get(InstructionSet::AVX2)
+                                        : IsSupported(InstructionSet::SSE42) ? Get(InstructionSet::SSE42)
+                                                                             : Get(InstructionSet::Scalar);
+  return selected;
+}
+
+/*
+ * Get
+ *
+ * @param instruction_set The instruction set to use; must be supported by the running CPU
+ * @return The kernels for that instruction set, or the scalar kernels if it is unavailable on this platform
+ */
+const BatchKernels &BatchKernels::Get(InstructionSet instruction_set)
+{
+#ifdef BATCH_KERNELS_X86
+  switch (instruction_set)
+  {
+  case InstructionSet::AVX2: return avx2_kernels;
+  case InstructionSet::SSE42: return sse42_kernels;
+  default: break;
+  }
+#endif
+
+  return scalar_kernels;
+}
+
+/*
+ * Is Supported
+ *
+ * @param instruction_set The instruction set to query
+ * @return True if the running CPU can execute kernels for the instruction set
+ */
+bool BatchKernels::IsSupported(InstructionSet instruction_set)
+{
+  if (instruction_set == InstructionSet::Scalar)
+  {
+    return true;
+  }
+
+#ifdef BATCH_KERNELS_X86
+  static const CpuFeatures features = detectCpuFeatures();
+  return instruction_set == InstructionSet::AVX2 ? features.avx2 : features.sse42;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,56 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BATCH_KERNELS_X86 1
+#endif
+
+/*
+ * Batch Kernels
+ *
+ * The block-wise arithmetic loops used by the batch evaluator (see Bytecode::ExecuteBatch). Each operation has a
+ * scalar implementation and, on x86, SSE4.2 and AVX2 implementations. The widest instruction set supported by the
+ * running CPU is chosen once, at first use.
+ */
+struct BatchKernels
+{
+  /*
+   * Instruction Set
+   *
+   * The instruction sets kernels are provided for, narrowest first
+   */
+  enum class InstructionSet
+  {
+    Scalar,
+    SSE42,
+    AVX2
+  };
+
+  /* out[i] = left[i] op right[i] */
+  using BinaryKernel = void (*)(const int *left, const int *right, int *out, size_t count);
+
+  /* out[i] = -in[i] */
+  using NegateKernel = void (*)(const int *in, int *out, size_t count);
+
+  /* out[i] = left[i] / right[i], or 0 with error_mask[i] set where right[i] is zero */
+  using DivideKernel = void (*)(const int *left, const int *right, int *out, uint8_t *error_mask, size_t count);
+
+  static const BatchKernels &Get();
+
+  static const BatchKernels &Get(InstructionSet instruction_set);
+
+  static bool IsSupported(InstructionSet instruction_set);
+
+  InstructionSet instruction_set;
+  BinaryKernel add;
+  BinaryKernel subtract;
+  BinaryKernel multiply;
+  DivideKernel divide;
+  NegateKernel negate;
+};
@@ -0,0 +1,208 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "bulk_evaluator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * Bulk Block
+ *
+ * A run of whole lines of the input and the formatted results of its lines
+ */
+struct BulkBlock
+{
+  /* Offsets of the block's first character and one past its last (a newline, except at the end of the input) */
+  size_t begin;
+  size_t end;
+
+  /* Formatted results, number of lines and, for binary output, the block-relative line and message of each error */
+  std::string output;
+  size_t line_count = 0;
+  size_t failure_count = 0;
+  std::vector<std::pair<size_t, std::string>> errors;
+
+  /* Set, under the evaluator's lock, once the block may be written */
+  bool done = false;
+};
+
+/*
+ * Evaluate Block
+ *
+ * Evaluates every line of a block into the block's buffers
+ *
+ * @param parser Parser evaluating each line
+ * @param format How results are written
+ * @param input The whole input
+ * @param block The block to evaluate
+ */
+static void evaluateBlock(const RDParser &parser, BulkEvaluator::OutputFormat format, std::string_view input,
+                          BulkBlock &block)
+{
+  block.output.reserve(format == BulkEvaluator::OutputFormat::Text ? block.end - block.begin : 0);
+
+  size_t line_start = block.begin;
+  while (line_start < block.end)
+  {
+    const char *newline =
+        static_cast<const char *>(std::memchr(input.data() + line_start, '\n', block.end - line_start));
+    const size_t line_end = newline == nullptr ? block.end : static_cast<size_t>(newline - input.data());
+
+    std::string_view line = input.substr(line_start, line_end - line_start);
+    if (!line.empty() && line.back() == '\r')
+    {
+      line.remove_suffix(1);
+    }
+
+    Result<int> result = parser.TryParse(line);
+    const int value = result ? result.getValue() : 0;
+    if (!result)
+    {
+      block.failure_count++;
+    }
+
+    if (format == BulkEvaluator::OutputFormat::Text)
+    {
+      if (result)
+      {
+        char digits[16];
+        const std::to_chars_result converted = std::to_chars(digits, digits + sizeof(digits), value);
+        block.output.append(digits, converted.ptr);
+      }
+      else
+      {
+        block.output.append("error: ");
+        block.output.append(result.getError().Message());
+      }
+      block.output.push_back('\n');
+    }
+    else
+    {
+      const int32_t record = value;
+      block.output.append(reinterpret_cast<const char *>(&record), sizeof(record));
+      if (!result)
+      {
+        block.errors.emplace_back(block.line_count, result.getError().Message());
+      }
+    }
+
+    block.line_count++;
+    line_start = line_end + 1;
+  }
+}
+
+/*
+ * Bulk Evaluator Constructor
+ *
+ * Writes text, using one thread per core
+ */
+BulkEvaluator::BulkEvaluator() {}
+
+/*
+ * Bulk Evaluator Constructor
+ *
+ * @param options Output format and parallelism of the evaluation
+ */
+BulkEvaluator::BulkEvaluator(const Options &options) : options(options) {}
+
+/*
+ * Run
+ *
+ * Evaluates every line of the input and writes the results in input order
+ *
+ * @param input One expression per line, separated by '\n' (a trailing '\r' is ignored)
+ * @param output Receives the results
+ * @param errors Receives the line number and message of each failed line, for binary output
+ * @return Number of lines that failed to evaluate
+ */
+size_t BulkEvaluator::Run(std::string_view input, std::FILE *output, std::FILE *errors) const
+{
+  /* Split the input into blocks which end on a line boundary */
+  std::vector<BulkBlock> blocks;
+  const size_t block_size = std::max<size_t>(options.block_size, 1);
+  for (size_t begin = 0; begin < input.size();)
+  {
+    size_t end = std::min(begin + block_size, input.size());
+    if (end < input.size())
+    {
+      const char *newline =
+          static_cast<const char *>(std::memchr(input.data() + end - 1, '\n', input.size() - end + 1));
+      end = newline == nullptr ? input.size() : static_cast<size_t>(newline - input.data()) + 1;
+    }
+
+    BulkBlock block;
+    block.begin = begin;
+    block.end = end;
+    blocks.push_back(std::move(block));
+    begin = end;
+  }
+
+  std::mutex mutex;
+  std::condition_variable block_done;
+  std::atomic<size_t> next_block(0);
+
+  size_t thread_count = options.thread_count;
+  if (thread_count == 0)
+  {
+    thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+  thread_count = std::min(thread_count, std::max<size_t>(blocks.size(), 1));
+
+  std::vector<std::thread> workers;
+  for (size_t worker = 0; worker < thread_count; worker++)
+  {
+    workers.emplace_back(
+        [&]
+        {
+          for (size_t block_idx = next_block++; block_idx < blocks.size(); block_idx = next_block++)
+          {
+            evaluateBlock(parser, options.format, input, blocks[block_idx]);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            blocks[block_idx].done = true;
+            block_done.notify_all();
+          }
+        });
+  }
+
+  /* Write each block as soon as it and every block before it are finished, releasing its buffers */
+  size_t first_line = 1;
+  size_t failure_count = 0;
+  for (BulkBlock &block : blocks)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      block_done.wait(lock, [&block] { return block.done; });
+    }
+
+    std::fwrite(block.output.data(), 1, block.output.size(), output);
+    for (const std::pair<size_t, std::string> &error : block.errors)
+    {
+      std::fprintf(errors, "line %zu: %s\n", first_line + error.first, error.second.c_str());
+    }
+
+    first_line += block.line_count;
+    failure_count += block.failure_count;
+    std::string().swap(block.output);
+    std::vector<std::pair<size_t, std::string>>().swap(block.errors);
+  }
+
+  for (std::thread &worker : workers)
+  {
+    worker.join();
+  }
+
+  std::fflush(output);
+  return failure_count;
+}
\ No newline at end of file
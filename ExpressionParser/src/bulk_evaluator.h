@@ -0,0 +1,68 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+
+#include "rd_parser.h"
+
+#define BULK_BLOCK_SIZE (256 * 1024)
+
+/*
+ * Bulk Evaluator
+ *
+ * Evaluates a buffer holding one expression per line, such as a mapped file (see MappedFile). The buffer is split
+ * into blocks of whole lines which worker threads take in order; each block's lines are viewed in place and its
+ * results are formatted into a buffer of its own. The calling thread writes finished blocks to the output in input
+ * order while later blocks are still being evaluated.
+ *
+ * Text output has one line per input line: the result, or "error: " followed by the error message. Binary output
+ * has one int32 per input line in native byte order, with 0 for lines that failed; their line numbers and messages
+ * are written to the error stream instead.
+ */
+class BulkEvaluator
+{
+public:
+  /*
+   * Output Format
+   *
+   * How results are written
+   */
+  enum class OutputFormat
+  {
+    Text,
+    Binary
+  };
+
+  /*
+   * Bulk Options
+   *
+   * Configuration of a bulk evaluation
+   */
+  struct Options
+  {
+    OutputFormat format = OutputFormat::Text;
+
+    /* Number of threads evaluating blocks; zero uses one per core */
+    size_t thread_count = 0;
+
+    /* Approximate number of input bytes in each block */
+    size_t block_size = BULK_BLOCK_SIZE;
+  };
+
+  BulkEvaluator();
+
+  explicit BulkEvaluator(const Options &options);
+
+  size_t Run(std::string_view input, std::FILE *output, std::FILE *errors) const;
+
+private:
+  /* Evaluates each line */
+  RDParser parser;
+
+  Options options;
+};
\ No newline at end of file
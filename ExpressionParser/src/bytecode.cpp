@@ -0,0 +1,363 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "bytecode.h"
+#include "arithmetic.h"
+#include "errors.h"
+
+#include <algorithm>
+
+/*
+ * Bytecode Constructor
+ *
+ * Creates an empty program
+ */
+Bytecode::Bytecode() : max_stack_depth(0) {}
+
+/*
+ * Compile
+ *
+ * Lowers a node table to bytecode. Children are stored before their parents, so the table is already in postfix
+ * order and each node maps onto exactly one instruction. The operand stack depth is tracked as the instructions are
+ * emitted so the interpreter knows in advance how much stack it needs.
+ *
+ * @param ast The node table to lower
+ * @return The equivalent bytecode program
+ */
+Bytecode Bytecode::Compile(const FlatAst &ast)
+{
+  Bytecode bytecode;
+  bytecode.instructions.reserve(ast.getNodeCount());
+
+  size_t depth = 0;
+  for (FlatAst::NodeIndex node = 0; node < static_cast<FlatAst::NodeIndex>(ast.getNodeCount()); node++)
+  {
+    Instruction instruction{.op = OpCode::PushLiteral, .operand = 0};
+
+    switch (ast.getOpCode(node))
+    {
+    case FlatAst::OpCode::Literal:
+      instruction.operand = ast.getLiteral(node);
+      depth++;
+      break;
+
+    case FlatAst::OpCode::Variable:
+      instruction.op = OpCode::PushVariable;
+      instruction.operand = ast.getLeft(node);
+      depth++;
+      break;
+
+    case FlatAst::OpCode::Negate: instruction.op = OpCode::Negate; break;
+
+    case FlatAst::OpCode::Addition: instruction.op = OpCode::Addition; depth--; break;
+    case FlatAst::OpCode::Subtraction: instruction.op = OpCode::Subtraction; depth--; break;
+    case FlatAst::OpCode::Multiplication: instruction.op = OpCode::Multiplication; depth--; break;
+    case FlatAst::OpCode::Division: instruction.op = OpCode::Division; depth--; break;
+
+    default: throw ExpressionParserErrors::UnknownOperatorException();
+    }
+
+    bytecode.instructions.push_back(instruction);
+    bytecode.max_stack_depth = std::max(bytecode.max_stack_depth, depth);
+  }
+
+  return bytecode;
+}
+
+/*
+ * Execute
+ *
+ * Runs the program, throwing DivideByZeroException on division by zero
+ *
+ * @param bindings Values of the variables, indexed by slot. May only be null if the program has no variables.
+ * @return Result of the evaluated expression
+ */
+int Bytecode::Execute(const int *bindings) const
+{
+  int result;
+  if (!TryExecute(bindings, result))
+  {
+    throw ExpressionParserErrors::DivideByZeroException();
+  }
+
+  return result;
+}
+
+/*
+ * Try Execute
+ *
+ * Runs the program on int with unchecked arithmetic
+ *
+ * @param bindings Values of the variables, indexed by slot. May only be null if the program has no variables.
+ * @param result Receives the result of the evaluated expression
+ * @return True if the program ran to completion, false if it divides by zero
+ */
+bool Bytecode::TryExecute(const int *bindings, int &result) const
+{
+  return TryExecuteAs<int32_t, false>(bindings, result) == ExpressionParserErrors::ErrorKind::None;
+}
+
+/*
+ * Try Execute As
+ *
+ * Runs the program on a chosen value type (see the static overload)
+ *
+ * @param bindings Values of the variables, indexed by slot. May only be null if the program has no variables.
+ * @param result Receives the result of the evaluated expression
+ * @return ErrorKind::None if the program ran to completion, otherwise DivideByZero or, for checked arithmetic,
+ *         Overflow
+ */
+template <typename T, bool Checked>
+ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs(const T *bindings, T &result) const
+{
+  return TryExecuteAs<T, Checked>(instructions, max_stack_depth, bindings, result);
+}
+
+/*
+ * Try Execute As
+ *
+ * Runs a sequence of instructions on a fixed-size operand stack held in the interpreter's frame. Programs needing
+ * more stack than BYTECODE_STACK_SIZE (only possible with very deep right-hand nesting) run on a per-thread buffer
+ * instead.
+ *
+ * Instantiated for int32_t and int64_t, each with unchecked and checked arithmetic (see Arithmetic).
+ *
+ * @param instructions The program, which must be well formed: every operand it pops has been pushed, and exactly
+ *                     one operand remains at the end
+ * @param max_stack_depth Greatest number of operands on the stack at any point during execution
+ * @param bindings Values of the variables, indexed by slot. May only be null if the program has no variables.
+ * @param result Receives the result of the evaluated expression
+ * @return ErrorKind::None if the program ran to completion, otherwise DivideByZero or, for checked arithmetic,
+ *         Overflow
+ */
+template <typename T, bool Checked>
+ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs(std::span<const Instruction> instructions,
+                                                         size_t max_stack_depth, const T *bindings, T &result)
+{
+  if (max_stack_depth <= BYTECODE_STACK_SIZE)
+  {
+    T stack[BYTECODE_STACK_SIZE];
+    return run<T, Checked>(instructions, stack, bindings, result);
+  }
+
+  thread_local std::vector<T> overflow_stack;
+  if (overflow_stack.size() < max_stack_depth)
+  {
+    overflow_stack.resize(max_stack_depth);
+  }
+
+  return run<T, Checked>(instructions, overflow_stack.data(), bindings, result);
+}
+
+template ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs<int32_t, false>(const int32_t *, int32_t &) const;
+template ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs<int32_t, true>(const int32_t *, int32_t &) const;
+template ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs<int64_t, false>(const int64_t *, int64_t &) const;
+template ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs<int64_t, true>(const int64_t *, int64_t &) const;
+template ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs<int32_t, false>(std::span<const Instruction>, size_t,
+                                                                               const int32_t *, int32_t &);
+template ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs<int32_t, true>(std::span<const Instruction>, size_t,
+                                                                              const int32_t *, int32_t &);
+template ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs<int64_t, false>(std::span<const Instruction>, size_t,
+                                                                               const int64_t *, int64_t &);
+template ExpressionParserErrors::ErrorKind Bytecode::TryExecuteAs<int64_t, true>(std::span<const Instruction>, size_t,
+                                                                              const int64_t *, int64_t &);
+
+/*
+ * Execute Batch
+ *
+ * Evaluates the program for every row of a set of input columns. Rows are processed in blocks: each instruction
+ * runs over a whole block before the next instruction is dispatched, so the per-instruction cost is shared by every
+ * row in the block. The blocks are processed with the widest vector kernels the CPU supports (see BatchKernels).
+ * A row that divides by zero does not throw; it is flagged in the error mask and its result is 0.
+ *
+ * @param columns One pointer per variable slot to an array of row_count values
+ * @param row_count Number of rows to evaluate
+ * @param results Receives row_count results
+ * @param error_mask Receives row_count flags; non-zero marks a row whose result is undefined
+ * @return Number of rows flagged in the error mask
+ */
+size_t Bytecode::ExecuteBatch(const int *const *columns, size_t row_count, int *results, uint8_t *error_mask) const
+{
+  /* One block of scratch values per level of the operand stack */
+  thread_local std::vector<int> scratch;
+  thread_local std::vector<const int *> operands;
+  if (scratch.size() < max_stack_depth * BATCH_BLOCK_SIZE)
+  {
+    scratch.resize(max_stack_depth * BATCH_BLOCK_SIZE);
+    operands.resize(max_stack_depth);
+  }
+
+  const BatchKernels &kernels = BatchKernels::Get();
+
+  size_t error_count = 0;
+  for (size_t first_row = 0; first_row < row_count; first_row += BATCH_BLOCK_SIZE)
+  {
+    const size_t block_rows = std::min<size_t>(BATCH_BLOCK_SIZE, row_count - first_row);
+    error_count += runBlock(kernels, columns, first_row, block_rows, scratch.data(), operands.data(),
+                            results + first_row, error_mask + first_row);
+  }
+
+  return error_count;
+}
+
+/*
+ * Get Instructions
+ *
+ * @return The instruction stream, in execution order
+ */
+const std::vector<Bytecode::Instruction> &Bytecode::getInstructions() const
+{
+  return instructions;
+}
+
+/*
+ * Get Max Stack Depth
+ *
+ * @return Number of operand stack entries needed to execute the program
+ */
+size_t Bytecode::getMaxStackDepth() const
+{
+  return max_stack_depth;
+}
+
+/*
+ * Run
+ *
+ * The interpreter loop. The topmost operand is cached in a local so that most instructions touch the stack memory
+ * at most once; the stack pointer refers to the slot above the topmost operand that has been spilled.
+ *
+ * @param instructions The program to run
+ * @param stack Operand stack with room for max_stack_depth entries
+ * @param bindings Values of the variables, indexed by slot
+ * @param result Receives the single operand left after the last instruction
+ * @return ErrorKind::None if the program ran to completion, otherwise DivideByZero or Overflow
+ */
+template <typename T, bool Checked>
+ExpressionParserErrors::ErrorKind Bytecode::run(std::span<const Instruction> instructions, T *stack, const T *bindings,
+                                               T &result)
+{
+  using Ops = Arithmetic<T, Checked>;
+  T *top = stack;
+  T accumulator = 0;
+  bool represented = true;
+
+  for (const Instruction &instruction : instructions)
+  {
+    switch (instruction.op)
+    {
+    case OpCode::PushLiteral: *top++ = accumulator; accumulator = instruction.operand; break;
+
+    case OpCode::PushVariable: *top++ = accumulator; accumulator = bindings[instruction.operand]; break;
+
+    case OpCode::Negate: represented = Ops::Negate(accumulator, accumulator); break;
+
+    case OpCode::Addition: represented = Ops::Add(*--top, accumulator, accumulator); break;
+
+    case OpCode::Subtraction: represented = Ops::Subtract(*--top, accumulator, accumulator); break;
+
+    case OpCode::Multiplication: represented = Ops::Multiply(*--top, accumulator, accumulator); break;
+
+    case OpCode::Division:
+      if (accumulator == 0)
+      {
+        /* Undefined result encountered */
+        return ExpressionParserErrors::ErrorKind::DivideByZero;
+      }
+
+      represented = Ops::Divide(*--top, accumulator, accumulator);
+      break;
+
+    default: throw ExpressionParserErrors::UnknownOperatorException();
+    }
+
+    if (!represented)
+    {
+      return ExpressionParserErrors::ErrorKind::Overflow;
+    }
+  }
+
+  result = accumulator;
+  return ExpressionParserErrors::ErrorKind::None;
+}
+
+/*
+ * Run Block
+ *
+ * The vector-at-a-time interpreter loop for a single block of rows. Each level of the operand stack refers to a
+ * block of values: variables refer directly into their input column, every other level into its own block of
+ * scratch memory.
+ *
+ * @param kernels The arithmetic kernels applied to each block
+ * @param columns One pointer per variable slot to the input column
+ * @param first_row Index of the block's first row within the columns
+ * @param row_count Number of rows in the block, at most BATCH_BLOCK_SIZE
+ * @param scratch max_stack_depth blocks of scratch values
+ * @param operands max_stack_depth entries receiving the block each stack level refers to
+ * @param results Receives the block's results
+ * @param error_mask Receives the block's error flags
+ * @return Number of rows flagged in the error mask
+ */
+size_t Bytecode::runBlock(const BatchKernels &kernels, const int *const *columns, size_t first_row, size_t row_count,
+                          int *scratch, const int **operands, int *results, uint8_t *error_mask) const
+{
+  std::fill_n(error_mask, row_count, uint8_t(0));
+
+  size_t depth = 0;
+  for (const Instruction &instruction : instructions)
+  {
+    switch (instruction.op)
+    {
+    case OpCode::PushLiteral:
+    {
+      int *out = scratch + depth * BATCH_BLOCK_SIZE;
+      std::fill_n(out, row_count, instruction.operand);
+      operands[depth++] = out;
+      break;
+    }
+
+    case OpCode::PushVariable: operands[depth++] = columns[instruction.operand] + first_row; break;
+
+    case OpCode::Negate:
+    {
+      int *out = scratch + (depth - 1) * BATCH_BLOCK_SIZE;
+      kernels.negate(operands[depth - 1], out, row_count);
+      operands[depth - 1] = out;
+      break;
+    }
+
+    case OpCode::Addition:
+    case OpCode::Subtraction:
+    case OpCode::Multiplication:
+    case OpCode::Division:
+    {
+      depth--;
+      const int *left = operands[depth - 1];
+      const int *right = operands[depth];
+      int *out = scratch + (depth - 1) * BATCH_BLOCK_SIZE;
+
+      switch (instruction.op)
+      {
+      case OpCode::Addition: kernels.add(left, right, out, row_count); break;
+      case OpCode::Subtraction: kernels.subtract(left, right, out, row_count); break;
+      case OpCode::Multiplication: kernels.multiply(left, right, out, row_count); break;
+      default: kernels.divide(left, right, out, error_mask, row_count); break;
+      }
+
+      operands[depth - 1] = out;
+      break;
+    }
+
+    default: throw ExpressionParserErrors::UnknownOperatorException();
+    }
+  }
+
+  size_t error_count = 0;
+  for (size_t row = 0; row < row_count; row++)
+  {
+    results[row] = error_mask[row] ? 0 : operands[0][row];
+    error_count += error_mask[row];
+  }
+
+  return error_count;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "batch_kernels.h"
+#include "flat_ast.h"
+#include "result.h"
+
+#define BYTECODE_STACK_SIZE 256
+#define BATCH_BLOCK_SIZE 256
+
+/*
+ * Bytecode
+ *
+ * A compiled expression lowered to a linear sequence of stack machine instructions, together with a tight
+ * interpreter for it. Evaluation is a single loop over the instructions; it never recurses, so the depth of the
+ * expression cannot overflow the call stack.
+ *
+ * The interpreter may also run instructions held elsewhere, such as a mapped ExpressionCatalogue, without copying
+ * them into a Bytecode.
+ *
+ * A second, vector-at-a-time interpreter evaluates the program over many rows of columnar input. It dispatches each
+ * instruction once per block of BATCH_BLOCK_SIZE rows rather than once per row.
+ */
+class Bytecode
+{
+public:
+  /*
+   * Instruction OpCode
+   *
+   * States the operation an instruction performs on the operand stack
+   */
+  enum class OpCode : uint8_t
+  {
+    PushLiteral,
+    PushVariable,
+    Negate,
+    Addition,
+    Subtraction,
+    Multiplication,
+    Division
+  };
+
+  /*
+   * Instruction
+   *
+   * A single bytecode instruction. The operand holds the value of PushLiteral and the binding slot of PushVariable.
+   */
+  struct Instruction
+  {
+    OpCode op;
+    int32_t operand;
+  };
+
+  Bytecode();
+
+  static Bytecode Compile(const FlatAst &ast);
+
+  int Execute(const int *bindings) const;
+
+  bool TryExecute(const int *bindings, int &result) const;
+
+  template <typename T, bool Checked>
+  ExpressionParserErrors::ErrorKind TryExecuteAs(const T *bindings, T &result) const;
+
+  template <typename T, bool Checked>
+  static ExpressionParserErrors::ErrorKind TryExecuteAs(std::span<const Instruction> instructions,
+                                                        size_t max_stack_depth, const T *bindings, T &result);
+
+  size_t ExecuteBatch(const int *const *columns, size_t row_count, int *results, uint8_t *error_mask) const;
+
+  const std::vector<Instruction> &getInstructions() const;
+
+  size_t getMaxStackDepth() const;
+
+private:
+  template <typename T, bool Checked>
+  static ExpressionParserErrors::ErrorKind run(std::span<const Instruction> instructions, T *stack, const T *bindings,
+                                               T &result);
+
+  size_t runBlock(const BatchKernels &kernels, const int *const *columns, size_t first_row, size_t row_count,
+                  int *scratch, const int **operands, int *results, uint8_t *error_mask) const;
+
+  /* The instruction stream, in execution order */
+  std::vector<Instruction> instructions;
+
+  /* Greatest number of operands on the stack at any point during execution */
+  size_t max_stack_depth;
+};
@@ -0,0 +1,269 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "compiled_expression.h"
+#include "errors.h"
+
+#include <type_traits>
+
+/*
+ * Program Destructor
+ *
+ * Releases the native translation, if one was installed
+ */
+CompiledExpression::Program::~Program()
+{
+  delete native.load(std::memory_order_acquire);
+}
+
+/*
+ * Compiled Expression Constructor
+ *
+ * @param program The program produced by the parser
+ */
+CompiledExpression::CompiledExpression(std::shared_ptr<const Program> program) : program(std::move(program)) {}
+
+/*
+ * Evaluate
+ *
+ * Evaluates a compiled expression which has no variables
+ *
+ * @return Result of the evaluated expression
+ */
+int CompiledExpression::Evaluate() const
+{
+  return Evaluate({});
+}
+
+/*
+ * Evaluate
+ *
+ * Evaluates the compiled program against a binding table, throwing the exception matching any error
+ *
+ * @param bindings Value of each variable, indexed by slot (see getSlot). Extra trailing values are ignored.
+ * @return Result of the evaluated expression
+ */
+int CompiledExpression::Evaluate(std::span<const int> bindings) const
+{
+  return TryEvaluate(bindings).getValue();
+}
+
+/*
+ * Try Evaluate
+ *
+ * Evaluates the compiled program against a binding table, reporting an unbound variable or division by zero
+ * through the result instead of throwing
+ *
+ * @param bindings Value of each variable, indexed by slot (see getSlot). Extra trailing values are ignored.
+ * @return Result of the evaluated expression, or a description of the failure
+ */
+Result<int> CompiledExpression::TryEvaluate(std::span<const int> bindings) const
+{
+  return TryEvaluateAs<int32_t, false>(bindings);
+}
+
+/*
+ * Evaluate As
+ *
+ * Evaluates the compiled program on a chosen value type, throwing the exception matching any error
+ *
+ * @param bindings Value of each variable, indexed by slot (see getSlot). Extra trailing values are ignored.
+ * @return Result of the evaluated expression
+ */
+template <typename T, bool Checked> T CompiledExpression::EvaluateAs(std::span<const T> bindings) const
+{
+  return TryEvaluateAs<T, Checked>(bindings).getValue();
+}
+
+/*
+ * Try Evaluate As
+ *
+ * Evaluates the compiled program on a chosen value type, reporting an unbound variable, division by zero or, for
+ * checked arithmetic, overflow through the result instead of throwing
+ *
+ * @param bindings Value of each variable, indexed by slot (see getSlot). Extra trailing values are ignored.
+ * @return Result of the evaluated expression, or a description of the failure
+ */
+template <typename T, bool Checked> Result<T> CompiledExpression::TryEvaluateAs(std::span<const T> bindings) const
+{
+  ExpressionParserErrors::ErrorInfo error;
+
+  if (bindings.size() < program->variables.size())
+  {
+    error.kind = ExpressionParserErrors::ErrorKind::UnboundVariable;
+    error.token = program->variables[bindings.size()];
+    return error;
+  }
+
+  T result;
+  if constexpr (std::is_same_v<T, int32_t> && !Checked)
+  {
+    const NativeCode *native = program->native.load(std::memory_order_acquire);
+    if (native != nullptr)
+    {
+      if (native->getFunction()(bindings.data(), &result) == 0)
+      {
+        error.kind = ExpressionParserErrors::ErrorKind::DivideByZero;
+        return error;
+      }
+
+      return result;
+    }
+  }
+
+  error.kind = program->bytecode.TryExecuteAs<T, Checked>(bindings.data(), result);
+  if (error.kind != ExpressionParserErrors::ErrorKind::None)
+  {
+    return error;
+  }
+
+  return result;
+}
+
+template int32_t CompiledExpression::EvaluateAs<int32_t, false>(std::span<const int32_t>) const;
+template int32_t CompiledExpression::EvaluateAs<int32_t, true>(std::span<const int32_t>) const;
+template int64_t CompiledExpression::EvaluateAs<int64_t, false>(std::span<const int64_t>) const;
+template int64_t CompiledExpression::EvaluateAs<int64_t, true>(std::span<const int64_t>) const;
+template Result<int32_t> CompiledExpression::TryEvaluateAs<int32_t, false>(std::span<const int32_t>) const;
+template Result<int32_t> CompiledExpression::TryEvaluateAs<int32_t, true>(std::span<const int32_t>) const;
+template Result<int64_t> CompiledExpression::TryEvaluateAs<int64_t, false>(std::span<const int64_t>) const;
+template Result<int64_t> CompiledExpression::TryEvaluateAs<int64_t, true>(std::span<const int64_t>) const;
+
+/*
+ * Evaluate Batch
+ *
+ * Evaluates the compiled program over columns of input, one row per evaluation (see Bytecode::ExecuteBatch).
+ * Division by zero is reported per row through the error mask instead of being thrown.
+ *
+ * @param columns One pointer per variable slot to an array of row_count values
+ * @param row_count Number of rows to evaluate
+ * @param results Receives row_count results
+ * @param error_mask Receives row_count flags; non-zero marks a row whose result is undefined (and set to 0)
+ * @return Number of rows flagged in the error mask
+ */
+size_t CompiledExpression::EvaluateBatch(std::span<const int *const> columns, size_t row_count, int *results,
+                                         uint8_t *error_mask) const
+{
+  if (columns.size() < program->variables.size())
+  {
+    throw ExpressionParserErrors::UnboundVariableException(program->variables[columns.size()]);
+  }
+
+  return program->bytecode.ExecuteBatch(columns.data(), row_count, results, error_mask);
+}
+
+/*
+ * Get Node Count
+ *
+ * @return Number of nodes in the compiled expression's tree
+ */
+size_t CompiledExpression::getNodeCount() const
+{
+  return program->ast.getNodeCount();
+}
+
+/*
+ * Get Variable Count
+ *
+ * @return Number of slots the binding table passed to Evaluate must provide
+ */
+size_t CompiledExpression::getVariableCount() const
+{
+  return program->variables.size();
+}
+
+/*
+ * Get Slot
+ *
+ * Looks up the binding table index of a variable. Intended to be called once per variable, not per evaluation.
+ *
+ * @param name Name of the variable as written in the expression
+ * @return Index into the binding table
+ */
+int CompiledExpression::getSlot(std::string_view name) const
+{
+  for (size_t slot = 0; slot < program->variables.size(); slot++)
+  {
+    if (program->variables[slot] == name)
+    {
+      return static_cast<int>(slot);
+    }
+  }
+
+  throw ExpressionParserErrors::UnknownVariableException(name);
+}
+
+/*
+ * Get Variable Name
+ *
+ * @param slot Index into the binding table
+ * @return Name of the variable bound to the slot
+ */
+const std::string &CompiledExpression::getVariableName(size_t slot) const
+{
+  return program->variables.at(slot);
+}
+
+/*
+ * Get Memory Usage
+ *
+ * @return Approximate number of bytes held by the compiled program, shared by every copy of the handle
+ */
+size_t CompiledExpression::getMemoryUsage() const
+{
+  size_t usage = sizeof(Program) + program->storage.getCapacity() +
+                 program->bytecode.getInstructions().capacity() * sizeof(Bytecode::Instruction);
+  for (const std::string &name : program->variables)
+  {
+    usage += sizeof(std::string) + name.capacity();
+  }
+
+  const NativeCode *native = program->native.load(std::memory_order_acquire);
+  if (native != nullptr)
+  {
+    usage += native->getSize();
+  }
+  return usage;
+}
+
+/*
+ * Compile Native
+ *
+ * Translates the program to machine code, which every handle sharing it uses for later evaluations. Safe to call
+ * from several threads at once; the program is only translated once.
+ *
+ * @return True if evaluations run native code, false if the platform (or this program) is not supported and the
+ *         interpreter remains in use
+ */
+bool CompiledExpression::CompileNative() const
+{
+  if (isNative())
+  {
+    return true;
+  }
+
+  std::unique_ptr<NativeCode> native = NativeCode::Compile(program->bytecode);
+  if (native == nullptr)
+  {
+    return false;
+  }
+
+  /* Another thread may have installed its translation first, in which case this one is discarded */
+  NativeCode *expected = nullptr;
+  if (program->native.compare_exchange_strong(expected, native.get(), std::memory_order_acq_rel))
+  {
+    native.release();
+  }
+  return true;
+}
+
+/*
+ * Is Native
+ *
+ * @return True if evaluations run native code
+ */
+bool CompiledExpression::isNative() const
+{
+  return program->native.load(std::memory_order_acquire) != nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+#include "bytecode.h"
+#include "flat_ast.h"
+#include "native_code.h"
+#include "result.h"
+
+#define COMPILED_EXPRESSION_BLOCK_SIZE 256
+
+/*
+ * Compiled Expression
+ *
+ * An immutable handle to an expression that has already been lexed and parsed (see RDParser::Compile). It can be
+ * evaluated any number of times without repeating that work. Copies of the handle share the same compiled program.
+ * Evaluation runs the expression's bytecode (see Bytecode) on the stack-based interpreter.
+ *
+ * Variables are resolved to slot indices when the expression is compiled. Evaluation reads their values from a
+ * binding table indexed by slot, so binding a row of values is a plain array access.
+ *
+ * Evaluate works on int and, like the arithmetic it mirrors, does not detect overflow. EvaluateAs selects the value
+ * type (int32_t or int64_t, with literals widened) and whether arithmetic is checked at compile time; a checked
+ * evaluation reports a result that does not fit the type through OverflowException rather than wrapping, and the
+ * unchecked instantiations cost no more than Evaluate.
+ *
+ * Expressions evaluated very often may be translated to machine code (see NativeCode and CompileNative). Evaluate
+ * and the int32_t unchecked instantiations then call the generated function instead of the interpreter.
+ */
+class CompiledExpression
+{
+public:
+  int Evaluate() const;
+
+  int Evaluate(std::span<const int> bindings) const;
+
+  Result<int> TryEvaluate(std::span<const int> bindings = {}) const;
+
+  template <typename T, bool Checked = false> T EvaluateAs(std::span<const T> bindings = {}) const;
+
+  template <typename T, bool Checked = false> Result<T> TryEvaluateAs(std::span<const T> bindings = {}) const;
+
+  size_t EvaluateBatch(std::span<const int *const> columns, size_t row_count, int *results, uint8_t *error_mask) const;
+
+  size_t getNodeCount() const;
+
+  size_t getVariableCount() const;
+
+  int getSlot(std::string_view name) const;
+
+  const std::string &getVariableName(size_t slot) const;
+
+  size_t getMemoryUsage() const;
+
+  bool CompileNative() const;
+
+  bool isNative() const;
+
+private:
+  friend class RDParser;
+  friend class IterativeParser;
+  friend class ExpressionCatalogue;
+  friend class ExpressionDag;
+  friend class IncrementalEvaluator;
+
+  /*
+   * Program
+   *
+   * The compiled node table together with the arena that owns its arrays, the bytecode it was lowered to and the
+   * variable names in slot order. Node tables are small, so the arena uses small blocks.
+   *
+   * The native translation is the one part that may change after compilation: it is installed at most once, by
+   * whichever thread asks first, and is owned by the program from then on.
+   */
+  struct Program
+  {
+    ~Program();
+
+    Arena storage{COMPILED_EXPRESSION_BLOCK_SIZE};
+    FlatAst ast;
+    Bytecode bytecode;
+    std::vector<std::string> variables;
+    mutable std::atomic<NativeCode *> native{nullptr};
+  };
+
+  CompiledExpression(std::shared_ptr<const Program> program);
+
+  /* The shared, read-only compiled program */
+  std::shared_ptr<const Program> program;
+};
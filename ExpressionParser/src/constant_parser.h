@@ -0,0 +1,344 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <limits>
+#include <string_view>
+
+#include "arithmetic.h"
+#include "lexer.h"
+#include "result.h"
+
+#define CONSTANT_PARSER_MAX_DEPTH 256
+
+/*
+ * Constant Parser
+ *
+ * Evaluates an expression of literals entirely within a constant expression, so that formulas fixed when the program
+ * is built cost nothing at run time:
+ *
+ *   constexpr int value = ConstantParser::Parse("4 + (12 / (1 * 2))");
+ *
+ * It accepts RDParser's grammar and reports the same errors, but owns no memory: the expression is scanned once for
+ * invalid characters, as by the Lexer, and then evaluated as its tokens are read, RDParser's descent being replaced
+ * by a fixed-size stack of CONSTANT_PARSER_MAX_DEPTH open parentheses. Division by zero is only reported once the
+ * whole expression has been parsed, matching RDParser's order of errors.
+ *
+ * A malformed expression reaches ErrorInfo::Throw, which is not constexpr, so in a constant evaluation it fails the
+ * build at the offending call; at run time the exception from errors.h is thrown as by RDParser::Parse. Arithmetic is
+ * unchecked and wraps on overflow, as in every other engine (see Arithmetic). Evaluate may only be called at compile
+ * time.
+ */
+class ConstantParser
+{
+public:
+  /*
+   * Parse
+   *
+   * @param expr View of the expression to evaluate
+   * @return Result of the evaluated expression
+   */
+  static constexpr int Parse(std::string_view expr)
+  {
+    ExpressionParserErrors::ErrorInfo error;
+    int result = 0;
+    if (!TryParse(expr, result, error))
+    {
+      error.Throw();
+    }
+
+    return result;
+  }
+
+  /*
+   * Evaluate
+   *
+   * Parse, guaranteed to happen while the program is compiled
+   *
+   * @param expr View of the expression to evaluate
+   * @return Result of the evaluated expression
+   */
+  static consteval int Evaluate(std::string_view expr) { return Parse(expr); }
+
+  /*
+   * Try Parse
+   *
+   * @param expr View of the expression to evaluate
+   * @param result Receives the result of the evaluated expression
+   * @param error Receives the description of the failure, if any
+   * @return True if the expression was evaluated
+   */
+  static constexpr bool TryParse(std::string_view expr, int &result, ExpressionParserErrors::ErrorInfo &error)
+  {
+    error = ExpressionParserErrors::ErrorInfo();
+    error.expression = expr;
+
+    Lexer::Token last_token{};
+    if (!scan(expr, last_token, error))
+    {
+      return false;
+    }
+
+    using Ops = Arithmetic<int32_t, false>;
+    Frame frames[CONSTANT_PARSER_MAX_DEPTH + 1] = {};
+    size_t depth = 0;
+    bool divide_by_zero = false;
+
+    size_t position = 0;
+    Lexer::Token token = nextToken(expr, position);
+    while (true)
+    {
+      /* 'Unary -> ("-") Unary' */
+      while (token.operation == Lexer::TokenOperation::Subtraction)
+      {
+        frames[depth].negate = !frames[depth].negate;
+        token = nextToken(expr, position);
+      }
+
+      /* 'Primary -> Literal | "(" Expression ")"' */
+      if (token.operation == Lexer::TokenOperation::L_Brace)
+      {
+        if (depth == CONSTANT_PARSER_MAX_DEPTH)
+        {
+          return fail(ExpressionParserErrors::ErrorKind::NestingTooDeep, token.raw, token.position, error);
+        }
+
+        frames[++depth] = Frame{};
+        token = nextToken(expr, position);
+        continue;
+      }
+
+      if (token.operation != Lexer::TokenOperation::Literal)
+      {
+        /* The operand is missing; at the end of the expression the last token is reported, as by RDParser */
+        const Lexer::Token &bad_token = token.operation == Lexer::TokenOperation::None ? last_token : token;
+        return fail(ExpressionParserErrors::ErrorKind::UnexpectedToken, bad_token.raw, bad_token.position, error);
+      }
+
+      int operand = token.value;
+      token = nextToken(expr, position);
+
+      /* Fold the operand and every parenthesis it closes into the enclosing levels */
+      while (true)
+      {
+        Frame &frame = frames[depth];
+        if (frame.negate)
+        {
+          Ops::Negate(operand, operand);
+          frame.negate = false;
+        }
+
+        if (!frame.has_value)
+        {
+          frame.value = operand;
+          frame.has_value = true;
+        }
+        else
+        {
+          switch (frame.pending)
+          {
+          case Lexer::TokenOperation::Addition: Ops::Add(frame.value, operand, frame.value); break;
+          case Lexer::TokenOperation::Subtraction: Ops::Subtract(frame.value, operand, frame.value); break;
+          case Lexer::TokenOperation::Multiplication: Ops::Multiply(frame.value, operand, frame.value); break;
+          default:
+            divide_by_zero = divide_by_zero || operand == 0;
+            if (operand == 0)
+            {
+              frame.value = 0;
+            }
+            else
+            {
+              Ops::Divide(frame.value, operand, frame.value);
+            }
+            break;
+          }
+        }
+
+        /* 'Binary -> Unary | (("*" | "/" | "+" | "-") Unary)*' */
+        if (token.operation == Lexer::TokenOperation::Addition ||
+            token.operation == Lexer::TokenOperation::Subtraction ||
+            token.operation == Lexer::TokenOperation::Multiplication ||
+            token.operation == Lexer::TokenOperation::Division)
+        {
+          frame.pending = token.operation;
+          token = nextToken(expr, position);
+          break;
+        }
+
+        if (depth == 0)
+        {
+          if (token.operation != Lexer::TokenOperation::None)
+          {
+            return fail(ExpressionParserErrors::ErrorKind::UnexpectedParentheses, token.raw, token.position, error);
+          }
+
+          if (divide_by_zero)
+          {
+            return fail(ExpressionParserErrors::ErrorKind::DivideByZero, {}, 0, error);
+          }
+
+          result = frame.value;
+          return true;
+        }
+
+        if (token.operation != Lexer::TokenOperation::R_Brace)
+        {
+          /* Report where the closing brace was expected */
+          const size_t brace_position = token.operation == Lexer::TokenOperation::None ? expr.size() : token.position;
+          return fail(ExpressionParserErrors::ErrorKind::ParenthesesMismatch, {}, brace_position, error);
+        }
+
+        operand = frame.value;
+        depth--;
+        token = nextToken(expr, position);
+      }
+    }
+  }
+
+private:
+  /*
+   * Constant Frame
+   *
+   * The running value of one 'Binary' production: the top level of the expression or the contents of a parenthesis
+   */
+  struct Frame
+  {
+    int value = 0;
+    bool has_value = false;
+
+    /* Operator combining the next operand with value */
+    Lexer::TokenOperation pending = Lexer::TokenOperation::None;
+
+    /* True if an odd number of negations precede the operand being parsed */
+    bool negate = false;
+  };
+
+  /*
+   * Scan
+   *
+   * Checks the expression the way Lexer::TryTokenise does, without keeping its tokens
+   *
+   * @param expr View of the expression to check
+   * @param last_token Receives the expression's last token
+   * @param error Receives the description of the failure, if any
+   * @return True if the expression consists of valid tokens
+   */
+  static constexpr bool scan(std::string_view expr, Lexer::Token &last_token, ExpressionParserErrors::ErrorInfo &error)
+  {
+    size_t invalid_count = 0;
+    size_t first_invalid_position = 0;
+    for (size_t position = 0; position < expr.size(); position++)
+    {
+      if (Lexer::isInvalidCharacter(expr[position], false) && invalid_count++ == 0)
+      {
+        first_invalid_position = position;
+      }
+    }
+
+    if (invalid_count != 0)
+    {
+      error.count = invalid_count;
+      return fail(ExpressionParserErrors::ErrorKind::InvalidToken, expr.substr(first_invalid_position, 1),
+                  first_invalid_position, error);
+    }
+
+    bool any_token = false;
+    for (size_t position = 0;;)
+    {
+      const Lexer::Token token = nextToken(expr, position);
+      if (token.operation == Lexer::TokenOperation::None)
+      {
+        break;
+      }
+
+      if (token.operation == Lexer::TokenOperation::Literal && token.value == TOKEN_VALUE_NOT_APPLICABLE)
+      {
+        return fail(ExpressionParserErrors::ErrorKind::LiteralOutOfRange, {}, 0, error);
+      }
+
+      last_token = token;
+      any_token = true;
+    }
+
+    return any_token || fail(ExpressionParserErrors::ErrorKind::EmptyExpression, {}, 0, error);
+  }
+
+  /*
+   * Next Token
+   *
+   * Reads the token following a position of an expression known to hold only valid characters
+   *
+   * @param expr View of the expression
+   * @param position Offset to read from; advanced past the token
+   * @return The token, with operation None at the end of the expression. A literal too large to be represented has
+   *         the value TOKEN_VALUE_NOT_APPLICABLE.
+   */
+  static constexpr Lexer::Token nextToken(std::string_view expr, size_t &position)
+  {
+    while (position < expr.size() && expr[position] == ' ')
+    {
+      position++;
+    }
+
+    Lexer::Token token{.operation = Lexer::TokenOperation::None, .value = TOKEN_VALUE_NOT_APPLICABLE, .raw = {},
+                       .position = position};
+    if (position == expr.size())
+    {
+      return token;
+    }
+
+    switch (expr[position])
+    {
+    case '(': token.operation = Lexer::TokenOperation::L_Brace; break;
+    case ')': token.operation = Lexer::TokenOperation::R_Brace; break;
+    case '-': token.operation = Lexer::TokenOperation::Subtraction; break;
+    case '+': token.operation = Lexer::TokenOperation::Addition; break;
+    case '*': token.operation = Lexer::TokenOperation::Multiplication; break;
+    case '/': token.operation = Lexer::TokenOperation::Division; break;
+    default:
+    {
+      token.operation = Lexer::TokenOperation::Literal;
+      token.value = 0;
+      while (position < expr.size() && Lexer::isDigit(expr[position]))
+      {
+        const int digit = expr[position] - '0';
+        if (token.value != TOKEN_VALUE_NOT_APPLICABLE && token.value > (std::numeric_limits<int>::max() - digit) / 10)
+        {
+          token.value = TOKEN_VALUE_NOT_APPLICABLE;
+        }
+        else if (token.value != TOKEN_VALUE_NOT_APPLICABLE)
+        {
+          token.value = token.value * 10 + digit;
+        }
+        position++;
+      }
+
+      token.raw = expr.substr(token.position, position - token.position);
+      return token;
+    }
+    }
+
+    token.raw = expr.substr(position++, 1);
+    return token;
+  }
+
+  /*
+   * Fail
+   *
+   * @param kind What went wrong
+   * @param token The offending token's characters
+   * @param position Zero-based offset of the offending token within the expression
+   * @param error Receives the failure
+   * @return False, for the caller to return
+   */
+  static constexpr bool fail(ExpressionParserErrors::ErrorKind kind, std::string_view token, size_t position,
+                             ExpressionParserErrors::ErrorInfo &error)
+  {
+    error.kind = kind;
+    error.token = token;
+    error.position = position;
+    return false;
+  }
+};
\ No newline at end of file
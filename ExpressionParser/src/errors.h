@@ -4,8 +4,11 @@
  */
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace ExpressionParserErrors
@@ -19,24 +22,112 @@ namespace ExpressionParserErrors
   class InvalidTokenException : public LexerException
   {
   public:
-    InvalidTokenException(const std::vector<std::string> &tokens) : LexerException(build_error_details(tokens)) {}
+    InvalidTokenException(const std::vector<std::string> &tokens) : InvalidTokenException(tokens, {}) {}
+
+    InvalidTokenException(const std::vector<std::string> &tokens, const std::vector<size_t> &positions)
+        : LexerException(summary), details(std::make_shared<Details>())
+    {
+      details->tokens = tokens;
+      details->positions = positions;
+    }
+
+    /*
+     * Invalid Token Exception Constructor
+     *
+     * Records the invalid characters without describing them; the message listing them is only built if what() is
+     * called, so rejecting an expression costs two allocations however many characters it holds
+     *
+     * @param characters The invalid characters, in the order they were found
+     * @param positions Zero-based offset into the expression of each character
+     * @param truncated True if the expression was not scanned beyond the last character (see ErrorInfo::truncated)
+     */
+    InvalidTokenException(std::string characters, std::vector<size_t> positions, bool truncated)
+        : LexerException(summary), details(std::make_shared<Details>())
+    {
+      details->characters = std::move(characters);
+      details->positions = std::move(positions);
+      details->truncated = truncated;
+    }
+
+    /*
+     * What
+     *
+     * @return The message listing every invalid token, built on the first call
+     */
+    const char *what() const noexcept override
+    {
+      try
+      {
+        std::call_once(details->built, [this] { details->message = build_error_details(*details); });
+        return details->message.c_str();
+      }
+      catch (...)
+      {
+        /* The list could not be allocated; fall back to the summary */
+        return LexerException::what();
+      }
+    }
+
+    /*
+     * Get Positions
+     *
+     * @return Zero-based offsets into the expression of each invalid token, in the order they were found
+     */
+    const std::vector<size_t> &getPositions() const { return details->positions; }
+
+    /*
+     * Is Truncated
+     *
+     * @return True if lexing stopped at the invalid token limit, so the expression may hold more invalid tokens
+     */
+    bool isTruncated() const { return details->truncated; }
 
   private:
+    static constexpr const char *summary = "Invalid token(s) detected in expression";
+
+    /*
+     * Invalid Token Details
+     *
+     * The invalid tokens, either as strings or as one character each, and the message describing them once built.
+     * Shared between copies of the exception, so copying it as it is thrown and caught costs nothing.
+     */
+    struct Details
+    {
+      std::vector<std::string> tokens;
+      std::string characters;
+      std::vector<size_t> positions;
+      bool truncated = false;
+      std::once_flag built;
+      std::string message;
+    };
+
     /*
      * Build Error Details
      *
-     * @param tokens A reference to a list of the invalid tokens found
+     * @param details The invalid tokens found
      * @return An error message with the invalid tokens concatenated
      */
-    static std::string build_error_details(const std::vector<std::string> &tokens)
+    static std::string build_error_details(const Details &details)
     {
-      std::string error_message = "Invalid token(s) detected in expression : ";
-      for (const std::string &raw_token : tokens)
+      std::string error_message = std::string("Lexer:: ") + summary + " : ";
+      for (const std::string &raw_token : details.tokens)
       {
         error_message += raw_token + ",";
       }
+      for (const char character : details.characters)
+      {
+        error_message += character;
+        error_message += ',';
+      }
+      if (details.truncated)
+      {
+        error_message += "...";
+      }
       return error_message;
     }
+
+    /* The invalid tokens and their positions within the expression */
+    std::shared_ptr<Details> details;
   };
 
   class EmptyExpressionException : public LexerException
@@ -75,10 +166,53 @@ namespace ExpressionParserErrors
     DivideByZeroException() : RDParserException("Division by zero") {}
   };
 
+  class OverflowException : public RDParserException
+  {
+  public:
+    OverflowException() : RDParserException("Arithmetic overflow") {}
+  };
+
   class UnexpectedTokenException : public RDParserException
   {
   public:
-    UnexpectedTokenException(const std::string &token) : RDParserException("Unexpected token encountered: " + token) {}
+    UnexpectedTokenException(std::string_view token, size_t position)
+        : RDParserException("Unexpected token encountered: " + std::string(token) + " at column " +
+                            std::to_string(position + 1)),
+          position(position)
+    {
+    }
+
+    /*
+     * Get Position
+     *
+     * @return Zero-based offset of the unexpected token within the expression
+     */
+    size_t getPosition() const { return position; }
+
+  private:
+    /* Position of the unexpected token within the expression */
+    size_t position;
+  };
+
+  class NestingTooDeepException : public RDParserException
+  {
+  public:
+    NestingTooDeepException(size_t position)
+        : RDParserException("Parentheses nested too deeply at column " + std::to_string(position + 1)),
+          position(position)
+    {
+    }
+
+    /*
+     * Get Position
+     *
+     * @return Zero-based offset of the first parenthesis beyond the permitted depth
+     */
+    size_t getPosition() const { return position; }
+
+  private:
+    /* Position of the first parenthesis beyond the permitted depth */
+    size_t position;
   };
 
   class UnknownOperatorException : public RDParserException
@@ -87,4 +221,25 @@ namespace ExpressionParserErrors
     UnknownOperatorException() : RDParserException("Unknown operator") {}
   };
 
+  class UnknownVariableException : public RDParserException
+  {
+  public:
+    UnknownVariableException(std::string_view name) : RDParserException("Unknown variable: " + std::string(name)) {}
+  };
+
+  class UnboundVariableException : public RDParserException
+  {
+  public:
+    UnboundVariableException(std::string_view name)
+        : RDParserException("No value bound to variable: " + std::string(name))
+    {
+    }
+  };
+
+  class CatalogueFormatException : public std::runtime_error
+  {
+  public:
+    CatalogueFormatException(const std::string &message) : std::runtime_error("ExpressionCatalogue:: " + message) {}
+  };
+
 }
\ No newline at end of file
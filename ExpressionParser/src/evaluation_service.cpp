@@ -0,0 +1,361 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "evaluation_service.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <utility>
+
+/*
+ * Evaluation Service Constructor
+ *
+ * Creates a service with the default options
+ */
+EvaluationService::EvaluationService() : EvaluationService(Options()) {}
+
+/*
+ * Evaluation Service Constructor
+ *
+ * Starts the dispatcher, which sleeps until the first request is submitted
+ *
+ * @param options Batching limits, thread count and cache configuration
+ */
+EvaluationService::EvaluationService(const Options &options)
+    : options(options), cache(options.cache_budget, RDParser(options.parser_options)), engine(options.thread_count),
+      stopping(false), completed(0)
+{
+  this->options.batch_size = std::max<size_t>(options.batch_size, 1);
+  dispatcher = std::thread(&EvaluationService::dispatchLoop, this);
+}
+
+/*
+ * Evaluation Service Destructor
+ *
+ * Completes every request already submitted, without waiting for their batches to fill, and stops the dispatcher
+ */
+EvaluationService::~EvaluationService()
+{
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  dispatcher.join();
+}
+
+/*
+ * Submit
+ *
+ * Queues an expression for evaluation
+ *
+ * @param expression The expression to evaluate
+ * @param bindings Value of each variable, indexed by slot; variables are assigned slots in order of first appearance
+ * @return Future receiving the result, or the exception from errors.h matching the failure
+ */
+std::future<int> EvaluationService::Submit(std::string expression, std::vector<int> bindings)
+{
+  std::promise<int> promise;
+  std::future<int> future = promise.get_future();
+  enqueue(Request{.expression = std::move(expression), .bindings = std::move(bindings),
+                  .completion = std::move(promise), .submitted = {}});
+  return future;
+}
+
+/*
+ * Submit
+ *
+ * Queues an expression for evaluation, reporting the outcome through a callback instead of a future
+ *
+ * @param expression The expression to evaluate
+ * @param bindings Value of each variable, indexed by slot; variables are assigned slots in order of first appearance
+ * @param callback Called on the dispatcher thread with the result, or a description of the failure
+ */
+void EvaluationService::Submit(std::string expression, std::vector<int> bindings, Callback callback)
+{
+  enqueue(Request{.expression = std::move(expression), .bindings = std::move(bindings),
+                  .completion = std::move(callback), .submitted = {}});
+}
+
+/*
+ * Get Statistics
+ *
+ * @return Counts of the requests submitted and the batches and jobs run so far
+ */
+EvaluationService::Statistics EvaluationService::getStatistics() const
+{
+  std::lock_guard<std::mutex> lock(state_mutex);
+  return statistics;
+}
+
+/*
+ * Get Cache Statistics
+ *
+ * @return Counters of the cache compiling the service's expressions
+ */
+ExpressionCache::Statistics EvaluationService::getCacheStatistics() const
+{
+  return cache.getStatistics();
+}
+
+/*
+ * Enqueue
+ *
+ * Adds a request to the queue, waking the dispatcher when the request starts a batch, whose latency limit is timed
+ * from it, or fills one
+ *
+ * @param request The request to queue
+ */
+void EvaluationService::enqueue(Request request)
+{
+  bool wake_dispatcher;
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    request.submitted = std::chrono::steady_clock::now();
+    pending.push_back(std::move(request));
+    statistics.requests++;
+    wake_dispatcher = pending.size() == 1 || pending.size() == options.batch_size;
+  }
+
+  if (wake_dispatcher)
+  {
+    wake.notify_one();
+  }
+}
+
+/*
+ * Dispatch Loop
+ *
+ * Body of the dispatcher thread. Waits for the oldest queued request's batch to fill or its latency limit to pass,
+ * then takes up to batch_size requests from the queue and evaluates them while further requests are queued.
+ */
+void EvaluationService::dispatchLoop()
+{
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(state_mutex);
+      wake.wait(lock, [this] { return stopping || !pending.empty(); });
+      if (pending.empty())
+      {
+        return;
+      }
+
+      const std::chrono::steady_clock::time_point deadline = pending.front().submitted + options.max_latency;
+      wake.wait_until(lock, deadline, [this] { return stopping || pending.size() >= options.batch_size; });
+
+      const size_t count = std::min(pending.size(), options.batch_size);
+      batch.clear();
+      for (size_t request = 0; request < count; request++)
+      {
+        batch.push_back(std::move(pending.front()));
+        pending.pop_front();
+      }
+      statistics.batches++;
+    }
+
+    try
+    {
+      evaluateBatch();
+    }
+    catch (...)
+    {
+      failBatch(std::current_exception());
+    }
+  }
+}
+
+/*
+ * Evaluate Batch
+ *
+ * Groups the batch's requests by expression, compiles each group's expression through the cache and evaluates
+ * every group as one job of rows, then completes the requests in the order they were submitted
+ */
+void EvaluationService::evaluateBatch()
+{
+  constexpr size_t unbatched = std::numeric_limits<size_t>::max();
+
+  completed = 0;
+  group_index.clear();
+  groups.clear();
+  request_groups.resize(batch.size());
+  request_rows.resize(batch.size());
+
+  /* Compile each distinct expression and count the rows of its job */
+  for (size_t request = 0; request < batch.size(); request++)
+  {
+    const auto [entry, inserted] = group_index.try_emplace(batch[request].expression, groups.size());
+    if (inserted)
+    {
+      groups.push_back(Group{.compiled = cache.Get(batch[request].expression)});
+    }
+
+    Group &group = groups[entry->second];
+    request_groups[request] = entry->second;
+    request_rows[request] = unbatched;
+    if (group.compiled && batch[request].bindings.size() >= group.compiled.getValue().getVariableCount())
+    {
+      request_rows[request] = group.row_count++;
+    }
+  }
+
+  /* Lay out the rows and columns of every job, one group after another */
+  size_t row_count = 0;
+  size_t column_count = 0;
+  size_t value_count = 0;
+  for (Group &group : groups)
+  {
+    if (group.row_count == 0)
+    {
+      continue;
+    }
+
+    group.first_row = row_count;
+    group.first_column = column_count;
+    group.first_value = value_count;
+    const size_t variable_count = group.compiled.getValue().getVariableCount();
+    row_count += group.row_count;
+    column_count += variable_count;
+    value_count += variable_count * group.row_count;
+  }
+
+  values.resize(value_count);
+  columns.resize(column_count);
+  results.resize(row_count);
+  error_mask.resize(row_count);
+
+  /* Transpose each request's bindings into its job's columns */
+  for (size_t request = 0; request < batch.size(); request++)
+  {
+    if (request_rows[request] == unbatched)
+    {
+      continue;
+    }
+
+    const Group &group = groups[request_groups[request]];
+    const size_t variable_count = group.compiled.getValue().getVariableCount();
+    for (size_t slot = 0; slot < variable_count; slot++)
+    {
+      values[group.first_value + slot * group.row_count + request_rows[request]] = batch[request].bindings[slot];
+    }
+  }
+
+  jobs.clear();
+  for (const Group &group : groups)
+  {
+    if (group.row_count == 0)
+    {
+      continue;
+    }
+
+    const CompiledExpression &compiled = group.compiled.getValue();
+    for (size_t slot = 0; slot < compiled.getVariableCount(); slot++)
+    {
+      columns[group.first_column + slot] = values.data() + group.first_value + slot * group.row_count;
+    }
+    jobs.push_back(BatchEngine::Job{.expression = &compiled,
+                                    .columns = std::span<const int *const>(columns.data() + group.first_column,
+                                                                           compiled.getVariableCount()),
+                                    .row_count = group.row_count,
+                                    .results = results.data() + group.first_row,
+                                    .error_mask = error_mask.data() + group.first_row,
+                                    .chunk_errors = nullptr});
+  }
+
+  if (!jobs.empty())
+  {
+    engine.Run(jobs);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    statistics.jobs += jobs.size();
+  }
+
+  for (; completed < batch.size(); completed++)
+  {
+    const size_t request = completed;
+    const Group &group = groups[request_groups[request]];
+    if (!group.compiled)
+    {
+      complete(batch[request], group.compiled.getError());
+      continue;
+    }
+
+    /* Requests left out of the job, and rows which failed, are evaluated on their own for their exact error */
+    const size_t row = request_rows[request];
+    if (row == unbatched || error_mask[group.first_row + row] != 0)
+    {
+      complete(batch[request], group.compiled.getValue().TryEvaluate(batch[request].bindings));
+      continue;
+    }
+
+    complete(batch[request], results[group.first_row + row]);
+  }
+
+  /* Release the requests' buffers and completions now rather than when the next batch arrives */
+  batch.clear();
+}
+
+/*
+ * Fail Batch
+ *
+ * Fails the requests of a batch which had not been completed when its evaluation threw. Futures receive the
+ * exception; callbacks cannot be given it and are not called.
+ *
+ * @param exception The exception thrown while evaluating the batch
+ */
+void EvaluationService::failBatch(std::exception_ptr exception)
+{
+  for (; completed < batch.size(); completed++)
+  {
+    if (std::promise<int> *promise = std::get_if<std::promise<int>>(&batch[completed].completion))
+    {
+      promise->set_exception(exception);
+    }
+  }
+
+  batch.clear();
+}
+
+/*
+ * Complete
+ *
+ * Delivers the outcome of a request to its future or callback. An exception thrown by the callback is discarded.
+ *
+ * @param request The completed request
+ * @param result Result of the request, or a description of its failure
+ */
+void EvaluationService::complete(Request &request, const Result<int> &result)
+{
+  if (Callback *callback = std::get_if<Callback>(&request.completion))
+  {
+    try
+    {
+      (*callback)(result);
+    }
+    catch (...)
+    {
+      /* There is nowhere to report it, and the rest of the batch must still be completed */
+    }
+    return;
+  }
+
+  std::promise<int> &promise = std::get<std::promise<int>>(request.completion);
+  if (result)
+  {
+    promise.set_value(result.getValue());
+    return;
+  }
+
+  try
+  {
+    result.getError().Throw();
+  }
+  catch (...)
+  {
+    promise.set_exception(std::current_exception());
+  }
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "batch_engine.h"
+#include "compiled_expression.h"
+#include "expression_cache.h"
+#include "rd_parser.h"
+#include "result.h"
+
+#define EVALUATION_SERVICE_BATCH_SIZE 256
+#define EVALUATION_SERVICE_MAX_LATENCY_US 200
+
+/*
+ * Evaluation Service
+ *
+ * An asynchronous front-end for many small evaluation requests, such as those received by a server. Submit queues an
+ * expression and the values of its variables and returns at once; a dispatcher thread collects the queued requests
+ * into micro-batches and completes each one through a future or a callback.
+ *
+ * A batch is dispatched as soon as it holds batch_size requests, or once its oldest request has waited max_latency:
+ * larger batches share more of the work between requests, while the latency limit bounds how long a request waits
+ * when traffic is light. The distinct expressions of a batch are compiled through an ExpressionCache, so repeated
+ * expressions are only parsed once, and the requests for each expression become the rows of one BatchEngine job,
+ * their bindings transposed into columns. Every job of the batch is then evaluated in one run of the engine.
+ *
+ * Results and errors are those of CompiledExpression::TryEvaluate on the request's bindings; a malformed expression
+ * fails with the error its compilation reports. Completions run on the dispatcher thread, in submission order, and
+ * the next batch waits for them, so callbacks should return quickly; an exception thrown by a callback is discarded
+ * so that the rest of the batch is still completed. If a batch cannot be evaluated at all, such as when memory runs
+ * out, the futures of its outstanding requests receive that exception and their callbacks are not called. Destroying
+ * the service completes every request already submitted.
+ */
+class EvaluationService
+{
+public:
+  /*
+   * Service Options
+   *
+   * Configuration of a service
+   */
+  struct Options
+  {
+    /* Number of queued requests at which a batch is dispatched without waiting any longer */
+    size_t batch_size = EVALUATION_SERVICE_BATCH_SIZE;
+
+    /* Longest a request waits for its batch to fill; zero dispatches whatever has arrived straight away */
+    std::chrono::microseconds max_latency{EVALUATION_SERVICE_MAX_LATENCY_US};
+
+    /* Number of threads evaluating batches, including the dispatcher; zero uses one per core */
+    size_t thread_count = 0;
+
+    /* Memory budget of the expression cache, and the parser compiling the expressions it does not hold */
+    size_t cache_budget = EXPRESSION_CACHE_DEFAULT_BUDGET;
+    RDParser::Options parser_options;
+  };
+
+  /*
+   * Service Statistics
+   *
+   * Counters since the service was created
+   */
+  struct Statistics
+  {
+    size_t requests = 0;
+    size_t batches = 0;
+
+    /* Engine jobs run; one per distinct, well-formed expression of each batch */
+    size_t jobs = 0;
+  };
+
+  /* Receives the outcome of a request. The views held by an error are only valid for the duration of the call. */
+  using Callback = std::function<void(const Result<int> &)>;
+
+  EvaluationService();
+
+  explicit EvaluationService(const Options &options);
+
+  EvaluationService(const EvaluationService &) = delete;
+  EvaluationService &operator=(const EvaluationService &) = delete;
+
+  ~EvaluationService();
+
+  std::future<int> Submit(std::string expression, std::vector<int> bindings = {});
+
+  void Submit(std::string expression, std::vector<int> bindings, Callback callback);
+
+  Statistics getStatistics() const;
+
+  ExpressionCache::Statistics getCacheStatistics() const;
+
+private:
+  /*
+   * Request
+   *
+   * A queued expression, the values of its variables indexed by slot, and how its outcome is delivered
+   */
+  struct Request
+  {
+    std::string expression;
+    std::vector<int> bindings;
+    std::variant<std::promise<int>, Callback> completion;
+    std::chrono::steady_clock::time_point submitted;
+  };
+
+  /*
+   * Batch Group
+   *
+   * The requests of a batch sharing one expression, and where the job evaluating them keeps its rows. Requests with
+   * too few bindings to be evaluated are left out of the job.
+   */
+  struct Group
+  {
+    Result<CompiledExpression> compiled;
+    size_t row_count = 0;
+    size_t first_row = 0;
+    size_t first_column = 0;
+    size_t first_value = 0;
+  };
+
+  void enqueue(Request request);
+
+  void dispatchLoop();
+
+  void evaluateBatch();
+
+  void failBatch(std::exception_ptr exception);
+
+  static void complete(Request &request, const Result<int> &result);
+
+  Options options;
+
+  /* Compiles each distinct expression once, and evaluates the batches */
+  ExpressionCache cache;
+  BatchEngine engine;
+
+  /* Guards the queue and the statistics */
+  mutable std::mutex state_mutex;
+  std::condition_variable wake;
+  std::deque<Request> pending;
+  Statistics statistics;
+  bool stopping;
+
+  /* The batch being evaluated and its scratch space, only used by the dispatcher and reused between batches. Each
+     request's group and row (SIZE_MAX if it is evaluated on its own) are kept alongside it. */
+  std::vector<Request> batch;
+  size_t completed;
+  std::vector<size_t> request_groups;
+  std::vector<size_t> request_rows;
+  std::unordered_map<std::string_view, size_t> group_index;
+  std::vector<Group> groups;
+  std::vector<BatchEngine::Job> jobs;
+  std::vector<int> values;
+  std::vector<const int *> columns;
+  std::vector<int> results;
+  std::vector<uint8_t> error_mask;
+
+  /* Forms and evaluates batches; started last, once everything it uses has been constructed */
+  std::thread dispatcher;
+};
\ No newline at end of file
@@ -0,0 +1,278 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "expression_cache.h"
+#include "lexer.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+
+/*
+ * For Each Kept Character
+ *
+ * Visits the characters of an expression that survive normalisation, in order. A run of spaces is kept as a single
+ * space only where it separates two characters that would otherwise merge into one literal or identifier.
+ *
+ * @param expr The expression to normalise
+ * @param visit Called with the offset of each kept character within expr and the character itself
+ */
+template <typename Visitor> static void forEachKept(std::string_view expr, Visitor visit)
+{
+  char previous = ' ';
+  size_t space_position = 0;
+  bool space_pending = false;
+
+  for (size_t position = 0; position < expr.size(); position++)
+  {
+    const char character = expr[position];
+    if (character == ' ')
+    {
+      if (!space_pending)
+      {
+        space_pending = true;
+        space_position = position;
+      }
+      continue;
+    }
+
+    if (space_pending && Lexer::isWordCharacter(previous) && Lexer::isWordCharacter(character))
+    {
+      visit(space_position, ' ');
+    }
+
+    space_pending = false;
+    visit(position, character);
+    previous = character;
+  }
+}
+
+/*
+ * Expression Cache Constructor
+ *
+ * @param memory_budget Approximate number of bytes the cache may hold, shared evenly between the shards
+ * @param parser Compiles expressions missing from the cache; only its options are used
+ * @param shard_count Number of independently locked shards
+ * @param native_threshold Lookups of an entry after which it is translated to native code; zero never translates
+ */
+ExpressionCache::ExpressionCache(size_t memory_budget, const RDParser &parser, size_t shard_count,
+                                 size_t native_threshold)
+    : parser(parser), native_threshold(native_threshold), shard_count(std::max<size_t>(shard_count, 1))
+{
+  shard_budget = memory_budget / this->shard_count;
+  shards = std::make_unique<Shard[]>(this->shard_count);
+}
+
+/*
+ * Get
+ *
+ * Looks an expression up, compiling and caching it if it is missing. Variables are assigned slots in order of first
+ * appearance (see RDParser::TryCompile). A cached error is reported against the text passed in now, so that its
+ * positions are correct even if the cached expression was spaced differently.
+ *
+ * @param expr View of the expression. It is not copied unless the expression is added to the cache.
+ * @return The compiled expression, or a description of the failure
+ */
+Result<CompiledExpression> ExpressionCache::Get(std::string_view expr)
+{
+  /* Reused between calls so that normalising a key never allocates once the buffer has grown */
+  thread_local std::string key;
+  Normalise(expr, key);
+
+  Shard &shard = shards[std::hash<std::string_view>{}(key) % shard_count];
+  std::optional<CompiledExpression> hot;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto existing = shard.index.find(key);
+    if (existing != shard.index.end())
+    {
+      Entry &entry = *existing->second;
+      shard.hits++;
+      shard.entries.splice(shard.entries.begin(), shard.entries, existing->second);
+      if (++entry.lookups != native_threshold || !entry.result)
+      {
+        return rebase(entry.result, expr);
+      }
+      hot = entry.result.getValue();
+    }
+    else
+    {
+      shard.misses++;
+    }
+  }
+
+  if (hot)
+  {
+    /* The entry has just become hot. Translate it outside the lock; every handle to it shares the machine code. */
+    if (hot->CompileNative())
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.native_compilations++;
+    }
+    return *hot;
+  }
+
+  /* Compile without holding the lock so that lookups of other expressions in this shard are not held up */
+  return rebase(insert(shard, key, parser.TryCompile(key)), expr);
+}
+
+/*
+ * Get Statistics
+ *
+ * @return Counters summed over every shard
+ */
+ExpressionCache::Statistics ExpressionCache::getStatistics() const
+{
+  Statistics statistics;
+  for (size_t shard_idx = 0; shard_idx < shard_count; shard_idx++)
+  {
+    Shard &shard = shards[shard_idx];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    statistics.hits += shard.hits;
+    statistics.misses += shard.misses;
+    statistics.evictions += shard.evictions;
+    statistics.entries += shard.entries.size();
+    statistics.memory_usage += shard.memory_usage;
+    statistics.native_compilations += shard.native_compilations;
+  }
+  return statistics;
+}
+
+/*
+ * Clear
+ *
+ * Removes every entry. Counters are kept, and handles already returned remain valid.
+ */
+void ExpressionCache::Clear()
+{
+  for (size_t shard_idx = 0; shard_idx < shard_count; shard_idx++)
+  {
+    Shard &shard = shards[shard_idx];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.index.clear();
+    shard.entries.clear();
+    shard.memory_usage = 0;
+  }
+}
+
+/*
+ * Normalise
+ *
+ * Builds the cache key of an expression (see forEachKept)
+ *
+ * @param expr The expression to normalise
+ * @param key Receives the normalised expression; its previous contents are replaced
+ */
+void ExpressionCache::Normalise(std::string_view expr, std::string &key)
+{
+  key.clear();
+  forEachKept(expr, [&key](size_t, char character) { key.push_back(character); });
+}
+
+/*
+ * Insert
+ *
+ * Adds a newly compiled result to a shard, evicting the least recently used entries while the shard is over its
+ * budget. If another thread added the same key in the meantime, its entry is kept instead.
+ *
+ * @param shard The shard the key belongs to
+ * @param key The normalised expression
+ * @param result The result of compiling the key; the views of an error refer into key
+ * @return The cached result, whose views refer into the cache entry
+ */
+Result<CompiledExpression> ExpressionCache::insert(Shard &shard, std::string_view key,
+                                                   Result<CompiledExpression> result)
+{
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto existing = shard.index.find(key);
+  if (existing != shard.index.end())
+  {
+    return existing->second->result;
+  }
+
+  size_t memory_usage = sizeof(Entry) + sizeof(std::pair<std::string_view, std::list<Entry>::iterator>) + key.size();
+  if (result)
+  {
+    memory_usage += result.getValue().getMemoryUsage();
+  }
+
+  if (memory_usage > shard_budget)
+  {
+    /* Too large to ever be cached; the caller still receives the result */
+    return result;
+  }
+
+  shard.entries.push_front(Entry{.key = std::string(key), .result = std::move(result), .memory_usage = memory_usage});
+  Entry &entry = shard.entries.front();
+  if (!entry.result)
+  {
+    /* Point the error's views at the entry's own copy of the key */
+    entry.result = rebase(entry.result, entry.key);
+  }
+  shard.index.emplace(entry.key, shard.entries.begin());
+  shard.memory_usage += memory_usage;
+
+  while (shard.memory_usage > shard_budget)
+  {
+    const Entry &oldest = shard.entries.back();
+    shard.memory_usage -= oldest.memory_usage;
+    shard.index.erase(oldest.key);
+    shard.entries.pop_back();
+    shard.evictions++;
+  }
+
+  return entry.result;
+}
+
+/*
+ * Rebase
+ *
+ * Moves the views of an error onto another spelling of the same normalised expression
+ *
+ * @param result A cached result; successful results are returned unchanged
+ * @param expr The expression the error should refer to
+ * @return The result, with any error's position, token and expression referring into expr
+ */
+Result<CompiledExpression> ExpressionCache::rebase(const Result<CompiledExpression> &result, std::string_view expr)
+{
+  if (result)
+  {
+    return result;
+  }
+
+  ExpressionParserErrors::ErrorInfo error = result.getError();
+
+  /* Failures found during evaluation or optimisation are not tied to a character */
+  if (error.position != 0 || !error.token.empty())
+  {
+    error.position = mapPosition(expr, error.position);
+    error.token = error.token.empty() ? std::string_view() : expr.substr(error.position, error.token.size());
+  }
+  error.expression = expr;
+
+  return error;
+}
+
+/*
+ * Map Position
+ *
+ * @param expr An expression
+ * @param normalised_position Offset of a character within the normalised form of expr
+ * @return Offset of the same character within expr; the end of expr for the end of the normalised form
+ */
+size_t ExpressionCache::mapPosition(std::string_view expr, size_t normalised_position)
+{
+  size_t position = expr.size();
+  size_t kept = 0;
+  forEachKept(expr,
+              [&](size_t offset, char)
+              {
+                if (kept++ == normalised_position)
+                {
+                  position = offset;
+                }
+              });
+  return position;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "compiled_expression.h"
+#include "rd_parser.h"
+#include "result.h"
+
+#define EXPRESSION_CACHE_DEFAULT_BUDGET (16 * 1024 * 1024)
+#define EXPRESSION_CACHE_SHARD_COUNT 16
+
+/*
+ * Expression Cache
+ *
+ * Maps expression text onto its compiled expression so that repeated expressions are lexed and parsed once. Keys
+ * are normalised by dropping every space that does not separate two literals or identifiers, so expressions which
+ * only differ in spacing share an entry. Malformed expressions are cached too, and a repeated bad input costs a
+ * lookup rather than a parse.
+ *
+ * The cache is split into shards by key hash, each with its own lock and least-recently-used list, so concurrent
+ * lookups of different expressions rarely contend. Each shard evicts its least recently used entries once its share
+ * of the memory budget is exceeded.
+ *
+ * An entry looked up native_threshold times is translated to machine code (see CompiledExpression::CompileNative),
+ * so only an application's hottest expressions pay for translation. The machine code is not counted against the
+ * memory budget. Where native code is unsupported the entry keeps using the interpreter.
+ */
+class ExpressionCache
+{
+public:
+  /*
+   * Cache Statistics
+   *
+   * Counters summed over every shard
+   */
+  struct Statistics
+  {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t entries = 0;
+    size_t memory_usage = 0;
+    size_t native_compilations = 0;
+  };
+
+  explicit ExpressionCache(size_t memory_budget = EXPRESSION_CACHE_DEFAULT_BUDGET, const RDParser &parser = RDParser(),
+                           size_t shard_count = EXPRESSION_CACHE_SHARD_COUNT, size_t native_threshold = 0);
+
+  Result<CompiledExpression> Get(std::string_view expr);
+
+  Statistics getStatistics() const;
+
+  void Clear();
+
+  static void Normalise(std::string_view expr, std::string &key);
+
+private:
+  /*
+   * Cache Entry
+   *
+   * A normalised key and the result of compiling it. The views held by a cached error refer into the key.
+   */
+  struct Entry
+  {
+    std::string key;
+    Result<CompiledExpression> result;
+    size_t memory_usage;
+
+    /* Number of lookups which found the entry */
+    size_t lookups = 0;
+  };
+
+  /*
+   * Cache Shard
+   *
+   * One independently locked part of the cache. Entries are kept in recency order, most recent first, and the map
+   * (keyed by views of the entries' own keys) finds them by key.
+   */
+  struct alignas(64) Shard
+  {
+    std::mutex mutex;
+    std::list<Entry> entries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    size_t memory_usage = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t native_compilations = 0;
+  };
+
+  Result<CompiledExpression> insert(Shard &shard, std::string_view key, Result<CompiledExpression> result);
+
+  static Result<CompiledExpression> rebase(const Result<CompiledExpression> &result, std::string_view expr);
+
+  static size_t mapPosition(std::string_view expr, size_t normalised_position);
+
+  /* Compiles the expressions missing from the cache */
+  RDParser parser;
+
+  /* Memory each shard may use before evicting */
+  size_t shard_budget;
+
+  /* Lookups of an entry after which it is translated to native code; zero never translates */
+  size_t native_threshold;
+
+  std::unique_ptr<Shard[]> shards;
+  size_t shard_count;
+};
\ No newline at end of file
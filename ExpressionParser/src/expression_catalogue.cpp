@@ -0,0 +1,569 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "expression_catalogue.h"
+#include "errors.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+/* Written at the start of every catalogue image */
+static constexpr char CATALOGUE_MAGIC[8] = {'R', 'D', 'P', 'C', 'A', 'T', 'L', 'G'};
+
+/* Read back as this value only on a machine of the byte order which wrote it */
+static constexpr uint32_t CATALOGUE_BYTE_ORDER = 0x01020304;
+
+/*
+ * Catalogue Header
+ *
+ * The start of an image. Counts are of elements, not bytes.
+ */
+struct ExpressionCatalogue::Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t expression_count;
+  uint32_t variable_count;
+  uint32_t instruction_count;
+  uint32_t string_bytes;
+};
+
+/*
+ * Catalogue Record
+ *
+ * One expression: ranges of the instruction and name sections, and its source text within the strings
+ */
+struct ExpressionCatalogue::Record
+{
+  uint32_t first_instruction;
+  uint32_t instruction_count;
+  uint32_t max_stack_depth;
+  uint32_t first_variable;
+  uint32_t variable_count;
+  uint32_t expression_offset;
+  uint32_t expression_length;
+  uint32_t reserved;
+};
+
+/*
+ * Catalogue Name
+ *
+ * One variable's name within the strings
+ */
+struct ExpressionCatalogue::Name
+{
+  uint32_t offset;
+  uint32_t length;
+};
+
+/*
+ * Append
+ *
+ * Copies a value's bytes into an image
+ *
+ * @param image The image being written
+ * @param offset Offset within the image to copy to; advanced past the value
+ * @param value The value to copy
+ */
+template <typename T> static void append(std::string &image, size_t &offset, const T &value)
+{
+  std::memcpy(image.data() + offset, &value, sizeof(T));
+  offset += sizeof(T);
+}
+
+/*
+ * Add
+ *
+ * Adds an expression to the catalogue. It is stored after every expression added before it, and is found by that
+ * index once the catalogue is loaded.
+ *
+ * @param expression The expression's source text, which is stored alongside it
+ * @param compiled The expression compiled from that text
+ */
+void ExpressionCatalogue::Builder::Add(std::string_view expression, const CompiledExpression &compiled)
+{
+  expressions.emplace_back(expression);
+  this->compiled.push_back(compiled);
+}
+
+/*
+ * Get Expression Count
+ *
+ * @return Number of expressions added so far
+ */
+size_t ExpressionCatalogue::Builder::getExpressionCount() const
+{
+  return expressions.size();
+}
+
+/*
+ * Serialise
+ *
+ * Lays the expressions out as a catalogue image. Throws CatalogueFormatException if a section would hold more than
+ * 2^32 - 1 elements or bytes.
+ *
+ * @return The image, ready to be written to a file or loaded directly
+ */
+std::string ExpressionCatalogue::Builder::Serialise() const
+{
+  uint64_t variable_count = 0;
+  uint64_t instruction_count = 0;
+  uint64_t string_bytes = 0;
+  for (size_t index = 0; index < compiled.size(); index++)
+  {
+    variable_count += compiled[index].getVariableCount();
+    instruction_count += programOf(compiled[index]).bytecode.getInstructions().size();
+    string_bytes += expressions[index].size();
+    for (size_t slot = 0; slot < compiled[index].getVariableCount(); slot++)
+    {
+      string_bytes += compiled[index].getVariableName(slot).size();
+    }
+  }
+
+  constexpr uint64_t limit = std::numeric_limits<uint32_t>::max();
+  if (compiled.size() > limit || variable_count > limit || instruction_count > limit || string_bytes > limit)
+  {
+    throw ExpressionParserErrors::CatalogueFormatException("Too many expressions to be stored in one catalogue");
+  }
+
+  Header header{};
+  std::memcpy(header.magic, CATALOGUE_MAGIC, sizeof(header.magic));
+  header.version = CATALOGUE_FORMAT_VERSION;
+  header.byte_order = CATALOGUE_BYTE_ORDER;
+  header.expression_count = static_cast<uint32_t>(compiled.size());
+  header.variable_count = static_cast<uint32_t>(variable_count);
+  header.instruction_count = static_cast<uint32_t>(instruction_count);
+  header.string_bytes = static_cast<uint32_t>(string_bytes);
+
+  size_t records_offset = sizeof(Header);
+  size_t names_offset = records_offset + compiled.size() * sizeof(Record);
+  size_t instructions_offset = names_offset + variable_count * sizeof(Name);
+  size_t strings_offset = instructions_offset + instruction_count * sizeof(Bytecode::Instruction);
+
+  /* Zero filled, so that padding within the instructions is written deterministically */
+  std::string image(strings_offset + string_bytes, '\0');
+  size_t offset = 0;
+  append(image, offset, header);
+
+  uint32_t first_instruction = 0;
+  uint32_t first_variable = 0;
+  uint32_t string_offset = 0;
+  for (size_t index = 0; index < compiled.size(); index++)
+  {
+    const auto &program = programOf(compiled[index]);
+    const std::vector<Bytecode::Instruction> &bytecode = program.bytecode.getInstructions();
+
+    Record record{};
+    record.first_instruction = first_instruction;
+    record.instruction_count = static_cast<uint32_t>(bytecode.size());
+    record.max_stack_depth = static_cast<uint32_t>(program.bytecode.getMaxStackDepth());
+    record.first_variable = first_variable;
+    record.variable_count = static_cast<uint32_t>(program.variables.size());
+    record.expression_offset = string_offset;
+    record.expression_length = static_cast<uint32_t>(expressions[index].size());
+    append(image, records_offset, record);
+
+    std::memcpy(image.data() + strings_offset + string_offset, expressions[index].data(), expressions[index].size());
+    string_offset += record.expression_length;
+
+    for (const std::string &variable : program.variables)
+    {
+      append(image, names_offset, Name{.offset = string_offset, .length = static_cast<uint32_t>(variable.size())});
+      std::memcpy(image.data() + strings_offset + string_offset, variable.data(), variable.size());
+      string_offset += static_cast<uint32_t>(variable.size());
+    }
+
+    for (const Bytecode::Instruction &instruction : bytecode)
+    {
+      std::memcpy(image.data() + instructions_offset + offsetof(Bytecode::Instruction, op), &instruction.op,
+                  sizeof(instruction.op));
+      std::memcpy(image.data() + instructions_offset + offsetof(Bytecode::Instruction, operand), &instruction.operand,
+                  sizeof(instruction.operand));
+      instructions_offset += sizeof(Bytecode::Instruction);
+    }
+
+    first_instruction += record.instruction_count;
+    first_variable += record.variable_count;
+  }
+
+  return image;
+}
+
+/*
+ * Write
+ *
+ * Writes the catalogue image to a file, replacing any existing file. Throws std::runtime_error if it cannot be
+ * written.
+ *
+ * @param path Path of the file to write
+ */
+void ExpressionCatalogue::Builder::Write(const std::string &path) const
+{
+  const std::string image = Serialise();
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(image.data(), static_cast<std::streamsize>(image.size()));
+  file.close();
+  if (!file)
+  {
+    throw std::runtime_error("ExpressionCatalogue:: Unable to write " + path);
+  }
+}
+
+/*
+ * Expression Catalogue Constructor
+ *
+ * Loads a catalogue from an image held in memory, checking that it is well formed. Throws
+ * CatalogueFormatException if it is not.
+ *
+ * @param image The image, as produced by Builder::Serialise. A view onto the caller's buffer, which must be aligned
+ *              to 4 bytes and outlive the catalogue; it is never copied.
+ */
+ExpressionCatalogue::ExpressionCatalogue(std::string_view image) : ExpressionCatalogue(image, nullptr) {}
+
+/*
+ * Expression Catalogue Constructor
+ *
+ * @param image The image
+ * @param file The mapped file holding the image, or null if the caller owns it
+ */
+ExpressionCatalogue::ExpressionCatalogue(std::string_view image, std::shared_ptr<const MappedFile> file)
+    : file(std::move(file)), image(image), header(nullptr)
+{
+  verify();
+}
+
+/*
+ * Open
+ *
+ * Loads a catalogue by mapping its file, so that only the pages of the expressions used are read from disk. Throws
+ * std::runtime_error if the file cannot be mapped and CatalogueFormatException if it is not a catalogue.
+ *
+ * @param path Path of a file written by Builder::Write
+ * @return The catalogue, which keeps the file mapped until it and every copy of it are destroyed
+ */
+ExpressionCatalogue ExpressionCatalogue::Open(const std::string &path)
+{
+  std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(path);
+  return ExpressionCatalogue(file->getContents(), file);
+}
+
+/*
+ * Get Expression Count
+ *
+ * @return Number of expressions in the catalogue
+ */
+size_t ExpressionCatalogue::getExpressionCount() const
+{
+  return records.size();
+}
+
+/*
+ * Index Operator
+ *
+ * @param index Index of an expression, in the order it was added to the Builder
+ * @return A view of the expression
+ */
+ExpressionCatalogue::Expression ExpressionCatalogue::operator[](size_t index) const
+{
+  if (index >= records.size())
+  {
+    throw std::out_of_range("ExpressionCatalogue:: Expression index out of range");
+  }
+
+  return Expression(*this, records[index]);
+}
+
+/*
+ * Verify
+ *
+ * Checks the image and sets up the views of its sections. Besides the bounds of every section, each expression's
+ * instructions are checked to be valid operations which never pop more operands than were pushed, read only the
+ * expression's own variables and leave a single result, so that evaluation needs no checks of its own.
+ */
+void ExpressionCatalogue::verify()
+{
+  /* Every section is a whole number of 8-byte units, so each starts suitably aligned if the image does */
+  static_assert(sizeof(Header) == 32 && sizeof(Record) == 32 && sizeof(Name) == 8 &&
+                sizeof(Bytecode::Instruction) == 8);
+  static_assert(alignof(Header) == 4 && alignof(Record) == 4 && alignof(Name) == 4 &&
+                alignof(Bytecode::Instruction) == 4);
+
+  if (reinterpret_cast<uintptr_t>(image.data()) % alignof(Header) != 0)
+  {
+    throw ExpressionParserErrors::CatalogueFormatException("Image is not aligned to 4 bytes");
+  }
+
+  if (image.size() < sizeof(Header))
+  {
+    throw ExpressionParserErrors::CatalogueFormatException("Image is too small to hold a catalogue");
+  }
+
+  header = reinterpret_cast<const Header *>(image.data());
+  if (std::memcmp(header->magic, CATALOGUE_MAGIC, sizeof(header->magic)) != 0)
+  {
+    throw ExpressionParserErrors::CatalogueFormatException("Image is not a catalogue");
+  }
+
+  if (header->byte_order != CATALOGUE_BYTE_ORDER)
+  {
+    throw ExpressionParserErrors::CatalogueFormatException("Catalogue was written with the other byte order");
+  }
+
+  if (header->version != CATALOGUE_FORMAT_VERSION)
+  {
+    throw ExpressionParserErrors::CatalogueFormatException("Unsupported catalogue version " +
+                                                           std::to_string(header->version));
+  }
+
+  /* At most 2^32 elements of at most 32 bytes each, so the sum cannot overflow */
+  const uint64_t expected_size = sizeof(Header) + uint64_t(header->expression_count) * sizeof(Record) +
+                                 uint64_t(header->variable_count) * sizeof(Name) +
+                                 uint64_t(header->instruction_count) * sizeof(Bytecode::Instruction) +
+                                 header->string_bytes;
+  if (expected_size != image.size())
+  {
+    throw ExpressionParserErrors::CatalogueFormatException("Image size does not match its header");
+  }
+
+  const char *section = image.data() + sizeof(Header);
+  records = {reinterpret_cast<const Record *>(section), header->expression_count};
+  section += records.size_bytes();
+  names = {reinterpret_cast<const Name *>(section), header->variable_count};
+  section += names.size_bytes();
+  instructions = {reinterpret_cast<const Bytecode::Instruction *>(section), header->instruction_count};
+  section += instructions.size_bytes();
+  strings = {section, header->string_bytes};
+
+  for (const Name &name : names)
+  {
+    if (uint64_t(name.offset) + name.length > strings.size())
+    {
+      throw ExpressionParserErrors::CatalogueFormatException("Variable name lies outside the catalogue");
+    }
+  }
+
+  for (size_t index = 0; index < records.size(); index++)
+  {
+    const Record &record = records[index];
+    const auto fail = [index](const char *problem)
+    {
+      throw ExpressionParserErrors::CatalogueFormatException(problem + (" in expression " + std::to_string(index)));
+    };
+
+    if (uint64_t(record.first_instruction) + record.instruction_count > instructions.size() ||
+        uint64_t(record.first_variable) + record.variable_count > names.size() ||
+        uint64_t(record.expression_offset) + record.expression_length > strings.size())
+    {
+      fail("Section range lies outside the catalogue");
+    }
+
+    size_t depth = 0;
+    size_t max_depth = 0;
+    for (const Bytecode::Instruction &instruction : instructions.subspan(record.first_instruction,
+                                                                         record.instruction_count))
+    {
+      switch (instruction.op)
+      {
+      case Bytecode::OpCode::PushLiteral: depth++; break;
+
+      case Bytecode::OpCode::PushVariable:
+        if (instruction.operand < 0 || static_cast<uint32_t>(instruction.operand) >= record.variable_count)
+        {
+          fail("Variable slot out of range");
+        }
+        depth++;
+        break;
+
+      case Bytecode::OpCode::Negate:
+        if (depth < 1)
+        {
+          fail("Operand stack underflow");
+        }
+        break;
+
+      case Bytecode::OpCode::Addition:
+      case Bytecode::OpCode::Subtraction:
+      case Bytecode::OpCode::Multiplication:
+      case Bytecode::OpCode::Division:
+        if (depth < 2)
+        {
+          fail("Operand stack underflow");
+        }
+        depth--;
+        break;
+
+      default: fail("Unknown instruction");
+      }
+
+      max_depth = std::max(max_depth, depth);
+    }
+
+    if (depth != 1 || max_depth != record.max_stack_depth)
+    {
+      fail("Malformed program");
+    }
+  }
+}
+
+/*
+ * Program Of
+ *
+ * @param compiled A compiled expression
+ * @return The program it holds
+ */
+const CompiledExpression::Program &ExpressionCatalogue::programOf(const CompiledExpression &compiled)
+{
+  return *compiled.program;
+}
+
+/*
+ * Catalogue Expression Constructor
+ *
+ * @param catalogue The catalogue holding the expression
+ * @param record The expression's record
+ */
+ExpressionCatalogue::Expression::Expression(const ExpressionCatalogue &catalogue, const Record &record)
+    : file(catalogue.file), record(&record),
+      instructions(catalogue.instructions.subspan(record.first_instruction, record.instruction_count)),
+      variables(catalogue.names.subspan(record.first_variable, record.variable_count)), strings(catalogue.strings)
+{
+}
+
+/*
+ * Evaluate
+ *
+ * Evaluates the expression against a binding table, throwing the exception matching any error
+ *
+ * @param bindings Value of each variable, indexed by slot (see getSlot). Extra trailing values are ignored.
+ * @return Result of the evaluated expression
+ */
+int ExpressionCatalogue::Expression::Evaluate(std::span<const int> bindings) const
+{
+  return TryEvaluate(bindings).getValue();
+}
+
+/*
+ * Try Evaluate
+ *
+ * Evaluates the expression against a binding table, reporting an unbound variable or division by zero through the
+ * result instead of throwing
+ *
+ * @param bindings Value of each variable, indexed by slot (see getSlot). Extra trailing values are ignored.
+ * @return Result of the evaluated expression, or a description of the failure
+ */
+Result<int> ExpressionCatalogue::Expression::TryEvaluate(std::span<const int> bindings) const
+{
+  return TryEvaluateAs<int32_t, false>(bindings);
+}
+
+/*
+ * Try Evaluate As
+ *
+ * Evaluates the expression on a chosen value type by running its instructions in place (see
+ * CompiledExpression::TryEvaluateAs)
+ *
+ * @param bindings Value of each variable, indexed by slot (see getSlot). Extra trailing values are ignored.
+ * @return Result of the evaluated expression, or a description of the failure
+ */
+template <typename T, bool Checked>
+Result<T> ExpressionCatalogue::Expression::TryEvaluateAs(std::span<const T> bindings) const
+{
+  ExpressionParserErrors::ErrorInfo error;
+
+  if (bindings.size() < record->variable_count)
+  {
+    error.kind = ExpressionParserErrors::ErrorKind::UnboundVariable;
+    error.token = getVariableName(bindings.size());
+    return error;
+  }
+
+  T result;
+  error.kind = Bytecode::TryExecuteAs<T, Checked>(
+      instructions, record->max_stack_depth, bindings.data(), result);
+  if (error.kind != ExpressionParserErrors::ErrorKind::None)
+  {
+    return error;
+  }
+
+  return result;
+}
+
+template Result<int32_t> ExpressionCatalogue::Expression::TryEvaluateAs<int32_t, false>(std::span<const int32_t>) const;
+template Result<int32_t> ExpressionCatalogue::Expression::TryEvaluateAs<int32_t, true>(std::span<const int32_t>) const;
+template Result<int64_t> ExpressionCatalogue::Expression::TryEvaluateAs<int64_t, false>(std::span<const int64_t>) const;
+template Result<int64_t> ExpressionCatalogue::Expression::TryEvaluateAs<int64_t, true>(std::span<const int64_t>) const;
+
+/*
+ * Get Expression
+ *
+ * @return The expression's source text
+ */
+std::string_view ExpressionCatalogue::Expression::getExpression() const
+{
+  return strings.substr(record->expression_offset, record->expression_length);
+}
+
+/*
+ * Get Node Count
+ *
+ * @return Number of nodes in the expression's tree, one per instruction
+ */
+size_t ExpressionCatalogue::Expression::getNodeCount() const
+{
+  return record->instruction_count;
+}
+
+/*
+ * Get Variable Count
+ *
+ * @return Number of slots the binding table passed to Evaluate must provide
+ */
+size_t ExpressionCatalogue::Expression::getVariableCount() const
+{
+  return record->variable_count;
+}
+
+/*
+ * Get Slot
+ *
+ * Looks up the binding table index of a variable. Intended to be called once per variable, not per evaluation.
+ *
+ * @param name Name of the variable as written in the expression
+ * @return Index into the binding table
+ */
+int ExpressionCatalogue::Expression::getSlot(std::string_view name) const
+{
+  for (size_t slot = 0; slot < record->variable_count; slot++)
+  {
+    if (getVariableName(slot) == name)
+    {
+      return static_cast<int>(slot);
+    }
+  }
+
+  throw ExpressionParserErrors::UnknownVariableException(name);
+}
+
+/*
+ * Get Variable Name
+ *
+ * @param slot Index into the binding table
+ * @return Name of the variable bound to the slot, a view into the catalogue's image
+ */
+std::string_view ExpressionCatalogue::Expression::getVariableName(size_t slot) const
+{
+  if (slot >= record->variable_count)
+  {
+    throw std::out_of_range("ExpressionCatalogue:: Variable slot out of range");
+  }
+
+  const Name &name = variables[slot];
+  return strings.substr(name.offset, name.length);
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bytecode.h"
+#include "compiled_expression.h"
+#include "mapped_file.h"
+#include "result.h"
+
+/* Incremented whenever the layout of a catalogue file changes; files of any other version are rejected */
+#define CATALOGUE_FORMAT_VERSION 1
+
+/*
+ * Expression Catalogue
+ *
+ * A set of compiled expressions stored in one contiguous binary image, so that a catalogue compiled offline can be
+ * loaded by mapping the file (see Open) instead of parsing every expression again. The image is used in place:
+ * loading checks it once and builds nothing, and an expression is evaluated by running its bytecode straight from
+ * the mapped bytes, so no memory is allocated per expression.
+ *
+ * The image is laid out as
+ *
+ *   Header                   magic, format version, byte order and the size of every section
+ *   Record[expressions]      per expression: its instructions, variables and source text
+ *   Name[variables]          per variable of every expression, in slot order: its name's place in the strings
+ *   Instruction[total]       every expression's bytecode (see Bytecode::Instruction), one after another
+ *   char[string bytes]       the source text of every expression and the names of its variables
+ *
+ * Values are stored in the byte order of the machine which wrote them; a file written on a machine of the other
+ * order is rejected rather than read wrongly. Every instruction is checked when the catalogue is loaded, so that a
+ * corrupt file is reported through CatalogueFormatException instead of being evaluated out of bounds.
+ *
+ * Expressions are evaluated on the interpreter; native translation and batch evaluation remain features of
+ * CompiledExpression.
+ */
+class ExpressionCatalogue
+{
+  struct Header;
+  struct Record;
+  struct Name;
+
+public:
+  /*
+   * Catalogue Builder
+   *
+   * Collects compiled expressions and writes them out as a catalogue image
+   */
+  class Builder
+  {
+  public:
+    void Add(std::string_view expression, const CompiledExpression &compiled);
+
+    size_t getExpressionCount() const;
+
+    std::string Serialise() const;
+
+    void Write(const std::string &path) const;
+
+  private:
+    /* The expressions added so far, in the order they are stored */
+    std::vector<std::string> expressions;
+    std::vector<CompiledExpression> compiled;
+  };
+
+  /*
+   * Catalogue Expression
+   *
+   * A view of one expression held by a catalogue. It holds the sections of the image it reads, and shares the
+   * mapped file with the catalogue if there is one, so it remains valid after the catalogue object is destroyed or
+   * moved; an image supplied by the caller must still outlive it. Copying it costs no more than copying a
+   * shared_ptr.
+   */
+  class Expression
+  {
+  public:
+    int Evaluate(std::span<const int> bindings = {}) const;
+
+    Result<int> TryEvaluate(std::span<const int> bindings = {}) const;
+
+    template <typename T, bool Checked = false> Result<T> TryEvaluateAs(std::span<const T> bindings = {}) const;
+
+    std::string_view getExpression() const;
+
+    size_t getNodeCount() const;
+
+    size_t getVariableCount() const;
+
+    int getSlot(std::string_view name) const;
+
+    std::string_view getVariableName(size_t slot) const;
+
+  private:
+    friend class ExpressionCatalogue;
+
+    Expression(const ExpressionCatalogue &catalogue, const Record &record);
+
+    /* The mapped file holding the image, if any, kept open for as long as the expression is */
+    std::shared_ptr<const MappedFile> file;
+
+    /* This expression's entry, its instructions and variable names, and the strings section they refer into */
+    const Record *record;
+    std::span<const Bytecode::Instruction> instructions;
+    std::span<const Name> variables;
+    std::string_view strings;
+  };
+
+  explicit ExpressionCatalogue(std::string_view image);
+
+  static ExpressionCatalogue Open(const std::string &path);
+
+  size_t getExpressionCount() const;
+
+  Expression operator[](size_t index) const;
+
+private:
+  ExpressionCatalogue(std::string_view image, std::shared_ptr<const MappedFile> file);
+
+  void verify();
+
+  static const CompiledExpression::Program &programOf(const CompiledExpression &compiled);
+
+  /* The mapped file holding the image, if the catalogue was opened from one; shared by copies of the catalogue */
+  std::shared_ptr<const MappedFile> file;
+
+  /* The whole image, and views of its sections */
+  std::string_view image;
+  const Header *header;
+  std::span<const Record> records;
+  std::span<const Name> names;
+  std::span<const Bytecode::Instruction> instructions;
+  std::string_view strings;
+};
\ No newline at end of file
@@ -0,0 +1,307 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "expression_dag.h"
+#include "arithmetic.h"
+#include "errors.h"
+
+#include <utility>
+
+/*
+ * Expression DAG Constructor
+ *
+ * Creates a DAG holding no expressions
+ */
+ExpressionDag::ExpressionDag() : source_node_count(0) {}
+
+/*
+ * Add
+ *
+ * Merges an expression into the DAG. Its nodes are visited children first, each being replaced by the matching node
+ * already in the table, if there is one, or appended to it.
+ *
+ * @param expression The compiled expression to add
+ * @return Index of the expression's root, which is also its position in the results of Evaluate
+ */
+size_t ExpressionDag::Add(const CompiledExpression &expression)
+{
+  const FlatAst &ast = expression.program->ast;
+  const std::vector<std::string> &names = expression.program->variables;
+
+  /* The DAG node each node of the expression became */
+  std::vector<FlatAst::NodeIndex> merged(ast.getNodeCount());
+  for (FlatAst::NodeIndex node = 0; node < static_cast<FlatAst::NodeIndex>(ast.getNodeCount()); node++)
+  {
+    Node dag_node{.op = ast.getOpCode(node), .left = 0, .right = -1};
+
+    switch (dag_node.op)
+    {
+    case FlatAst::OpCode::Literal: dag_node.left = ast.getLiteral(node); break;
+
+    case FlatAst::OpCode::Variable: dag_node.left = bindVariable(names[ast.getLeft(node)]); break;
+
+    case FlatAst::OpCode::Negate: dag_node.left = merged[ast.getLeft(node)]; break;
+
+    case FlatAst::OpCode::Addition:
+    case FlatAst::OpCode::Multiplication:
+    case FlatAst::OpCode::Subtraction:
+    case FlatAst::OpCode::Division:
+      dag_node.left = merged[ast.getLeft(node)];
+      dag_node.right = merged[ast.getRight(node)];
+      if ((dag_node.op == FlatAst::OpCode::Addition || dag_node.op == FlatAst::OpCode::Multiplication) &&
+          dag_node.left > dag_node.right)
+      {
+        /* Commutative, and wrapping arithmetic gives the same result either way round */
+        std::swap(dag_node.left, dag_node.right);
+      }
+      break;
+
+    default: throw ExpressionParserErrors::UnknownOperatorException();
+    }
+
+    merged[node] = intern(dag_node);
+  }
+
+  source_node_count += ast.getNodeCount();
+  roots.push_back(merged.back());
+  return roots.size() - 1;
+}
+
+/*
+ * Evaluate
+ *
+ * Evaluates every expression in the DAG against one binding table, computing each shared node once. A root which
+ * divides by zero does not throw; it is flagged in the error mask and its result is 0.
+ *
+ * @param bindings Value of each variable, indexed by slot (see getSlot). Extra trailing values are ignored.
+ * @param results Receives one result per root, in the order the expressions were added
+ * @param error_mask Receives one flag per root; non-zero marks a root whose result is undefined
+ * @return Number of roots flagged in the error mask
+ */
+size_t ExpressionDag::Evaluate(std::span<const int> bindings, int *results, uint8_t *error_mask) const
+{
+  if (bindings.size() < variables.size())
+  {
+    throw ExpressionParserErrors::UnboundVariableException(variables[bindings.size()]);
+  }
+
+  using Ops = Arithmetic<int32_t, false>;
+  thread_local std::vector<int> values;
+  if (values.size() < nodes.size())
+  {
+    values.resize(nodes.size());
+  }
+
+  bool divided_by_zero = false;
+  for (size_t index = 0; index < nodes.size(); index++)
+  {
+    const Node &node = nodes[index];
+    int &value = values[index];
+
+    switch (node.op)
+    {
+    case FlatAst::OpCode::Literal: value = node.left; break;
+    case FlatAst::OpCode::Variable: value = bindings[node.left]; break;
+    case FlatAst::OpCode::Negate: Ops::Negate(values[node.left], value); break;
+    case FlatAst::OpCode::Addition: Ops::Add(values[node.left], values[node.right], value); break;
+    case FlatAst::OpCode::Subtraction: Ops::Subtract(values[node.left], values[node.right], value); break;
+    case FlatAst::OpCode::Multiplication: Ops::Multiply(values[node.left], values[node.right], value); break;
+
+    case FlatAst::OpCode::Division:
+      if (values[node.right] == 0)
+      {
+        /* Undefined result encountered; the roots depending on it are found afterwards */
+        value = 0;
+        divided_by_zero = true;
+        break;
+      }
+
+      Ops::Divide(values[node.left], values[node.right], value);
+      break;
+
+    default: throw ExpressionParserErrors::UnknownOperatorException();
+    }
+  }
+
+  for (size_t root = 0; root < roots.size(); root++)
+  {
+    results[root] = values[roots[root]];
+    error_mask[root] = 0;
+  }
+
+  if (!divided_by_zero)
+  {
+    return 0;
+  }
+
+  const size_t error_count = markFailures(values.data(), error_mask);
+  for (size_t root = 0; root < roots.size(); root++)
+  {
+    if (error_mask[root] != 0)
+    {
+      results[root] = 0;
+    }
+  }
+  return error_count;
+}
+
+/*
+ * Get Root Count
+ *
+ * @return Number of expressions added, and of results produced by Evaluate
+ */
+size_t ExpressionDag::getRootCount() const
+{
+  return roots.size();
+}
+
+/*
+ * Get Node Count
+ *
+ * @return Number of distinct nodes in the DAG, each evaluated once per call to Evaluate
+ */
+size_t ExpressionDag::getNodeCount() const
+{
+  return nodes.size();
+}
+
+/*
+ * Get Source Node Count
+ *
+ * @return Number of nodes in the added expressions before they were merged
+ */
+size_t ExpressionDag::getSourceNodeCount() const
+{
+  return source_node_count;
+}
+
+/*
+ * Get Variable Count
+ *
+ * @return Number of slots the binding table passed to Evaluate must provide
+ */
+size_t ExpressionDag::getVariableCount() const
+{
+  return variables.size();
+}
+
+/*
+ * Get Slot
+ *
+ * Looks up the binding table index of a variable used by any of the expressions
+ *
+ * @param name Name of the variable as written in the expressions
+ * @return Index into the binding table
+ */
+int ExpressionDag::getSlot(std::string_view name) const
+{
+  const auto slot = slots.find(std::string(name));
+  if (slot == slots.end())
+  {
+    throw ExpressionParserErrors::UnknownVariableException(name);
+  }
+
+  return slot->second;
+}
+
+/*
+ * Get Variable Name
+ *
+ * @param slot Index into the binding table
+ * @return Name of the variable bound to the slot
+ */
+const std::string &ExpressionDag::getVariableName(size_t slot) const
+{
+  return variables.at(slot);
+}
+
+/*
+ * Node Hash
+ *
+ * @param node The node to hash
+ * @return Hash of its operation and operands
+ */
+size_t ExpressionDag::NodeHash::operator()(const Node &node) const
+{
+  const uint64_t operands = (uint64_t(uint32_t(node.left)) << 32) | uint32_t(node.right);
+  return std::hash<uint64_t>()((operands ^ uint64_t(node.op)) * 0x9E3779B97F4A7C15ull);
+}
+
+/*
+ * Intern
+ *
+ * @param node A node whose children are already in the table
+ * @return Index of the matching node in the table, appended if there was none
+ */
+FlatAst::NodeIndex ExpressionDag::intern(Node node)
+{
+  const auto [entry, inserted] = interned.try_emplace(node, static_cast<FlatAst::NodeIndex>(nodes.size()));
+  if (inserted)
+  {
+    nodes.push_back(node);
+  }
+
+  return entry->second;
+}
+
+/*
+ * Bind Variable
+ *
+ * @param name Name of a variable used by an added expression
+ * @return The variable's slot in the merged binding table, allocated if it is the first use of the name
+ */
+int32_t ExpressionDag::bindVariable(const std::string &name)
+{
+  const auto [entry, inserted] = slots.try_emplace(name, static_cast<int32_t>(variables.size()));
+  if (inserted)
+  {
+    variables.push_back(name);
+  }
+
+  return entry->second;
+}
+
+/*
+ * Mark Failures
+ *
+ * Finds the roots whose value depends on a division by zero. Only run once an evaluation has divided by zero, so
+ * that evaluations which do not pay nothing for tracking failures.
+ *
+ * @param values The value of every node from the evaluation
+ * @param error_mask Receives a non-zero flag for each root which failed
+ * @return Number of roots which failed
+ */
+size_t ExpressionDag::markFailures(const int *values, uint8_t *error_mask) const
+{
+  thread_local std::vector<uint8_t> failed;
+  if (failed.size() < nodes.size())
+  {
+    failed.resize(nodes.size());
+  }
+
+  for (size_t index = 0; index < nodes.size(); index++)
+  {
+    const Node &node = nodes[index];
+    switch (node.op)
+    {
+    case FlatAst::OpCode::Literal:
+    case FlatAst::OpCode::Variable: failed[index] = 0; break;
+
+    case FlatAst::OpCode::Negate: failed[index] = failed[node.left]; break;
+
+    default:
+      failed[index] = failed[node.left] | failed[node.right] |
+                      (node.op == FlatAst::OpCode::Division && values[node.right] == 0);
+      break;
+    }
+  }
+
+  size_t error_count = 0;
+  for (size_t root = 0; root < roots.size(); root++)
+  {
+    error_mask[root] = failed[roots[root]];
+    error_count += error_mask[root];
+  }
+  return error_count;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "compiled_expression.h"
+#include "flat_ast.h"
+
+/*
+ * Expression DAG
+ *
+ * Many compiled expressions merged into one node table in which every distinct subexpression is stored once. Nodes
+ * are hash-consed as each expression is added: a node whose operation and operands match one already in the table
+ * is replaced by it, so a term repeated across expressions becomes a single node shared by each of them. The
+ * operands of addition and multiplication are put in a canonical order first, so a + b and b + a are shared too.
+ *
+ * Variables are merged by name into one binding table. Children are stored before their parents, so one pass over
+ * the table evaluates every shared node once and leaves the value of every expression (a root) behind.
+ *
+ * Evaluation is unchecked int arithmetic, like CompiledExpression::Evaluate. Division by zero fails only the roots
+ * which depend on it; the others still produce their values.
+ */
+class ExpressionDag
+{
+public:
+  ExpressionDag();
+
+  size_t Add(const CompiledExpression &expression);
+
+  size_t Evaluate(std::span<const int> bindings, int *results, uint8_t *error_mask) const;
+
+  size_t getRootCount() const;
+
+  size_t getNodeCount() const;
+
+  size_t getSourceNodeCount() const;
+
+  size_t getVariableCount() const;
+
+  int getSlot(std::string_view name) const;
+
+  const std::string &getVariableName(size_t slot) const;
+
+private:
+  /*
+   * DAG Node
+   *
+   * One operation. left holds the value of a literal, the binding slot of a variable, the operand of a negation and
+   * the left child of a binary node; right holds the right child of a binary node and is -1 otherwise.
+   */
+  struct Node
+  {
+    FlatAst::OpCode op;
+    int32_t left;
+    int32_t right;
+
+    bool operator==(const Node &other) const = default;
+  };
+
+  /*
+   * Node Hash
+   *
+   * Hashes a node by its operation and operands
+   */
+  struct NodeHash
+  {
+    size_t operator()(const Node &node) const;
+  };
+
+  FlatAst::NodeIndex intern(Node node);
+
+  int32_t bindVariable(const std::string &name);
+
+  size_t markFailures(const int *values, uint8_t *error_mask) const;
+
+  /* The merged node table, children before parents */
+  std::vector<Node> nodes;
+
+  /* Index of every node in the table, by its operation and operands */
+  std::unordered_map<Node, FlatAst::NodeIndex, NodeHash> interned;
+
+  /* The root node of each expression, in the order they were added */
+  std::vector<FlatAst::NodeIndex> roots;
+
+  /* Variable names in slot order, and the slot of each name */
+  std::vector<std::string> variables;
+  std::unordered_map<std::string, int32_t> slots;
+
+  /* Nodes in the added expressions before they were merged */
+  size_t source_node_count;
+};
\ No newline at end of file
@@ -0,0 +1,334 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "flat_ast.h"
+#include "arithmetic.h"
+#include "errors.h"
+
+#include <algorithm>
+
+/*
+ * Flat AST Constructor
+ *
+ * Creates an empty table with no storage; Reset must be called before nodes are added.
+ */
+FlatAst::FlatAst()
+    : arena(nullptr), opcodes(nullptr), left(nullptr), right(nullptr), literals(nullptr), node_count(0),
+      literal_count(0), capacity(0)
+{
+}
+
+/*
+ * Reset
+ *
+ * Empties the table and carves its arrays out of the provided arena. When the caller knows how many nodes will be
+ * added the table never grows; otherwise, once it is full, its arrays are moved to larger ones in the same arena.
+ *
+ * @param arena The arena the arrays are allocated from; the table is invalidated when the arena is reset
+ * @param capacity Number of nodes the table has room for before it must grow
+ */
+void FlatAst::Reset(Arena &arena, size_t capacity)
+{
+  this->arena = &arena;
+  opcodes = arena.AllocateArray<OpCode>(capacity);
+  left = arena.AllocateArray<NodeIndex>(capacity);
+  right = arena.AllocateArray<NodeIndex>(capacity);
+  literals = arena.AllocateArray<int>(capacity);
+
+  node_count = 0;
+  literal_count = 0;
+  this->capacity = capacity;
+}
+
+/*
+ * Add Literal
+ *
+ * @param value Integer value of the literal
+ * @return Index of the new node
+ */
+FlatAst::NodeIndex FlatAst::AddLiteral(int value)
+{
+  if (node_count == capacity)
+  {
+    grow();
+  }
+
+  literals[literal_count] = value;
+
+  opcodes[node_count] = OpCode::Literal;
+  left[node_count] = static_cast<NodeIndex>(literal_count++);
+  right[node_count] = -1;
+  return static_cast<NodeIndex>(node_count++);
+}
+
+/*
+ * Add Variable
+ *
+ * @param slot Index into the binding table the variable's value is read from at evaluation
+ * @return Index of the new node
+ */
+FlatAst::NodeIndex FlatAst::AddVariable(int32_t slot)
+{
+  if (node_count == capacity)
+  {
+    grow();
+  }
+
+  opcodes[node_count] = OpCode::Variable;
+  left[node_count] = slot;
+  right[node_count] = -1;
+  return static_cast<NodeIndex>(node_count++);
+}
+
+/*
+ * Add Unary
+ *
+ * Adds a negation of an existing node
+ *
+ * @param right Index of the node to negate
+ * @return Index of the new node
+ */
+FlatAst::NodeIndex FlatAst::AddUnary(NodeIndex right)
+{
+  if (node_count == capacity)
+  {
+    grow();
+  }
+
+  opcodes[node_count] = OpCode::Negate;
+  left[node_count] = right;
+  this->right[node_count] = -1;
+  return static_cast<NodeIndex>(node_count++);
+}
+
+/*
+ * Add Binary
+ *
+ * @param op Arithmetic operation of the node
+ * @param left Index of the left hand side node
+ * @param right Index of the right hand side node
+ * @return Index of the new node
+ */
+FlatAst::NodeIndex FlatAst::AddBinary(OpCode op, NodeIndex left, NodeIndex right)
+{
+  if (node_count == capacity)
+  {
+    grow();
+  }
+
+  opcodes[node_count] = op;
+  this->left[node_count] = left;
+  this->right[node_count] = right;
+  return static_cast<NodeIndex>(node_count++);
+}
+
+/*
+ * Grow
+ *
+ * Moves the arrays to ones twice the size in the same arena. The old arrays are released with the arena, so the
+ * memory held stays proportional to the number of nodes.
+ */
+void FlatAst::grow()
+{
+  const size_t new_capacity = std::max<size_t>(capacity * 2, FLAT_AST_MIN_CAPACITY);
+  OpCode *new_opcodes = arena->AllocateArray<OpCode>(new_capacity);
+  NodeIndex *new_left = arena->AllocateArray<NodeIndex>(new_capacity);
+  NodeIndex *new_right = arena->AllocateArray<NodeIndex>(new_capacity);
+  int *new_literals = arena->AllocateArray<int>(new_capacity);
+
+  std::copy_n(opcodes, node_count, new_opcodes);
+  std::copy_n(left, node_count, new_left);
+  std::copy_n(right, node_count, new_right);
+  std::copy_n(literals, literal_count, new_literals);
+
+  opcodes = new_opcodes;
+  left = new_left;
+  right = new_right;
+  literals = new_literals;
+  capacity = new_capacity;
+}
+
+/*
+ * Clone
+ *
+ * Copies the table into another arena, sized to fit exactly
+ *
+ * @param arena The arena the copy's arrays are allocated from
+ * @return A table holding the same nodes as this one
+ */
+FlatAst FlatAst::Clone(Arena &arena) const
+{
+  FlatAst copy;
+  copy.Reset(arena, node_count);
+
+  std::copy_n(opcodes, node_count, copy.opcodes);
+  std::copy_n(left, node_count, copy.left);
+  std::copy_n(right, node_count, copy.right);
+  std::copy_n(literals, literal_count, copy.literals);
+  copy.node_count = node_count;
+  copy.literal_count = literal_count;
+
+  return copy;
+}
+
+/*
+ * Evaluate
+ *
+ * Performs an arithmetic evaluation of the whole tree, throwing DivideByZeroException on division by zero
+ *
+ * @param values Scratch space with room for one value per node; the table itself is never modified
+ * @param bindings Values of the variables, indexed by slot. May only be null if the table has no variable nodes.
+ * @return Result of the evaluation
+ */
+int FlatAst::Evaluate(int *values, const int *bindings) const
+{
+  int result;
+  if (!TryEvaluate(values, bindings, result))
+  {
+    throw ExpressionParserErrors::DivideByZeroException();
+  }
+
+  return result;
+}
+
+/*
+ * Try Evaluate
+ *
+ * Performs an arithmetic evaluation of the whole tree on int with unchecked arithmetic
+ *
+ * @param values Scratch space with room for one value per node; the table itself is never modified
+ * @param bindings Values of the variables, indexed by slot. May only be null if the table has no variable nodes.
+ * @param result Receives the result of the evaluation
+ * @return True if the tree was evaluated, false if it divides by zero
+ */
+bool FlatAst::TryEvaluate(int *values, const int *bindings, int &result) const
+{
+  return TryEvaluateAs<int32_t, false>(values, bindings, result) == ExpressionParserErrors::ErrorKind::None;
+}
+
+/*
+ * Try Evaluate As
+ *
+ * Performs an arithmetic evaluation of the whole tree. Children are always stored before their parents, so rather
+ * than recursing from the root the table is swept once from front to back, dispatching on each node's opcode and
+ * recording its value. The final node is the root of the tree. Literals are widened to the value type.
+ *
+ * Instantiated for int32_t and int64_t, each with unchecked and checked arithmetic (see Arithmetic).
+ *
+ * @param values Scratch space with room for one value per node; the table itself is never modified
+ * @param bindings Values of the variables, indexed by slot. May only be null if the table has no variable nodes.
+ * @param result Receives the result of the evaluation
+ * @return ErrorKind::None if the tree was evaluated, otherwise DivideByZero or, for checked arithmetic, Overflow
+ */
+template <typename T, bool Checked>
+ExpressionParserErrors::ErrorKind FlatAst::TryEvaluateAs(T *values, const T *bindings, T &result) const
+{
+  using Ops = Arithmetic<T, Checked>;
+  bool represented = true;
+
+  for (size_t node = 0; node < node_count; node++)
+  {
+    switch (opcodes[node])
+    {
+    case OpCode::Literal: values[node] = literals[left[node]]; break;
+
+    case OpCode::Variable: values[node] = bindings[left[node]]; break;
+
+    case OpCode::Negate: represented = Ops::Negate(values[left[node]], values[node]); break;
+
+    case OpCode::Addition: represented = Ops::Add(values[left[node]], values[right[node]], values[node]); break;
+
+    case OpCode::Subtraction:
+      represented = Ops::Subtract(values[left[node]], values[right[node]], values[node]);
+      break;
+
+    case OpCode::Multiplication:
+      represented = Ops::Multiply(values[left[node]], values[right[node]], values[node]);
+      break;
+
+    case OpCode::Division:
+      if (values[right[node]] == 0)
+      {
+        /* Undefined result encountered */
+        return ExpressionParserErrors::ErrorKind::DivideByZero;
+      }
+
+      represented = Ops::Divide(values[left[node]], values[right[node]], values[node]);
+      break;
+
+    default: throw ExpressionParserErrors::UnknownOperatorException();
+    }
+
+    if (!represented)
+    {
+      return ExpressionParserErrors::ErrorKind::Overflow;
+    }
+  }
+
+  result = values[node_count - 1];
+  return ExpressionParserErrors::ErrorKind::None;
+}
+
+template ExpressionParserErrors::ErrorKind FlatAst::TryEvaluateAs<int32_t, false>(int32_t *, const int32_t *,
+                                                                                   int32_t &) const;
+template ExpressionParserErrors::ErrorKind FlatAst::TryEvaluateAs<int32_t, true>(int32_t *, const int32_t *,
+                                                                                  int32_t &) const;
+template ExpressionParserErrors::ErrorKind FlatAst::TryEvaluateAs<int64_t, false>(int64_t *, const int64_t *,
+                                                                                   int64_t &) const;
+template ExpressionParserErrors::ErrorKind FlatAst::TryEvaluateAs<int64_t, true>(int64_t *, const int64_t *,
+                                                                                  int64_t &) const;
+
+/*
+ * Get Node Count
+ *
+ * @return Number of nodes in the table
+ */
+size_t FlatAst::getNodeCount() const
+{
+  return node_count;
+}
+
+/*
+ * Get OpCode
+ *
+ * @param node Index of the node
+ * @return Operation the node performs
+ */
+FlatAst::OpCode FlatAst::getOpCode(NodeIndex node) const
+{
+  return opcodes[node];
+}
+
+/*
+ * Get Left
+ *
+ * @param node Index of the node
+ * @return Left child of a binary node, operand of a unary node or binding slot of a variable node
+ */
+FlatAst::NodeIndex FlatAst::getLeft(NodeIndex node) const
+{
+  return left[node];
+}
+
+/*
+ * Get Right
+ *
+ * @param node Index of the node
+ * @return Right child of a binary node, -1 for any other node
+ */
+FlatAst::NodeIndex FlatAst::getRight(NodeIndex node) const
+{
+  return right[node];
+}
+
+/*
+ * Get Literal
+ *
+ * @param node Index of a literal node
+ * @return The literal's value
+ */
+int FlatAst::getLiteral(NodeIndex node) const
+{
+  return literals[left[node]];
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+#include "result.h"
+
+/* Fewest nodes a table grows to, and the starting size of one whose final size is not known */
+#define FLAT_AST_MIN_CAPACITY 16
+
+/*
+ * Flat Abstract Syntax Tree
+ *
+ * Stores the AST as a table of nodes in structure-of-arrays form: one array of opcodes, two arrays of child indices
+ * and a pool of literal values. Nodes refer to each other by index, and children are always appended before their
+ * parents, so a whole expression occupies a handful of contiguous arrays and the last node added is the root.
+ */
+class FlatAst
+{
+public:
+  /* Index of a node within the table */
+  using NodeIndex = int32_t;
+
+  /*
+   * Node OpCode
+   *
+   * States the operation a node performs
+   */
+  enum class OpCode : uint8_t
+  {
+    Literal,
+    Variable,
+    Negate,
+    Addition,
+    Subtraction,
+    Multiplication,
+    Division
+  };
+
+  FlatAst();
+
+  void Reset(Arena &arena, size_t capacity);
+
+  NodeIndex AddLiteral(int value);
+
+  NodeIndex AddVariable(int32_t slot);
+
+  NodeIndex AddUnary(NodeIndex right);
+
+  NodeIndex AddBinary(OpCode op, NodeIndex left, NodeIndex right);
+
+  FlatAst Clone(Arena &arena) const;
+
+  int Evaluate(int *values, const int *bindings = nullptr) const;
+
+  bool TryEvaluate(int *values, const int *bindings, int &result) const;
+
+  template <typename T, bool Checked>
+  ExpressionParserErrors::ErrorKind TryEvaluateAs(T *values, const T *bindings, T &result) const;
+
+  size_t getNodeCount() const;
+
+  OpCode getOpCode(NodeIndex node) const;
+
+  NodeIndex getLeft(NodeIndex node) const;
+
+  NodeIndex getRight(NodeIndex node) const;
+
+  int getLiteral(NodeIndex node) const;
+
+private:
+  void grow();
+
+  /* Arena the arrays are allocated from, and grown within */
+  Arena *arena;
+
+  /* Operation of each node */
+  OpCode *opcodes;
+
+  /* Left child of binary nodes, operand of unary nodes, literal pool index of literal nodes, binding slot of
+     variable nodes */
+  NodeIndex *left;
+
+  /* Right child of binary nodes */
+  NodeIndex *right;
+
+  /* Values of the literal nodes */
+  int *literals;
+
+  /* Number of nodes and literals currently held */
+  size_t node_count;
+  size_t literal_count;
+
+  /* Number of nodes (and literals) the arrays have room for */
+  size_t capacity;
+};
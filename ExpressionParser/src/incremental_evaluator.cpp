@@ -0,0 +1,229 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "incremental_evaluator.h"
+#include "arithmetic.h"
+#include "errors.h"
+
+/*
+ * Incremental Evaluator Constructor
+ *
+ * Copies and indexes the expression's node table and evaluates it in full
+ *
+ * @param expression The compiled expression to evaluate
+ * @param bindings Initial value of each variable, indexed by slot (see CompiledExpression::getSlot). Extra trailing
+ *                 values are ignored.
+ */
+IncrementalEvaluator::IncrementalEvaluator(const CompiledExpression &expression, std::span<const int> bindings)
+{
+  const FlatAst &ast = expression.program->ast;
+  const size_t variable_count = expression.getVariableCount();
+  if (bindings.size() < variable_count)
+  {
+    throw ExpressionParserErrors::UnboundVariableException(expression.getVariableName(bindings.size()));
+  }
+
+  this->bindings.assign(bindings.begin(), bindings.begin() + variable_count);
+
+  const size_t node_count = ast.getNodeCount();
+  nodes.resize(node_count);
+  values.resize(node_count);
+  failed.resize(node_count);
+  parents.assign(node_count, -1);
+  occurrence_offsets.assign(variable_count + 1, 0);
+
+  for (FlatAst::NodeIndex node = 0; node < static_cast<FlatAst::NodeIndex>(node_count); node++)
+  {
+    Node &copy = nodes[node];
+    copy = Node{.op = ast.getOpCode(node), .left = 0, .right = -1};
+
+    switch (copy.op)
+    {
+    case FlatAst::OpCode::Literal: copy.left = ast.getLiteral(node); break;
+
+    case FlatAst::OpCode::Variable:
+      copy.left = ast.getLeft(node);
+      occurrence_offsets[copy.left + 1]++;
+      break;
+
+    case FlatAst::OpCode::Negate:
+      copy.left = ast.getLeft(node);
+      parents[copy.left] = node;
+      break;
+
+    default:
+      copy.left = ast.getLeft(node);
+      copy.right = ast.getRight(node);
+      parents[copy.left] = node;
+      parents[copy.right] = node;
+      break;
+    }
+  }
+
+  for (size_t slot = 0; slot < variable_count; slot++)
+  {
+    occurrence_offsets[slot + 1] += occurrence_offsets[slot];
+  }
+
+  /* Filled slot by slot, using the offsets as cursors and shifting them back afterwards */
+  occurrences.resize(occurrence_offsets.back());
+  for (FlatAst::NodeIndex node = 0; node < static_cast<FlatAst::NodeIndex>(node_count); node++)
+  {
+    if (nodes[node].op == FlatAst::OpCode::Variable)
+    {
+      occurrences[occurrence_offsets[nodes[node].left]++] = node;
+    }
+
+    recompute(node);
+  }
+
+  for (size_t slot = variable_count; slot > 0; slot--)
+  {
+    occurrence_offsets[slot] = occurrence_offsets[slot - 1];
+  }
+  occurrence_offsets[0] = 0;
+}
+
+/*
+ * Update
+ *
+ * Changes the value of one variable and recomputes the nodes which depend on it
+ *
+ * @param slot Binding table index of the variable
+ * @param value The variable's new value
+ * @return Number of nodes recomputed
+ */
+size_t IncrementalEvaluator::Update(size_t slot, int value)
+{
+  if (bindings.at(slot) == value)
+  {
+    return 0;
+  }
+
+  bindings[slot] = value;
+
+  size_t recomputed = 0;
+  for (size_t occurrence = occurrence_offsets[slot]; occurrence < occurrence_offsets[slot + 1]; occurrence++)
+  {
+    for (FlatAst::NodeIndex node = occurrences[occurrence]; node != -1; node = parents[node])
+    {
+      recomputed++;
+      if (!recompute(node))
+      {
+        break;
+      }
+    }
+  }
+
+  return recomputed;
+}
+
+/*
+ * Get Value
+ *
+ * @return Result of the expression for the current bindings; throws DivideByZeroException if it divides by zero
+ */
+int IncrementalEvaluator::getValue() const
+{
+  return TryGetValue().getValue();
+}
+
+/*
+ * Try Get Value
+ *
+ * @return Result of the expression for the current bindings, or DivideByZero if it divides by zero
+ */
+Result<int> IncrementalEvaluator::TryGetValue() const
+{
+  if (failed.back() != 0)
+  {
+    ExpressionParserErrors::ErrorInfo error;
+    error.kind = ExpressionParserErrors::ErrorKind::DivideByZero;
+    return error;
+  }
+
+  return values.back();
+}
+
+/*
+ * Get Binding
+ *
+ * @param slot Binding table index of a variable
+ * @return The variable's current value
+ */
+int IncrementalEvaluator::getBinding(size_t slot) const
+{
+  return bindings.at(slot);
+}
+
+/*
+ * Recompute
+ *
+ * Evaluates one node from the cached values of its children
+ *
+ * @param node Index of the node
+ * @return True if the node's value, or whether it failed, changed
+ */
+bool IncrementalEvaluator::recompute(FlatAst::NodeIndex node)
+{
+  using Ops = Arithmetic<int32_t, false>;
+  const Node &operation = nodes[node];
+  int value = 0;
+  uint8_t node_failed = 0;
+
+  switch (operation.op)
+  {
+  case FlatAst::OpCode::Literal: value = operation.left; break;
+
+  case FlatAst::OpCode::Variable: value = bindings[operation.left]; break;
+
+  case FlatAst::OpCode::Negate:
+    node_failed = failed[operation.left];
+    Ops::Negate(values[operation.left], value);
+    break;
+
+  case FlatAst::OpCode::Addition:
+    node_failed = failed[operation.left] | failed[operation.right];
+    Ops::Add(values[operation.left], values[operation.right], value);
+    break;
+
+  case FlatAst::OpCode::Subtraction:
+    node_failed = failed[operation.left] | failed[operation.right];
+    Ops::Subtract(values[operation.left], values[operation.right], value);
+    break;
+
+  case FlatAst::OpCode::Multiplication:
+    node_failed = failed[operation.left] | failed[operation.right];
+    Ops::Multiply(values[operation.left], values[operation.right], value);
+    break;
+
+  case FlatAst::OpCode::Division:
+    node_failed = failed[operation.left] | failed[operation.right];
+    if (values[operation.right] == 0)
+    {
+      /* Undefined result encountered */
+      node_failed = 1;
+      break;
+    }
+
+    Ops::Divide(values[operation.left], values[operation.right], value);
+    break;
+
+  default: throw ExpressionParserErrors::UnknownOperatorException();
+  }
+
+  if (node_failed != 0)
+  {
+    value = 0;
+  }
+
+  if (values[node] == value && failed[node] == node_failed)
+  {
+    return false;
+  }
+
+  values[node] = value;
+  failed[node] = node_failed;
+  return true;
+}
\ No newline at end of file
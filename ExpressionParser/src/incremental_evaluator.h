@@ -0,0 +1,77 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "compiled_expression.h"
+#include "flat_ast.h"
+#include "result.h"
+
+/*
+ * Incremental Evaluator
+ *
+ * Keeps a compiled expression evaluated against a binding table which changes a few variables at a time. The value
+ * of every node is cached, together with the parent of each node and the nodes reading each variable, so Update
+ * only recomputes the nodes on the paths from the changed variable up to the root. A path is abandoned as soon as a
+ * recomputed node keeps its previous value, since nothing above it can change.
+ *
+ * Evaluation is unchecked int arithmetic, like CompiledExpression::Evaluate. A division by zero is remembered by
+ * the nodes above it rather than thrown, and is reported when the result is read.
+ *
+ * An evaluator copies the node table it needs, so the compiled expression may be discarded or shared once it has
+ * been created. The evaluator itself is mutable and used by one thread at a time.
+ */
+class IncrementalEvaluator
+{
+public:
+  IncrementalEvaluator(const CompiledExpression &expression, std::span<const int> bindings = {});
+
+  size_t Update(size_t slot, int value);
+
+  int getValue() const;
+
+  Result<int> TryGetValue() const;
+
+  int getBinding(size_t slot) const;
+
+private:
+  /*
+   * Evaluator Node
+   *
+   * A copy of one node of the expression's table, with its operation and operands held together. left holds the
+   * value of a literal, the binding slot of a variable, the operand of a negation and the left child of a binary
+   * node; right holds the right child of a binary node and is -1 otherwise.
+   */
+  struct Node
+  {
+    FlatAst::OpCode op;
+    int32_t left;
+    int32_t right;
+  };
+
+  bool recompute(FlatAst::NodeIndex node);
+
+  /* The expression's nodes, children before parents */
+  std::vector<Node> nodes;
+
+  /* Current value of each variable, indexed by slot */
+  std::vector<int> bindings;
+
+  /* Cached value of each node, and whether it depends on a division by zero (in which case its value is 0) */
+  std::vector<int> values;
+  std::vector<uint8_t> failed;
+
+  /* The node which reads each node's value; -1 for the root */
+  std::vector<FlatAst::NodeIndex> parents;
+
+  /* The variable nodes reading each slot: those of slot s are occurrences[occurrence_offsets[s]] onwards, up to
+     occurrence_offsets[s + 1] */
+  std::vector<size_t> occurrence_offsets;
+  std::vector<FlatAst::NodeIndex> occurrences;
+};
\ No newline at end of file
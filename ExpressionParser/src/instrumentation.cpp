@@ -0,0 +1,174 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*
+ * Thread Counters
+ *
+ * One thread's counters. Only the owning thread writes them, so each update is a plain load and store; they are
+ * atomic so that Snapshot may read them at the same time.
+ */
+struct Instrumentation::ThreadCounters
+{
+  ThreadCounters();
+  ~ThreadCounters();
+
+  void readInto(Statistics &statistics) const;
+
+  std::atomic<size_t> calls{0};
+  std::atomic<size_t> timed_calls{0};
+  std::atomic<uint64_t> phase_nanoseconds[phase_count] = {};
+  std::atomic<size_t> tokens{0};
+  std::atomic<size_t> nodes{0};
+  std::atomic<size_t> max_depth{0};
+  std::atomic<size_t> errors[error_kind_count] = {};
+};
+
+/*
+ * Instrumentation Registry
+ *
+ * The counters of every live thread, and the totals of threads which have exited
+ */
+struct Instrumentation::Registry
+{
+  std::mutex mutex;
+  std::vector<ThreadCounters *> threads;
+  Statistics retired;
+};
+
+/*
+ * Add
+ *
+ * Adds to a counter which only the calling thread writes
+ */
+template <typename T> static void add(std::atomic<T> &counter, T value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/*
+ * Snapshot
+ *
+ * @return The counters summed over every thread which has made a call. Each thread's counters are read without
+ *         pausing it, so a call in progress may be partly included.
+ */
+Instrumentation::Statistics Instrumentation::Snapshot()
+{
+  if constexpr (!enabled)
+  {
+    return Statistics();
+  }
+
+  Registry &threads = registry();
+  std::lock_guard<std::mutex> lock(threads.mutex);
+  Statistics statistics = threads.retired;
+  for (const ThreadCounters *counters : threads.threads)
+  {
+    counters->readInto(statistics);
+  }
+  return statistics;
+}
+
+/*
+ * Record
+ *
+ * Adds a finished call to the calling thread's counters
+ *
+ * @param call The call's measurements
+ * @param tokens Number of tokens lexed
+ * @param nodes Number of nodes parsed
+ * @param depth Deepest nesting of the descent
+ * @param kind The error the call failed with, or ErrorKind::None
+ */
+void Instrumentation::record(const Call &call, size_t tokens, size_t nodes, size_t depth,
+                             ExpressionParserErrors::ErrorKind kind)
+{
+  thread_local ThreadCounters counters;
+
+  add<size_t>(counters.calls, 1);
+  add(counters.tokens, tokens);
+  add(counters.nodes, nodes);
+  if (depth > counters.max_depth.load(std::memory_order_relaxed))
+  {
+    counters.max_depth.store(depth, std::memory_order_relaxed);
+  }
+
+  if (kind != ExpressionParserErrors::ErrorKind::None)
+  {
+    add<size_t>(counters.errors[static_cast<size_t>(kind)], 1);
+  }
+
+  if (call.timed)
+  {
+    add<size_t>(counters.timed_calls, 1);
+    for (size_t phase = 0; phase < phase_count; phase++)
+    {
+      add(counters.phase_nanoseconds[phase], call.phase_nanoseconds[phase]);
+    }
+  }
+}
+
+/*
+ * Registry
+ *
+ * @return The process's registry of thread counters
+ */
+Instrumentation::Registry &Instrumentation::registry()
+{
+  static Registry threads;
+  return threads;
+}
+
+/*
+ * Thread Counters Constructor
+ *
+ * Registers the calling thread's counters so that they are included in snapshots
+ */
+Instrumentation::ThreadCounters::ThreadCounters()
+{
+  Registry &threads = registry();
+  std::lock_guard<std::mutex> lock(threads.mutex);
+  threads.threads.push_back(this);
+}
+
+/*
+ * Thread Counters Destructor
+ *
+ * Runs as the thread exits, folding its counters into the registry's retired totals
+ */
+Instrumentation::ThreadCounters::~ThreadCounters()
+{
+  Registry &threads = registry();
+  std::lock_guard<std::mutex> lock(threads.mutex);
+  readInto(threads.retired);
+  threads.threads.erase(std::find(threads.threads.begin(), threads.threads.end(), this));
+}
+
+/*
+ * Read Into
+ *
+ * @param statistics Receives the sum of its counters and these
+ */
+void Instrumentation::ThreadCounters::readInto(Statistics &statistics) const
+{
+  statistics.calls += calls.load(std::memory_order_relaxed);
+  statistics.timed_calls += timed_calls.load(std::memory_order_relaxed);
+  for (size_t phase = 0; phase < phase_count; phase++)
+  {
+    statistics.phase_nanoseconds[phase] += phase_nanoseconds[phase].load(std::memory_order_relaxed);
+  }
+  statistics.tokens += tokens.load(std::memory_order_relaxed);
+  statistics.nodes += nodes.load(std::memory_order_relaxed);
+  statistics.max_depth = std::max(statistics.max_depth, max_depth.load(std::memory_order_relaxed));
+  for (size_t kind = 0; kind < error_kind_count; kind++)
+  {
+    statistics.errors[kind] += errors[kind].load(std::memory_order_relaxed);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "result.h"
+
+/* Define as 1 when building the library to collect instrumentation; otherwise every hook compiles to nothing */
+#ifndef PARSER_INSTRUMENTATION
+#define PARSER_INSTRUMENTATION 0
+#endif
+
+/* One call in this many is timed, so that reading the clock costs little on average */
+#define INSTRUMENTATION_TIMING_INTERVAL 16
+
+/*
+ * Instrumentation
+ *
+ * Counters describing the calls made to RDParser's Parse and Compile methods: the time spent in each phase, the
+ * tokens and nodes processed, the deepest recursion and the number of failures of each kind.
+ *
+ * Each thread counts into its own block, so recording a call takes no lock and shares no cache line with other
+ * threads; Snapshot sums the blocks of every thread, including threads which have exited. Phase times are only
+ * measured for one call in INSTRUMENTATION_TIMING_INTERVAL and are reported with the number of calls timed.
+ *
+ * Instrumentation is compiled in by defining PARSER_INSTRUMENTATION as 1. Otherwise Call's members are empty
+ * and Snapshot reports zeros.
+ */
+class Instrumentation
+{
+public:
+  static constexpr bool enabled = PARSER_INSTRUMENTATION != 0;
+
+  /*
+   * Phase
+   *
+   * A stage of a call. With the parser's default options, tokens are scanned as they are parsed and a parsed
+   * expression is evaluated as it is parsed, so the whole call is timed as Parse; the other phases are reported when
+   * they run separately.
+   */
+  enum class Phase
+  {
+    Lex,
+    Parse,
+    Evaluate,
+    Lower
+  };
+
+  static constexpr size_t phase_count = static_cast<size_t>(Phase::Lower) + 1;
+  static constexpr size_t error_kind_count =
+      static_cast<size_t>(ExpressionParserErrors::ErrorKind::UnboundVariable) + 1;
+
+  /*
+   * Instrumentation Statistics
+   *
+   * Counters summed over every thread
+   */
+  struct Statistics
+  {
+    size_t calls = 0;
+
+    /* Calls whose phases were timed, and the nanoseconds they spent in each phase, indexed by Phase */
+    size_t timed_calls = 0;
+    uint64_t phase_nanoseconds[phase_count] = {};
+
+    size_t tokens = 0;
+    size_t nodes = 0;
+
+    /* Most parentheses and negations the descent was nested in at once by any call */
+    size_t max_depth = 0;
+
+    /* Failed calls, indexed by the ErrorKind reported */
+    size_t errors[error_kind_count] = {};
+
+    uint64_t getPhaseNanoseconds(Phase phase) const { return phase_nanoseconds[static_cast<size_t>(phase)]; }
+
+    size_t getErrorCount(ExpressionParserErrors::ErrorKind kind) const { return errors[static_cast<size_t>(kind)]; }
+  };
+
+  static Statistics Snapshot();
+
+  /*
+   * Instrumented Call
+   *
+   * Measures one call on the calling thread
+   */
+  class Call
+  {
+  public:
+    /*
+     * Begin
+     *
+     * Starts measuring a call, timing it if it is the thread's next sample
+     */
+    void Begin()
+    {
+      if constexpr (enabled)
+      {
+        timed = calls_until_timed-- == 0;
+        if (timed)
+        {
+          calls_until_timed = INSTRUMENTATION_TIMING_INTERVAL - 1;
+          for (uint64_t &nanoseconds : phase_nanoseconds)
+          {
+            nanoseconds = 0;
+          }
+          phase_start = std::chrono::steady_clock::now();
+        }
+      }
+    }
+
+    /*
+     * End Phase
+     *
+     * Attributes the time since the previous phase ended, or the call began, to a phase
+     *
+     * @param phase The phase which has just finished
+     */
+    void EndPhase(Phase phase)
+    {
+      if constexpr (enabled)
+      {
+        if (timed)
+        {
+          const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+          phase_nanoseconds[static_cast<size_t>(phase)] +=
+              std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start).count();
+          phase_start = now;
+        }
+      }
+    }
+
+    /*
+     * Finish
+     *
+     * Adds the call to the calling thread's counters
+     *
+     * @param tokens Number of tokens lexed
+     * @param nodes Number of nodes parsed
+     * @param depth Deepest nesting of the descent
+     * @param kind The error the call failed with, or ErrorKind::None
+     */
+    void Finish(size_t tokens, size_t nodes, size_t depth, ExpressionParserErrors::ErrorKind kind)
+    {
+      if constexpr (enabled)
+      {
+        record(*this, tokens, nodes, depth, kind);
+      }
+    }
+
+  private:
+    friend class Instrumentation;
+
+    bool timed = false;
+    std::chrono::steady_clock::time_point phase_start;
+    uint64_t phase_nanoseconds[phase_count] = {};
+
+    /* Calls the thread makes before the next timed one */
+    static inline thread_local uint32_t calls_until_timed = 0;
+  };
+
+private:
+  struct ThreadCounters;
+  struct Registry;
+
+  static void record(const Call &call, size_t tokens, size_t nodes, size_t depth,
+                     ExpressionParserErrors::ErrorKind kind);
+
+  static Registry &registry();
+};
\ No newline at end of file
@@ -0,0 +1,372 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "iterative_parser.h"
+#include "errors.h"
+
+/*
+ * Binary OpCode
+ *
+ * Maps a binary operator token onto the opcode of the node it produces
+ *
+ * @param operation The token's operation
+ * @param op Receives the opcode performing the operation
+ * @return True if the token is a binary operator
+ */
+static bool binaryOpCode(Lexer::TokenOperation operation, FlatAst::OpCode &op)
+{
+  switch (operation)
+  {
+  case Lexer::TokenOperation::Addition: op = FlatAst::OpCode::Addition; return true;
+  case Lexer::TokenOperation::Subtraction: op = FlatAst::OpCode::Subtraction; return true;
+  case Lexer::TokenOperation::Multiplication: op = FlatAst::OpCode::Multiplication; return true;
+  case Lexer::TokenOperation::Division: op = FlatAst::OpCode::Division; return true;
+  default: return false;
+  }
+}
+
+/*
+ * Iterative Parser Constructor
+ *
+ * Uses the default depth limit and optimiser options
+ */
+IterativeParser::IterativeParser() {}
+
+/*
+ * Iterative Parser Constructor
+ *
+ * @param options Depth limit and simplifications applied to expressions returned by Compile
+ */
+IterativeParser::IterativeParser(const Options &options) : options(options) {}
+
+/*
+ * Parse
+ *
+ * @param expr View of the expression to parse. It is not copied and only needs to remain alive for this call.
+ * @return Result of the evaluated expression
+ */
+int IterativeParser::Parse(std::string_view expr) const
+{
+  return TryParse(expr).getValue();
+}
+
+/*
+ * Compile
+ *
+ * Variables are assigned binding table slots in order of first appearance
+ *
+ * @param expr View of the expression to compile. It is not copied and only needs to remain alive for this call.
+ * @return An immutable handle to the compiled expression
+ */
+CompiledExpression IterativeParser::Compile(std::string_view expr) const
+{
+  return TryCompile(expr).getValue();
+}
+
+/*
+ * Compile
+ *
+ * @param expr View of the expression to compile. It is not copied and only needs to remain alive for this call.
+ * @param variables Name of the variable bound to each slot
+ * @return An immutable handle to the compiled expression
+ */
+CompiledExpression IterativeParser::Compile(std::string_view expr, const std::vector<std::string> &variables) const
+{
+  return TryCompile(expr, variables).getValue();
+}
+
+/*
+ * Try Parse
+ *
+ * @param expr View of the expression to parse. It is not copied and only needs to remain alive for this call, and
+ *             for as long as the views held by an error are used.
+ * @return Result of the evaluated expression, or a description of the failure
+ */
+Result<int> IterativeParser::TryParse(std::string_view expr) const
+{
+  Context &context = threadContext();
+  if (!context.buildAst(expr, false, options.max_depth, options.invalid_token_limit))
+  {
+    return context.error;
+  }
+
+  int *values = context.node_arena.AllocateArray<int>(context.ast.getNodeCount());
+  int result;
+  if (!context.ast.TryEvaluate(values, nullptr, result))
+  {
+    context.fail(ExpressionParserErrors::ErrorKind::DivideByZero, {}, 0);
+    return context.error;
+  }
+
+  return result;
+}
+
+/*
+ * Try Compile
+ *
+ * @param expr View of the expression to compile. It is not copied and only needs to remain alive for this call, and
+ *             for as long as the views held by an error are used.
+ * @return An immutable handle to the compiled expression, or a description of the failure
+ */
+Result<CompiledExpression> IterativeParser::TryCompile(std::string_view expr) const
+{
+  Context &context = threadContext();
+  context.variable_names.clear();
+  context.variable_slots.clear();
+  context.variable_layout_fixed = false;
+
+  if (!context.buildAst(expr, true, options.max_depth, options.invalid_token_limit))
+  {
+    return context.error;
+  }
+
+  return buildProgram(context, std::vector<std::string>(context.variable_names.begin(), context.variable_names.end()));
+}
+
+/*
+ * Try Compile
+ *
+ * @param expr View of the expression to compile. It is not copied and only needs to remain alive for this call, and
+ *             for as long as the views held by an error are used.
+ * @param variables Name of the variable bound to each slot
+ * @return An immutable handle to the compiled expression, or a description of the failure
+ */
+Result<CompiledExpression> IterativeParser::TryCompile(std::string_view expr,
+                                                       const std::vector<std::string> &variables) const
+{
+  Context &context = threadContext();
+  context.variable_names.assign(variables.begin(), variables.end());
+  context.variable_slots.clear();
+  for (size_t slot = 0; slot < variables.size(); slot++)
+  {
+    context.variable_slots.emplace(variables[slot], static_cast<int32_t>(slot));
+  }
+  context.variable_layout_fixed = true;
+
+  if (!context.buildAst(expr, true, options.max_depth, options.invalid_token_limit))
+  {
+    return context.error;
+  }
+
+  return buildProgram(context, variables);
+}
+
+/*
+ * Thread Context
+ *
+ * @return The calling thread's parse context
+ */
+IterativeParser::Context &IterativeParser::threadContext()
+{
+  thread_local Context context;
+  return context;
+}
+
+/*
+ * Build Program
+ *
+ * Packages the node table most recently built by a context as a compiled expression
+ *
+ * @param context The context holding the node table
+ * @param variables Name of the variable bound to each slot
+ * @return An immutable handle to the compiled expression, or a description of the failure
+ */
+Result<CompiledExpression> IterativeParser::buildProgram(Context &context, std::vector<std::string> variables) const
+{
+  auto program = std::make_shared<CompiledExpression::Program>();
+  if (!AstOptimiser::Optimise(context.ast, program->storage, options.optimiser_options, program->ast))
+  {
+    context.fail(ExpressionParserErrors::ErrorKind::DivideByZero, {}, 0);
+    return context.error;
+  }
+  program->bytecode = Bytecode::Compile(program->ast);
+  program->variables = std::move(variables);
+
+  return CompiledExpression(std::move(program));
+}
+
+/*
+ * Parse Context Constructor
+ */
+IterativeParser::Context::Context() : variable_layout_fixed(false) {}
+
+/*
+ * Build AST
+ *
+ * Tokenises the expression and populates the node table. The loop alternates between parsing an operand, which is
+ * where RDParser's parseUnary and parsePrimary would be entered, and examining the token after it, which is where
+ * parseBinary's loop and parsePrimary's closing brace check would be. Opening a parenthesis pushes a frame in place
+ * of the recursive call to parseExpression and closing it pops the frame, so nodes are appended, and errors detected,
+ * in the same order as by the recursive descent.
+ *
+ * @param expr View of the expression to parse
+ * @param allow_variables True if identifiers are accepted as variables
+ * @param max_depth Number of parentheses which may be open at once
+ * @param invalid_token_limit Number of invalid characters after which lexing stops
+ * @return True if the table was built, otherwise false with the failure described by the error member
+ */
+bool IterativeParser::Context::buildAst(std::string_view expr, bool allow_variables, size_t max_depth,
+                                        size_t invalid_token_limit)
+{
+  error = ExpressionParserErrors::ErrorInfo();
+
+  lexer.clearTokens();
+  if (!lexer.TryTokenise(expr, allow_variables, error, invalid_token_limit))
+  {
+    return false;
+  }
+
+  /* Every node consumes at least one token, so the token count bounds the size of the table */
+  node_arena.Reset();
+  ast.Reset(node_arena, lexer.getTokenCount());
+
+  frames.clear();
+  frames.push_back(Frame{.left = 0, .has_left = false, .pending = FlatAst::OpCode::Addition, .negations = 0});
+
+  const size_t token_count = lexer.getTokenCount();
+  size_t token_idx = 0;
+  while (true)
+  {
+    /* 'Unary -> ("-") Unary' */
+    while (token_idx < token_count && lexer.getToken(token_idx).operation == Lexer::TokenOperation::Subtraction)
+    {
+      frames.back().negations++;
+      token_idx++;
+    }
+
+    /* 'Primary -> Literal | Identifier | "(" Expression ")"' */
+    if (token_idx >= token_count)
+    {
+      /* Out of tokens where an operand was required; the last token is reported, as by RDParser */
+      const Lexer::Token &last_token = lexer.getToken(token_count - 1);
+      return fail(ExpressionParserErrors::ErrorKind::UnexpectedToken, last_token.raw, last_token.position);
+    }
+
+    const Lexer::Token &token = lexer.getToken(token_idx);
+    FlatAst::NodeIndex operand;
+    if (token.operation == Lexer::TokenOperation::Literal)
+    {
+      operand = ast.AddLiteral(token.value);
+      token_idx++;
+    }
+    else if (token.operation == Lexer::TokenOperation::Identifier)
+    {
+      const int32_t slot = resolveVariable(token.raw);
+      if (slot < 0)
+      {
+        return fail(ExpressionParserErrors::ErrorKind::UnknownVariable, token.raw, token.position);
+      }
+
+      operand = ast.AddVariable(slot);
+      token_idx++;
+    }
+    else if (token.operation == Lexer::TokenOperation::L_Brace)
+    {
+      if (frames.size() > max_depth)
+      {
+        return fail(ExpressionParserErrors::ErrorKind::NestingTooDeep, token.raw, token.position);
+      }
+
+      frames.push_back(Frame{.left = 0, .has_left = false, .pending = FlatAst::OpCode::Addition, .negations = 0});
+      token_idx++;
+      continue;
+    }
+    else
+    {
+      return fail(ExpressionParserErrors::ErrorKind::UnexpectedToken, token.raw, token.position);
+    }
+
+    /* Complete the operand and every parenthesis it closes */
+    while (true)
+    {
+      Frame &frame = frames.back();
+      for (; frame.negations > 0; frame.negations--)
+      {
+        operand = ast.AddUnary(operand);
+      }
+
+      operand = frame.has_left ? ast.AddBinary(frame.pending, frame.left, operand) : operand;
+      frame.left = operand;
+      frame.has_left = true;
+
+      /* 'Binary -> Unary | (("*" | "/" | "+" | "-") Unary)*' */
+      if (token_idx < token_count && binaryOpCode(lexer.getToken(token_idx).operation, frame.pending))
+      {
+        token_idx++;
+        break;
+      }
+
+      if (frames.size() == 1)
+      {
+        if (token_idx < token_count)
+        {
+          /* Only a misplaced parenthesis can stop the top level before the end of the tokens */
+          const Lexer::Token &stray_token = lexer.getToken(token_idx);
+          return fail(ExpressionParserErrors::ErrorKind::UnexpectedParentheses, stray_token.raw,
+                      stray_token.position);
+        }
+
+        /* The root is the last node added to the table */
+        return true;
+      }
+
+      if (token_idx >= token_count || lexer.getToken(token_idx).operation != Lexer::TokenOperation::R_Brace)
+      {
+        /* Report where the closing brace was expected */
+        const size_t position = token_idx < token_count ? lexer.getToken(token_idx).position : error.expression.size();
+        return fail(ExpressionParserErrors::ErrorKind::ParenthesesMismatch, {}, position);
+      }
+
+      /* The parenthesised expression is an operand of the enclosing frame */
+      token_idx++;
+      frames.pop_back();
+    }
+  }
+}
+
+/*
+ * Fail
+ *
+ * Records a parse failure
+ *
+ * @param kind What went wrong
+ * @param token The offending token's characters
+ * @param position Zero-based offset of the offending token within the expression
+ * @return False, for the caller to return
+ */
+bool IterativeParser::Context::fail(ExpressionParserErrors::ErrorKind kind, std::string_view token, size_t position)
+{
+  error.kind = kind;
+  error.token = token;
+  error.position = position;
+  return false;
+}
+
+/*
+ * Resolve Variable
+ *
+ * Maps a variable name onto its binding table slot, assigning the next free slot to names seen for the first time
+ * unless the caller fixed the layout.
+ *
+ * @param name Name of the variable as written in the expression
+ * @return Slot the variable's value is read from, or -1 if the name is not part of a fixed layout
+ */
+int32_t IterativeParser::Context::resolveVariable(std::string_view name)
+{
+  auto existing = variable_slots.find(name);
+  if (existing != variable_slots.end())
+  {
+    return existing->second;
+  }
+
+  if (variable_layout_fixed)
+  {
+    return -1;
+  }
+
+  const int32_t slot = static_cast<int32_t>(variable_names.size());
+  variable_names.push_back(name);
+  variable_slots.emplace(name, slot);
+  return slot;
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+#include "compiled_expression.h"
+#include "flat_ast.h"
+#include "lexer.h"
+#include "optimiser.h"
+#include "result.h"
+
+#define ITERATIVE_PARSER_MAX_DEPTH 10000
+
+/*
+ * Iterative Parser
+ *
+ * Accepts the same grammar as RDParser and builds the same node table, reporting the same errors, but drives the
+ * descent from an explicit stack instead of the call stack. One frame is pushed per open parenthesis and leading
+ * negations are counted rather than nested, so the memory a parse needs is bounded by its nesting depth and no input
+ * can exhaust the thread's stack. Expressions nested more deeply than the configured maximum are rejected with
+ * NestingTooDeepException; that check is made as each parenthesis is opened, so it takes precedence over any error
+ * later in the expression.
+ *
+ * As with RDParser, a parser holds only its configuration and the scratch state of each call belongs to the calling
+ * thread, so a single parser may be shared between threads.
+ */
+class IterativeParser
+{
+public:
+  /*
+   * Iterative Parser Options
+   *
+   * Configuration of a parser
+   */
+  struct Options
+  {
+    /* Number of parentheses which may be open at once */
+    size_t max_depth = ITERATIVE_PARSER_MAX_DEPTH;
+
+    /* Simplifications applied to compiled expressions */
+    AstOptimiser::Options optimiser_options;
+
+    /* Number of invalid characters after which lexing stops (see RDParser::Options) */
+    size_t invalid_token_limit = LEXER_NO_INVALID_TOKEN_LIMIT;
+  };
+
+  IterativeParser();
+  explicit IterativeParser(const Options &options);
+  int Parse(std::string_view expr) const;
+  CompiledExpression Compile(std::string_view expr) const;
+  CompiledExpression Compile(std::string_view expr, const std::vector<std::string> &variables) const;
+  Result<int> TryParse(std::string_view expr) const;
+  Result<CompiledExpression> TryCompile(std::string_view expr) const;
+  Result<CompiledExpression> TryCompile(std::string_view expr, const std::vector<std::string> &variables) const;
+
+private:
+  /*
+   * Parse Frame
+   *
+   * The state of one 'Binary' production: the top level of the expression or the contents of a parenthesis
+   */
+  struct Frame
+  {
+    /* Node holding the value of the operands combined so far, if any have been parsed */
+    FlatAst::NodeIndex left;
+    bool has_left;
+
+    /* Operator combining the next operand with left */
+    FlatAst::OpCode pending;
+
+    /* Number of negations preceding the operand being parsed */
+    size_t negations;
+  };
+
+  /*
+   * Parse Context
+   *
+   * The scratch state of one call, owned by the calling thread and reused across calls (and parsers)
+   */
+  struct Context
+  {
+    Context();
+
+    bool buildAst(std::string_view expr, bool allow_variables, size_t max_depth, size_t invalid_token_limit);
+    bool fail(ExpressionParserErrors::ErrorKind kind, std::string_view token, size_t position);
+    int32_t resolveVariable(std::string_view name);
+
+    /* Instance of the lexical analyser class responsible for generating tokens */
+    Lexer lexer;
+
+    /* Storage for the AST of the expression currently being parsed */
+    Arena node_arena;
+
+    /* Node table the parse populates */
+    FlatAst ast;
+
+    /* Open productions, innermost last; the memory is kept between calls */
+    std::vector<Frame> frames;
+
+    /* Description of the failure of the most recent call */
+    ExpressionParserErrors::ErrorInfo error;
+
+    /* Names of the variables of the expression being compiled, in slot order, and the reverse mapping */
+    std::vector<std::string_view> variable_names;
+    std::unordered_map<std::string_view, int32_t> variable_slots;
+
+    /* True if variable slots are fixed by the caller and unknown names are an error */
+    bool variable_layout_fixed;
+  };
+
+  static Context &threadContext();
+
+  Result<CompiledExpression> buildProgram(Context &context, std::vector<std::string> variables) const;
+
+  /* Depth limit and optimiser configuration */
+  Options options;
+};
\ No newline at end of file
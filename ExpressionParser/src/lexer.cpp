@@ -5,43 +5,75 @@
 #include "lexer.h"
 #include "errors.h"
 
+#include <limits>
+
 Lexer::Lexer() : expression(UNINITIALISED_EXPRESSION) {}
 
 /*
  * Tokenisation
  *
- * Populates the lexical analyser's token vector using regular expression.
- * Regular expressions are simple to use, time-efficient and able to deal with the limited syntax
- * present within arithmetic expresions.
+ * Populates the lexical analyser's token vector, throwing the exception matching any error (see TryTokenise)
  *
  * @param expr The expression to convert to tokens
+ * @param allow_identifiers True if variable names ([A-Za-z_][A-Za-z0-9_]*) are permitted, otherwise letters are
+ *                          reported as invalid tokens
+ * @param invalid_token_limit Number of invalid characters after which the expression is no longer scanned
  */
-void Lexer::Tokenise(const std::string &expr)
+void Lexer::Tokenise(std::string_view expr, bool allow_identifiers, size_t invalid_token_limit)
 {
-  expression = expr;
-
-  /* Collect invalid tokens using regular expression pattern. If any exist, this is an error condition. */
-  std::vector<std::string> invalid_tokens = regexFindSubstrings(REGEX_INVALID_TOKEN_PATTERN);
-  if (!invalid_tokens.empty())
+  ExpressionParserErrors::ErrorInfo error;
+  if (!TryTokenise(expr, allow_identifiers, error, invalid_token_limit))
   {
-    throw ExpressionParserErrors::InvalidTokenException(invalid_tokens);
+    error.Throw();
   }
+}
 
-  /* Find valid tokens using regular expression. If none are found, this is an issue. */
-  std::vector<std::string> valid_tokens = regexFindSubstrings(REGEX_TOKEN_PATTERN);
-  if (valid_tokens.empty())
-  {
-    throw ExpressionParserErrors::EmptyExpressionException();
-  }
+/*
+ * Try Tokenisation
+ *
+ * Populates the lexical analyser's token vector in a single pass over the expression.
+ * Each character is classified as it is visited and literals are converted to their integer value as their digits
+ * are consumed, so no intermediate substrings are created. Tokens refer back into the caller's buffer, which must
+ * outlive them. Errors are reported through the error argument rather than thrown, and without allocating.
+ *
+ * Invalid characters take precedence over every other error, so once invalid_token_limit of them have been found
+ * nothing later in the expression can change the outcome and the scan stops there. The error is the same as by a
+ * full scan except that only the first invalid_token_limit characters are counted (see ErrorInfo::truncated), which
+ * bounds the cost of rejecting a large expression of garbage.
+ *
+ * @param expr The expression to convert to tokens
+ * @param allow_identifiers True if variable names ([A-Za-z_][A-Za-z0-9_]*) are permitted, otherwise letters are
+ *                          reported as invalid tokens
+ * @param error Receives the description of the failure, if any
+ * @param invalid_token_limit Number of invalid characters after which the expression is no longer scanned;
+ *                            LEXER_NO_INVALID_TOKEN_LIMIT scans it all
+ * @return True if the expression was tokenised, false if it is invalid
+ */
+bool Lexer::TryTokenise(std::string_view expr, bool allow_identifiers, ExpressionParserErrors::ErrorInfo &error,
+                        size_t invalid_token_limit)
+{
+  expression = expr;
+
+  /* Tokens from this call are appended; remember where they start so a failed call leaves the vector untouched */
+  const size_t first_token_idx = token_container.size();
 
-  /* Parse each token found and create a struct representation */
-  for (const std::string &raw_token : valid_tokens)
+  /* Invalid characters are counted over the expression, up to the limit, before reporting. Only the first is
+     remembered; the rest are found again if the caller asks for them. */
+  const size_t invalid_limit =
+      invalid_token_limit == LEXER_NO_INVALID_TOKEN_LIMIT ? std::numeric_limits<size_t>::max() : invalid_token_limit;
+  size_t invalid_count = 0;
+  size_t first_invalid_position = 0;
+  bool literal_out_of_range = false;
+
+  size_t position = 0;
+  while (position < expression.size() && invalid_count < invalid_limit)
   {
-    char token_type = raw_token[0];
-    Token token{.operation = TokenOperation::None, .value = TOKEN_VALUE_NOT_APPLICABLE, .raw = raw_token};
+    const char character = expression[position];
+    Token token{.operation = TokenOperation::None, .value = TOKEN_VALUE_NOT_APPLICABLE, .raw = {}, .position = position};
 
-    switch (token_type)
+    switch (character)
     {
+    case ' ': position++; continue;
     case '(': token.operation = TokenOperation::L_Brace; break;
     case ')': token.operation = TokenOperation::R_Brace; break;
     case '-': token.operation = TokenOperation::Subtraction; break;
@@ -49,15 +81,101 @@ void Lexer::Tokenise(const std::string &expr)
     case '*': token.operation = TokenOperation::Multiplication; break;
     case '/': token.operation = TokenOperation::Division; break;
     default:
-      /* If this token is not any of the above, it can only be a number.
-         We save its value for later evaluation. */
+      if (allow_identifiers && isIdentifierStart(character))
+      {
+        /* Consume the whole name; the parser resolves it to a variable slot */
+        token.operation = TokenOperation::Identifier;
+        while (position < expression.size() &&
+               (isIdentifierStart(expression[position]) || isDigit(expression[position])))
+        {
+          position++;
+        }
+
+        if (invalid_count == 0)
+        {
+          token.raw = expression.substr(token.position, position - token.position);
+          token_container.push_back(token);
+        }
+        continue;
+      }
+
+      if (!isDigit(character))
+      {
+        if (invalid_count++ == 0)
+        {
+          first_invalid_position = position;
+        }
+        position++;
+        continue;
+      }
+
+      /* Consume the run of digits, accumulating the literal's value as we go */
       token.operation = TokenOperation::Literal;
-      token.value = std::stoi(raw_token);
-      break;
+      token.value = 0;
+      {
+        while (position < expression.size() && isDigit(expression[position]))
+        {
+          const int digit = expression[position] - '0';
+          if (token.value > (std::numeric_limits<int>::max() - digit) / 10)
+          {
+            literal_out_of_range = true;
+          }
+          else
+          {
+            token.value = token.value * 10 + digit;
+          }
+          position++;
+        }
+
+        /* Once an error has been found there is no need to keep building tokens, only to finish scanning */
+        if (invalid_count == 0)
+        {
+          token.raw = expression.substr(token.position, position - token.position);
+          token_container.push_back(token);
+        }
+      }
+      continue;
     }
 
-    token_container.push_back(token);
+    if (invalid_count == 0)
+    {
+      token.raw = expression.substr(position, 1);
+      token_container.push_back(token);
+    }
+    position++;
   }
+
+  error.expression = expression;
+  error.identifiers_allowed = allow_identifiers;
+
+  /* If any invalid characters were found, this is an error condition. */
+  if (invalid_count != 0)
+  {
+    token_container.resize(first_token_idx);
+    error.kind = ExpressionParserErrors::ErrorKind::InvalidToken;
+    error.position = first_invalid_position;
+    error.token = expression.substr(first_invalid_position, 1);
+    error.count = invalid_count;
+    error.truncated = position < expression.size();
+    return false;
+  }
+
+  /* A literal too large to be represented; reported the same way std::stoi would. */
+  if (literal_out_of_range)
+  {
+    token_container.resize(first_token_idx);
+    error.kind = ExpressionParserErrors::ErrorKind::LiteralOutOfRange;
+    return false;
+  }
+
+  /* If no valid tokens are found, this is an issue. */
+  if (token_container.size() == first_token_idx)
+  {
+    error.kind = ExpressionParserErrors::ErrorKind::EmptyExpression;
+    return false;
+  }
+
+  return true;
 }
 
 /*
@@ -98,28 +216,4 @@ void Lexer::clearTokens()
 {
   token_container.clear();
   expression = UNINITIALISED_EXPRESSION;
-}
-
-/*
- * Regular Expression Find Substrings
- *
- * Uses regular expressions to find substrings according to the provided pattern.
- *
- * @param pattern Reference to the pattern string to match
- * @return An array of substrings which met the pattern criteria
- */
-std::vector<std::string> Lexer::regexFindSubstrings(const std::string &pattern) const
-{
-  std::vector<std::string> output;
-  std::regex token_pattern(pattern);
-
-  auto tokens_begin = std::sregex_iterator(expression.begin(), expression.end(), token_pattern);
-  auto tokens_end = std::sregex_iterator();
-
-  for (auto it = tokens_begin; it != tokens_end; it++)
-  {
-    output.push_back(it->str());
-  }
-
-  return output;
 }
\ No newline at end of file
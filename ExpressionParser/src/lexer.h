@@ -4,15 +4,17 @@
  */
 #pragma once
 
-#include <regex>
-#include <string>
+#include <string_view>
 #include <vector>
 
-#define REGEX_TOKEN_PATTERN "((\\d+|[-+*\/()]))"
-#define REGEX_INVALID_TOKEN_PATTERN "([^0-9+\\- *\/()])"
+#include "result.h"
+
 #define TOKEN_VALUE_NOT_APPLICABLE -1
 #define UNINITIALISED_EXPRESSION "Uninit"
 
+/* Passed as an invalid token limit to report every invalid character in the expression */
+#define LEXER_NO_INVALID_TOKEN_LIMIT 0
+
 /*
  * Lexical Analyser
  *
@@ -31,6 +33,7 @@ public:
   {
     None,
     Literal,
+    Identifier,
     L_Brace,
     R_Brace,
     Subtraction,
@@ -49,16 +52,25 @@ public:
     /* Operation the token represents */
     TokenOperation operation;
 
-    /* Value of any literal types, TOKEN_VALUE_NOT_APPLICABLE for non-literal token operations */
+    /* Value of any literal types, TOKEN_VALUE_NOT_APPLICABLE for non-literal token operations. Identifiers are
+       named by their raw text. */
     int value;
 
-    /* A raw representation of the token as a string. Useful for providing additional error information. */
-    std::string raw;
+    /* A view of the token's characters within the tokenised expression. Useful for providing additional error
+       information; only valid while the expression's buffer is alive. */
+    std::string_view raw;
+
+    /* Zero-based offset of the token's first character within the expression */
+    size_t position;
   };
 
   Lexer();
 
-  void Tokenise(const std::string &expr);
+  void Tokenise(std::string_view expr, bool allow_identifiers = false,
+                size_t invalid_token_limit = LEXER_NO_INVALID_TOKEN_LIMIT);
+
+  bool TryTokenise(std::string_view expr, bool allow_identifiers, ExpressionParserErrors::ErrorInfo &error,
+                   size_t invalid_token_limit = LEXER_NO_INVALID_TOKEN_LIMIT);
 
   const Token &getToken(const int &token_idx);
 
@@ -66,12 +78,75 @@ public:
 
   void clearTokens();
 
+  /*
+   * Is Invalid Character
+   *
+   * Checks whether a character may appear anywhere in an expression. Every character's validity is independent of
+   * its neighbours, which lets the characters reported by TryTokenise be found again later.
+   *
+   * @param character The character to classify
+   * @param allow_identifiers True if letters and underscores are permitted
+   * @return True if the lexer reports the character as an invalid token
+   */
+  static constexpr bool isInvalidCharacter(const char &character, bool allow_identifiers)
+  {
+    switch (character)
+    {
+    case ' ':
+    case '(':
+    case ')':
+    case '-':
+    case '+':
+    case '*':
+    case '/': return false;
+    default: return !isDigit(character) && !(allow_identifiers && isIdentifierStart(character));
+    }
+  }
+
+  /*
+   * Is Word Character
+   *
+   * Checks whether a character may be part of a literal or identifier, so that two of them separated by a space
+   * would be lexed as one token if the space were removed
+   *
+   * @param character The character to classify
+   * @return True if the character is a digit, ASCII letter or underscore
+   */
+  static constexpr bool isWordCharacter(const char &character)
+  {
+    return isDigit(character) || isIdentifierStart(character);
+  }
+
+  /*
+   * Is Digit
+   *
+   * Locale-independent check for the characters that make up a literal.
+   *
+   * @param character The character to classify
+   * @return True if the character is in the range '0' to '9'
+   */
+  static constexpr bool isDigit(const char &character)
+  {
+    return character >= '0' && character <= '9';
+  }
+
 private:
-  std::vector<std::string> regexFindSubstrings(const std::string &pattern) const;
+  /*
+   * Is Identifier Start
+   *
+   * Locale-independent check for the characters that may begin (or continue) a variable name.
+   *
+   * @param character The character to classify
+   * @return True if the character is an ASCII letter or underscore
+   */
+  static constexpr bool isIdentifierStart(const char &character)
+  {
+    return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || character == '_';
+  }
 
   /* A vector to store extracted tokens */
   std::vector<Token> token_container;
 
-  /* The arithmetic expression that will be tokenised */
-  std::string expression;
+  /* The arithmetic expression that will be tokenised. A view onto the caller's buffer; it is never copied. */
+  std::string_view expression;
 };
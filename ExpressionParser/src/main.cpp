@@ -5,21 +5,51 @@
  * A recursive descent (LL) parser for simple arithmic expressions with modified operator
  * precedence.
  */
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
 #include <iostream>
+#include <string>
 
+#include "bulk_evaluator.h"
+#include "evaluation_service.h"
+#include "mapped_file.h"
 #include "rd_parser.h"
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 bool evaluate(const char *expression, int &result);
+int evaluateFile(int argc, char **argv);
+int serve(int argc, char **argv);
 
 /*
  * Entry Point
  *
  * The initial point of entry for the recursive descent parsing application.
+ * Given a file, evaluates every line of it (see evaluateFile); given --serve, evaluates lines from standard input as
+ * they arrive (see serve); otherwise evaluates a sample expression.
  *
+ * @param argc Number of command line arguments
+ * @param argv Command line arguments
  * @return Exit Reason
  */
-int main()
+int main(int argc, char **argv)
 {
+  if (argc > 1 && std::strcmp(argv[1], "--serve") == 0)
+  {
+    return serve(argc, argv);
+  }
+
+  if (argc > 1)
+  {
+    return evaluateFile(argc, argv);
+  }
+
   int result = -1;
   if (evaluate("5+6*6", result))
   {
@@ -44,17 +74,173 @@ int main()
  */
 bool evaluate(const char *expression, int &result)
 {
+  /* Employs a top-down approach (Recursive Descent) to evaluate the expression due to the simplicity of the grammar.
+     Malformed expressions are reported through the result rather than thrown; the message is only built here. The
+     parser keeps no per-call state, so one instance serves every call, and evaluates as it parses without
+     allocating. */
+  static const RDParser recursive_descent_parser;
+  Result<int> evaluation = recursive_descent_parser.TryParse(expression);
+  if (!evaluation)
+  {
+    std::cerr << "Error: " << evaluation.getError().Message() << std::endl;
+    result = -1;
+    return false;
+  }
+
+  result = evaluation.getValue();
+  return true;
+}
+
+/*
+ * Evaluate File
+ *
+ * Bulk mode: evaluates a file holding one expression per line and writes one result per line, in order.
+ * Usage: ExpressionParser <file> [--binary] [--output <file>] [--threads <count>]
+ *
+ * @param argc Number of command line arguments
+ * @param argv Command line arguments
+ * @return 0 if every line was evaluated, 1 if any line failed and 2 for a usage or file error
+ */
+int evaluateFile(int argc, char **argv)
+{
+  BulkEvaluator::Options options;
+  const char *output_path = nullptr;
+
+  for (int arg = 2; arg < argc; arg++)
+  {
+    if (std::strcmp(argv[arg], "--binary") == 0)
+    {
+      options.format = BulkEvaluator::OutputFormat::Binary;
+    }
+    else if (std::strcmp(argv[arg], "--output") == 0 && arg + 1 < argc)
+    {
+      output_path = argv[++arg];
+    }
+    else if (std::strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc)
+    {
+      options.thread_count = std::strtoul(argv[++arg], nullptr, 10);
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " <file> [--binary] [--output <file>] [--threads <count>]" << std::endl;
+      return 2;
+    }
+  }
+
   try
   {
-    /* Employs a top-down approach (Recursive Descent) to evaluate the expression due to the simplicity of the grammar. */
-    RDParser recursive_descent_parser;
-    result = recursive_descent_parser.Parse(expression);
-    return true;
+    MappedFile input(argv[1]);
+
+    std::FILE *output = stdout;
+    if (output_path != nullptr)
+    {
+      output = std::fopen(output_path, options.format == BulkEvaluator::OutputFormat::Binary ? "wb" : "w");
+      if (output == nullptr)
+      {
+        std::cerr << "Error: Unable to open " << output_path << std::endl;
+        return 2;
+      }
+    }
+#ifdef _WIN32
+    else if (options.format == BulkEvaluator::OutputFormat::Binary)
+    {
+      _setmode(_fileno(stdout), _O_BINARY);
+    }
+#endif
+
+    const size_t failures = BulkEvaluator(options).Run(input.getContents(), output, stderr);
+    if (output != stdout)
+    {
+      std::fclose(output);
+    }
+
+    return failures == 0 ? 0 : 1;
   }
   catch (const std::exception &e)
   {
     std::cerr << "Error: " << e.what() << std::endl;
-    result = -1;
-    return false;
+    return 2;
+  }
+}
+
+/*
+ * Serve
+ *
+ * Service mode: evaluates the expressions read from standard input, one per line, through an EvaluationService and
+ * writes one result per line in input order, as the bulk mode's text output does. Each line is submitted as soon as
+ * it is read and results are written as they complete, so batches are evaluated while later lines are arriving.
+ * Usage: ExpressionParser --serve [--batch <size>] [--latency <microseconds>] [--threads <count>]
+ *
+ * @param argc Number of command line arguments
+ * @param argv Command line arguments
+ * @return 0 if every line was evaluated, 1 if any line failed and 2 for a usage error
+ */
+int serve(int argc, char **argv)
+{
+  EvaluationService::Options options;
+
+  for (int arg = 2; arg < argc; arg++)
+  {
+    if (std::strcmp(argv[arg], "--batch") == 0 && arg + 1 < argc)
+    {
+      options.batch_size = std::strtoul(argv[++arg], nullptr, 10);
+    }
+    else if (std::strcmp(argv[arg], "--latency") == 0 && arg + 1 < argc)
+    {
+      options.max_latency = std::chrono::microseconds(std::strtoul(argv[++arg], nullptr, 10));
+    }
+    else if (std::strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc)
+    {
+      options.thread_count = std::strtoul(argv[++arg], nullptr, 10);
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " --serve [--batch <size>] [--latency <microseconds>] [--threads <count>]"
+                << std::endl;
+      return 2;
+    }
+  }
+
+  EvaluationService service(options);
+  std::deque<std::future<int>> outstanding;
+  size_t failures = 0;
+
+  /* Writes the result of the oldest outstanding line, waiting for it if needed */
+  auto write_oldest = [&outstanding, &failures]
+  {
+    try
+    {
+      std::cout << outstanding.front().get() << '\n';
+    }
+    catch (const std::exception &e)
+    {
+      std::cout << "error: " << e.what() << '\n';
+      failures++;
+    }
+    outstanding.pop_front();
+  };
+
+  std::string line;
+  while (std::getline(std::cin, line))
+  {
+    if (!line.empty() && line.back() == '\r')
+    {
+      line.pop_back();
+    }
+    outstanding.push_back(service.Submit(std::move(line)));
+
+    while (!outstanding.empty() &&
+           outstanding.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+      write_oldest();
+    }
+  }
+
+  while (!outstanding.empty())
+  {
+    write_oldest();
   }
+  std::cout.flush();
+
+  return failures == 0 ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+/*
+ * Mapped File Constructor
+ *
+ * Maps the whole file read-only. Throws std::runtime_error if it cannot be opened or mapped.
+ *
+ * @param path Path of the file to map
+ */
+MappedFile::MappedFile(const std::string &path)
+    : data(nullptr), size(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr)
+{
+  file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file_handle == INVALID_HANDLE_VALUE)
+  {
+    throw std::runtime_error("MappedFile:: Unable to open " + path);
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file_handle, &file_size))
+  {
+    CloseHandle(file_handle);
+    throw std::runtime_error("MappedFile:: Unable to read the size of " + path);
+  }
+
+  size = static_cast<size_t>(file_size.QuadPart);
+  if (size == 0)
+  {
+    return;
+  }
+
+  mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_handle != nullptr)
+  {
+    data = static_cast<const char *>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+  }
+
+  if (data == nullptr)
+  {
+    if (mapping_handle != nullptr)
+    {
+      CloseHandle(mapping_handle);
+    }
+    CloseHandle(file_handle);
+    throw std::runtime_error("MappedFile:: Unable to map " + path);
+  }
+}
+
+/*
+ * Mapped File Destructor
+ *
+ * Unmaps the view and closes the file
+ */
+MappedFile::~MappedFile()
+{
+  if (data != nullptr)
+  {
+    UnmapViewOfFile(data);
+  }
+  if (mapping_handle != nullptr)
+  {
+    CloseHandle(mapping_handle);
+  }
+  CloseHandle(file_handle);
+}
+
+#else
+
+/*
+ * Mapped File Constructor
+ *
+ * Maps the whole file read-only. Throws std::runtime_error if it cannot be opened or mapped.
+ *
+ * @param path Path of the file to map
+ */
+MappedFile::MappedFile(const std::string &path) : data(nullptr), size(0)
+{
+  const int descriptor = open(path.c_str(), O_RDONLY);
+  if (descriptor < 0)
+  {
+    throw std::runtime_error("MappedFile:: Unable to open " + path);
+  }
+
+  struct stat status;
+  if (fstat(descriptor, &status) != 0)
+  {
+    close(descriptor);
+    throw std::runtime_error("MappedFile:: Unable to read the size of " + path);
+  }
+
+  size = static_cast<size_t>(status.st_size);
+  if (size != 0)
+  {
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (mapping == MAP_FAILED)
+    {
+      close(descriptor);
+      throw std::runtime_error("MappedFile:: Unable to map " + path);
+    }
+
+    /* The file is read front to back once */
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<const char *>(mapping);
+  }
+
+  /* The mapping keeps the file alive */
+  close(descriptor);
+}
+
+/*
+ * Mapped File Destructor
+ *
+ * Unmaps the file
+ */
+MappedFile::~MappedFile()
+{
+  if (data != nullptr)
+  {
+    munmap(const_cast<char *>(data), size);
+  }
+}
+
+#endif
+
+/*
+ * Get Contents
+ *
+ * @return View of the whole file, valid for the lifetime of the mapping
+ */
+std::string_view MappedFile::getContents() const
+{
+  return std::string_view(data, data == nullptr ? 0 : size);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+ * Mapped File
+ *
+ * A read-only memory mapping of a whole file, so that its contents can be viewed without being copied into the
+ * process. Uses mmap on POSIX systems and a file mapping object on Windows. The mapping is released on destruction.
+ */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string &path);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile();
+
+  std::string_view getContents() const;
+
+private:
+  /* Start and length of the mapped view; null and zero for an empty file, which cannot be mapped */
+  const char *data;
+  size_t size;
+
+#ifdef _WIN32
+  /* Handles of the open file and of its mapping object */
+  void *file_handle;
+  void *mapping_handle;
+#endif
+};
\ No newline at end of file
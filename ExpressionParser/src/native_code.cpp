@@ -0,0 +1,357 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "native_code.h"
+
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(_WIN32) || defined(__unix__) || defined(__APPLE__))
+#define NATIVE_CODE_SUPPORTED
+#endif
+
+#ifdef NATIVE_CODE_SUPPORTED
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+#ifdef NATIVE_CODE_SUPPORTED
+
+/*
+ * Machine Code
+ *
+ * The instructions of a function being generated, and the offsets of the jumps still to be pointed at its division
+ * by zero exit
+ */
+struct MachineCode
+{
+  std::vector<uint8_t> bytes;
+  std::vector<size_t> exit_jumps;
+
+  void emit(std::initializer_list<uint8_t> instruction) { bytes.insert(bytes.end(), instruction); }
+
+  void emit32(int32_t value)
+  {
+    uint8_t encoded[sizeof(value)];
+    std::memcpy(encoded, &value, sizeof(value));
+    bytes.insert(bytes.end(), encoded, encoded + sizeof(value));
+  }
+
+  /* jz or jmp (rel32) to the division by zero exit */
+  void emitExitJump(std::initializer_list<uint8_t> opcode)
+  {
+    emit(opcode);
+    exit_jumps.push_back(bytes.size());
+    emit32(0);
+  }
+};
+
+/*
+ * Emit Fused Operation
+ *
+ * Emits a binary operation whose right-hand operand, a literal or a variable, is used in place rather than pushed.
+ * The accumulator (eax) holds the left-hand operand and receives the result; the binding table is addressed by r10.
+ *
+ * @param code The function being generated
+ * @param op The binary operation
+ * @param operand The push instruction supplying the right-hand operand
+ */
+static void emitFused(MachineCode &code, Bytecode::OpCode op, const Bytecode::Instruction &operand)
+{
+  const bool literal = operand.op == Bytecode::OpCode::PushLiteral;
+  const int32_t value = literal ? operand.operand : operand.operand * static_cast<int32_t>(sizeof(int32_t));
+
+  switch (op)
+  {
+  case Bytecode::OpCode::Addition:
+    literal ? code.emit({0x05}) : code.emit({0x41, 0x03, 0x82}); /* add eax, imm32 | add eax, [r10 + disp32] */
+    code.emit32(value);
+    return;
+
+  case Bytecode::OpCode::Subtraction:
+    literal ? code.emit({0x2D}) : code.emit({0x41, 0x2B, 0x82}); /* sub eax, imm32 | sub eax, [r10 + disp32] */
+    code.emit32(value);
+    return;
+
+  case Bytecode::OpCode::Multiplication:
+    /* imul eax, eax, imm32 | imul eax, [r10 + disp32] */
+    literal ? code.emit({0x69, 0xC0}) : code.emit({0x41, 0x0F, 0xAF, 0x82});
+    code.emit32(value);
+    return;
+
+  default:
+    if (literal)
+    {
+      if (value == 0)
+      {
+        code.emitExitJump({0xE9}); /* jmp exit */
+      }
+      else if (value == -1)
+      {
+        code.emit({0xF7, 0xD8}); /* neg eax */
+      }
+      else
+      {
+        code.emit({0x41, 0xB8}); /* mov r8d, imm32 */
+        code.emit32(value);
+        code.emit({0x99, 0x41, 0xF7, 0xF8}); /* cdq; idiv r8d */
+      }
+      return;
+    }
+
+    code.emit({0x45, 0x8B, 0x82}); /* mov r8d, [r10 + disp32] */
+    code.emit32(value);
+    code.emit({0x45, 0x85, 0xC0});       /* test r8d, r8d */
+    code.emitExitJump({0x0F, 0x84});     /* jz exit */
+    code.emit({0x41, 0x83, 0xF8, 0xFF}); /* cmp r8d, -1 */
+    code.emit({0x75, 0x04});             /* jne divide */
+    code.emit({0xF7, 0xD8, 0xEB, 0x04}); /* neg eax; jmp done */
+    code.emit({0x99, 0x41, 0xF7, 0xF8}); /* divide: cdq; idiv r8d */
+    return;
+  }
+}
+
+/*
+ * Emit Instruction
+ *
+ * Emits a single bytecode instruction. Pushing spills the accumulator (eax) to the machine stack unless the
+ * operand stack is empty; binary operations pop their left-hand operand into ecx.
+ *
+ * @param code The function being generated
+ * @param instruction The instruction to translate
+ * @param depth Number of operands on the operand stack; updated
+ */
+static void emitInstruction(MachineCode &code, const Bytecode::Instruction &instruction, size_t &depth)
+{
+  switch (instruction.op)
+  {
+  case Bytecode::OpCode::PushLiteral:
+  case Bytecode::OpCode::PushVariable:
+    if (depth++ > 0)
+    {
+      code.emit({0x50}); /* push rax */
+    }
+
+    if (instruction.op == Bytecode::OpCode::PushLiteral)
+    {
+      code.emit({0xB8}); /* mov eax, imm32 */
+      code.emit32(instruction.operand);
+    }
+    else
+    {
+      code.emit({0x41, 0x8B, 0x82}); /* mov eax, [r10 + disp32] */
+      code.emit32(instruction.operand * static_cast<int32_t>(sizeof(int32_t)));
+    }
+    return;
+
+  case Bytecode::OpCode::Negate: code.emit({0xF7, 0xD8}); return; /* neg eax */
+
+  default: break;
+  }
+
+  depth--;
+  code.emit({0x59}); /* pop rcx */
+
+  switch (instruction.op)
+  {
+  case Bytecode::OpCode::Addition: code.emit({0x01, 0xC8}); return; /* add eax, ecx */
+
+  case Bytecode::OpCode::Subtraction: code.emit({0x29, 0xC1, 0x89, 0xC8}); return; /* sub ecx, eax; mov eax, ecx */
+
+  case Bytecode::OpCode::Multiplication: code.emit({0x0F, 0xAF, 0xC1}); return; /* imul eax, ecx */
+
+  default:
+    code.emit({0x85, 0xC0});             /* test eax, eax */
+    code.emitExitJump({0x0F, 0x84});     /* jz exit */
+    code.emit({0x83, 0xF8, 0xFF});       /* cmp eax, -1 */
+    code.emit({0x75, 0x06});             /* jne divide */
+    code.emit({0xF7, 0xD9, 0x89, 0xC8}); /* neg ecx; mov eax, ecx */
+    code.emit({0xEB, 0x09});             /* jmp done */
+    code.emit({0x41, 0x89, 0xC0});       /* divide: mov r8d, eax */
+    code.emit({0x89, 0xC8, 0x99});       /* mov eax, ecx; cdq */
+    code.emit({0x41, 0xF7, 0xF8});       /* idiv r8d */
+    return;
+  }
+}
+
+/*
+ * Generate
+ *
+ * Translates a program into the body of a NativeCode::Function
+ *
+ * @param bytecode The program to translate
+ * @return The function's machine code
+ */
+static std::vector<uint8_t> generate(const Bytecode &bytecode)
+{
+  MachineCode code;
+
+  /* Move the arguments into registers which are volatile in both calling conventions: the binding table into r10
+     and the result pointer into r11. The stack pointer is kept in r9 so an early exit can discard spilled operands. */
+#ifdef _WIN32
+  code.emit({0x49, 0x89, 0xCA, 0x49, 0x89, 0xD3}); /* mov r10, rcx; mov r11, rdx */
+#else
+  code.emit({0x49, 0x89, 0xFA, 0x49, 0x89, 0xF3}); /* mov r10, rdi; mov r11, rsi */
+#endif
+  code.emit({0x49, 0x89, 0xE1}); /* mov r9, rsp */
+
+  const std::vector<Bytecode::Instruction> &instructions = bytecode.getInstructions();
+  size_t depth = 0;
+  for (size_t instruction_idx = 0; instruction_idx < instructions.size(); instruction_idx++)
+  {
+    const Bytecode::Instruction &instruction = instructions[instruction_idx];
+    const bool pushes =
+        instruction.op == Bytecode::OpCode::PushLiteral || instruction.op == Bytecode::OpCode::PushVariable;
+    const bool binary_follows = instruction_idx + 1 < instructions.size() &&
+                                instructions[instruction_idx + 1].op != Bytecode::OpCode::PushLiteral &&
+                                instructions[instruction_idx + 1].op != Bytecode::OpCode::PushVariable &&
+                                instructions[instruction_idx + 1].op != Bytecode::OpCode::Negate;
+
+    if (pushes && binary_follows && depth > 0)
+    {
+      /* The operand is consumed straight away, so it never needs to be spilled */
+      emitFused(code, instructions[instruction_idx + 1].op, instruction);
+      instruction_idx++;
+      continue;
+    }
+
+    emitInstruction(code, instruction, depth);
+  }
+
+  code.emit({0x41, 0x89, 0x03});                   /* mov [r11], eax */
+  code.emit({0xB8, 0x01, 0x00, 0x00, 0x00, 0xC3}); /* mov eax, 1; ret */
+
+  /* The division by zero exit */
+  const size_t exit = code.bytes.size();
+  code.emit({0x4C, 0x89, 0xCC, 0x31, 0xC0, 0xC3}); /* mov rsp, r9; xor eax, eax; ret */
+
+  for (size_t jump : code.exit_jumps)
+  {
+    const int32_t displacement = static_cast<int32_t>(exit - (jump + sizeof(int32_t)));
+    std::memcpy(code.bytes.data() + jump, &displacement, sizeof(displacement));
+  }
+
+  return std::move(code.bytes);
+}
+
+#endif
+
+/*
+ * Compile
+ *
+ * @param bytecode The program to translate
+ * @return The program as native code, or null if it cannot be generated on this platform, needs more than
+ *         NATIVE_CODE_MAX_STACK_DEPTH operands, or executable memory could not be obtained
+ */
+std::unique_ptr<NativeCode> NativeCode::Compile(const Bytecode &bytecode)
+{
+#ifdef NATIVE_CODE_SUPPORTED
+  if (bytecode.getInstructions().empty() || bytecode.getMaxStackDepth() > NATIVE_CODE_MAX_STACK_DEPTH)
+  {
+    return nullptr;
+  }
+
+  const std::vector<uint8_t> machine_code = generate(bytecode);
+
+  /* Write the code while the pages are writable, then make them executable but read-only */
+#ifdef _WIN32
+  void *memory = VirtualAlloc(nullptr, machine_code.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if (memory == nullptr)
+  {
+    return nullptr;
+  }
+
+  std::memcpy(memory, machine_code.data(), machine_code.size());
+  DWORD previous_protection;
+  if (!VirtualProtect(memory, machine_code.size(), PAGE_EXECUTE_READ, &previous_protection))
+  {
+    VirtualFree(memory, 0, MEM_RELEASE);
+    return nullptr;
+  }
+  FlushInstructionCache(GetCurrentProcess(), memory, machine_code.size());
+#else
+  void *memory = mmap(nullptr, machine_code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+  {
+    return nullptr;
+  }
+
+  std::memcpy(memory, machine_code.data(), machine_code.size());
+  if (mprotect(memory, machine_code.size(), PROT_READ | PROT_EXEC) != 0)
+  {
+    munmap(memory, machine_code.size());
+    return nullptr;
+  }
+#endif
+
+  return std::unique_ptr<NativeCode>(new NativeCode(memory, machine_code.size()));
+#else
+  (void)bytecode;
+  return nullptr;
+#endif
+}
+
+/*
+ * Is Supported
+ *
+ * @return True if Compile can generate code for this platform
+ */
+bool NativeCode::isSupported()
+{
+#ifdef NATIVE_CODE_SUPPORTED
+  return true;
+#else
+  return false;
+#endif
+}
+
+/*
+ * Native Code Constructor
+ *
+ * @param memory The executable mapping holding the function
+ * @param size Length of the function in bytes
+ */
+NativeCode::NativeCode(void *memory, size_t size) : memory(memory), size(size) {}
+
+/*
+ * Native Code Destructor
+ *
+ * Releases the executable mapping
+ */
+NativeCode::~NativeCode()
+{
+#ifdef NATIVE_CODE_SUPPORTED
+#ifdef _WIN32
+  VirtualFree(memory, 0, MEM_RELEASE);
+#else
+  munmap(memory, size);
+#endif
+#endif
+}
+
+/*
+ * Get Function
+ *
+ * @return The generated function
+ */
+NativeCode::Function NativeCode::getFunction() const
+{
+  return reinterpret_cast<Function>(memory);
+}
+
+/*
+ * Get Size
+ *
+ * @return Length of the generated function in bytes
+ */
+size_t NativeCode::getSize() const
+{
+  return size;
+}
\ No newline at end of file
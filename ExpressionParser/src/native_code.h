@@ -0,0 +1,51 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "bytecode.h"
+
+#define NATIVE_CODE_MAX_STACK_DEPTH 1024
+
+/*
+ * Native Code
+ *
+ * A bytecode program translated to x86-64 machine code. Each instruction becomes a short fixed sequence: the topmost
+ * operand is kept in a register, as by the interpreter, and the rest of the operand stack lives on the machine
+ * stack. Divisors are tested before dividing, so a zero divisor returns a failure instead of faulting and a divisor
+ * of -1 negates instead of trapping on the most negative dividend.
+ *
+ * The code is written to pages which are then made executable and no longer writable. On other architectures, or
+ * where executable memory cannot be obtained, Compile returns null and callers keep using the interpreter.
+ */
+class NativeCode
+{
+public:
+  /* The generated function: stores the result and returns non-zero, or returns zero on division by zero */
+  using Function = int (*)(const int32_t *bindings, int32_t *result);
+
+  static std::unique_ptr<NativeCode> Compile(const Bytecode &bytecode);
+
+  static bool isSupported();
+
+  NativeCode(const NativeCode &) = delete;
+  NativeCode &operator=(const NativeCode &) = delete;
+
+  ~NativeCode();
+
+  Function getFunction() const;
+
+  size_t getSize() const;
+
+private:
+  NativeCode(void *memory, size_t size);
+
+  /* The executable mapping holding the function, and its length in bytes */
+  void *memory;
+  size_t size;
+};
\ No newline at end of file
@@ -0,0 +1,181 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "optimiser.h"
+#include "arithmetic.h"
+#include "errors.h"
+
+#include <vector>
+
+/*
+ * Optimise
+ *
+ * Children are stored before their parents, so a single forward sweep sees every operand before the node using
+ * it. The sweep decides, for each node, whether it folds to a constant, collapses onto one of its operands, or is
+ * kept. A backward sweep from the root then marks which nodes are still reachable, and a final forward sweep copies
+ * those into the new table. Dropping whole subtrees from a postfix ordering leaves it in postfix order, so the
+ * output can be lowered to bytecode exactly like the input.
+ *
+ * @param ast The node table to simplify; it is not modified
+ * @param arena The arena the simplified table's arrays are allocated from
+ * @param options The simplifications to apply
+ * @param optimised Receives a table computing the same result as the input
+ * @return True on success, false if a constant zero divisor was found and options.report_divide_by_zero is set
+ */
+bool AstOptimiser::Optimise(const FlatAst &ast, Arena &arena, const Options &options, FlatAst &optimised)
+{
+  const FlatAst::NodeIndex node_count = static_cast<FlatAst::NodeIndex>(ast.getNodeCount());
+
+  /* For each node: whether it has a known value, that value, and the node it collapses onto (itself if kept) */
+  std::vector<bool> is_constant(node_count, false);
+  std::vector<int> constant_value(node_count, 0);
+  std::vector<FlatAst::NodeIndex> replacement(node_count);
+
+  auto isConstantValue = [&](FlatAst::NodeIndex node, int value)
+  { return is_constant[node] && constant_value[node] == value; };
+
+  for (FlatAst::NodeIndex node = 0; node < node_count; node++)
+  {
+    replacement[node] = node;
+    const FlatAst::NodeIndex left = ast.getLeft(node);
+    const FlatAst::NodeIndex right = ast.getRight(node);
+
+    switch (ast.getOpCode(node))
+    {
+    case FlatAst::OpCode::Literal:
+      is_constant[node] = true;
+      constant_value[node] = ast.getLiteral(node);
+      break;
+
+    case FlatAst::OpCode::Variable: break;
+
+    case FlatAst::OpCode::Negate:
+    {
+      const FlatAst::NodeIndex operand = replacement[left];
+      if (options.fold_constants && is_constant[operand] &&
+          Arithmetic<int32_t, true>::Negate(constant_value[operand], constant_value[node]))
+      {
+        is_constant[node] = true;
+      }
+
+      /* --x is not cancelled: x may be the most negative value, whose negation overflows when checked */
+      break;
+    }
+
+    default:
+    {
+      const FlatAst::NodeIndex lhs = replacement[left];
+      const FlatAst::NodeIndex rhs = replacement[right];
+      const FlatAst::OpCode op = ast.getOpCode(node);
+
+      if (op == FlatAst::OpCode::Division && isConstantValue(rhs, 0))
+      {
+        /* A constant zero divisor fails on every evaluation, whatever the dividend */
+        if (options.report_divide_by_zero)
+        {
+          return false;
+        }
+
+        /* Keep the division so that evaluation reports it */
+        continue;
+      }
+
+      if (options.fold_constants && is_constant[lhs] && is_constant[rhs])
+      {
+        using Ops = Arithmetic<int32_t, true>;
+        const int a = constant_value[lhs];
+        const int b = constant_value[rhs];
+
+        /* A subtree whose value does not fit is left unfolded, so that it is evaluated at the width and with the
+           overflow checking chosen at evaluation (see CompiledExpression::EvaluateAs) */
+        switch (op)
+        {
+        case FlatAst::OpCode::Addition: is_constant[node] = Ops::Add(a, b, constant_value[node]); break;
+        case FlatAst::OpCode::Subtraction: is_constant[node] = Ops::Subtract(a, b, constant_value[node]); break;
+        case FlatAst::OpCode::Multiplication: is_constant[node] = Ops::Multiply(a, b, constant_value[node]); break;
+        case FlatAst::OpCode::Division: is_constant[node] = Ops::Divide(a, b, constant_value[node]); break;
+        default: throw ExpressionParserErrors::UnknownOperatorException();
+        }
+      }
+      else if (options.simplify_identities)
+      {
+        const bool additive = op == FlatAst::OpCode::Addition || op == FlatAst::OpCode::Subtraction;
+        const bool multiplicative = op == FlatAst::OpCode::Multiplication || op == FlatAst::OpCode::Division;
+
+        if ((additive && isConstantValue(rhs, 0)) || (multiplicative && isConstantValue(rhs, 1)))
+        {
+          /* x + 0, x - 0, x * 1 and x / 1 are x */
+          replacement[node] = lhs;
+        }
+        else if ((op == FlatAst::OpCode::Addition && isConstantValue(lhs, 0)) ||
+                 (op == FlatAst::OpCode::Multiplication && isConstantValue(lhs, 1)))
+        {
+          /* 0 + x and 1 * x are x */
+          replacement[node] = rhs;
+        }
+      }
+      break;
+    }
+    }
+  }
+
+  /* Mark the nodes still reachable from the root. Constants become leaves, collapsed nodes forward to their
+     replacement, and everything else keeps its operands. */
+  std::vector<bool> live(node_count, false);
+  live[replacement[node_count - 1]] = true;
+  FlatAst::NodeIndex live_count = 0;
+  for (FlatAst::NodeIndex node = node_count - 1; node >= 0; node--)
+  {
+    if (!live[node])
+    {
+      continue;
+    }
+
+    live_count++;
+    if (is_constant[node] || ast.getOpCode(node) == FlatAst::OpCode::Variable)
+    {
+      continue;
+    }
+
+    live[replacement[ast.getLeft(node)]] = true;
+    if (ast.getOpCode(node) != FlatAst::OpCode::Negate)
+    {
+      live[replacement[ast.getRight(node)]] = true;
+    }
+  }
+
+  /* Copy the live nodes across in their original order */
+  optimised.Reset(arena, live_count);
+
+  std::vector<FlatAst::NodeIndex> new_index(node_count, -1);
+  for (FlatAst::NodeIndex node = 0; node < node_count; node++)
+  {
+    if (!live[node])
+    {
+      continue;
+    }
+
+    if (is_constant[node])
+    {
+      new_index[node] = optimised.AddLiteral(constant_value[node]);
+      continue;
+    }
+
+    switch (ast.getOpCode(node))
+    {
+    case FlatAst::OpCode::Variable: new_index[node] = optimised.AddVariable(ast.getLeft(node)); break;
+
+    case FlatAst::OpCode::Negate:
+      new_index[node] = optimised.AddUnary(new_index[replacement[ast.getLeft(node)]]);
+      break;
+
+    default:
+      new_index[node] = optimised.AddBinary(ast.getOpCode(node), new_index[replacement[ast.getLeft(node)]],
+                                            new_index[replacement[ast.getRight(node)]]);
+      break;
+    }
+  }
+
+  return true;
+}
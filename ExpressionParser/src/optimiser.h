@@ -0,0 +1,41 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include "arena.h"
+#include "flat_ast.h"
+
+/*
+ * AST Optimiser
+ *
+ * A simplification pass run over a node table between parsing and evaluation. Constant subtrees are folded into
+ * literals and arithmetic identities (x + 0, x - 0, x * 1, x / 1) are removed, so compiled expressions do not repeat
+ * that work on every evaluation. Constants whose value overflows int are not folded, and are left to be computed at
+ * the width evaluation uses. Double negations of a variable operand are kept, since checked evaluation must report
+ * the overflow of negating the most negative value.
+ */
+class AstOptimiser
+{
+public:
+  /*
+   * Optimiser Options
+   *
+   * Selects which simplifications are applied
+   */
+  struct Options
+  {
+    /* Replace subtrees without variables by their value */
+    bool fold_constants = true;
+
+    /* Remove identity operations */
+    bool simplify_identities = true;
+
+    /* Fail when a divisor is found to be the constant zero. Otherwise the division is left in place so the error
+       surfaces when the expression is evaluated. */
+    bool report_divide_by_zero = false;
+  };
+
+  static bool Optimise(const FlatAst &ast, Arena &arena, const Options &options, FlatAst &optimised);
+};
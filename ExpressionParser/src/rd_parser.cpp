@@ -3,41 +3,459 @@
  * Date: 2024-06-02
  */
 #include "rd_parser.h"
+#include "arithmetic.h"
 #include "errors.h"
 
+#include <algorithm>
+
 /*
  * RDParser Constructor
  *
- * Initialises the current token pointer to zero
+ * Uses the default optimiser options
+ */
+RDParser::RDParser() {}
+
+/*
+ * RDParser Constructor
+ *
+ * @param optimiser_options Simplifications applied to expressions returned by Compile
+ */
+RDParser::RDParser(const AstOptimiser::Options &optimiser_options)
+{
+  options.optimiser_options = optimiser_options;
+}
+
+/*
+ * RDParser Constructor
+ *
+ * @param options Simplifications applied to expressions returned by Compile, and how expressions are tokenised
  */
-RDParser::RDParser() : current_token_idx(0) {}
+RDParser::RDParser(const Options &options) : options(options) {}
 
 /*
  * Parse
  *
- * @param expr Reference to the expression to parse
+ * @param expr View of the expression to parse. It is not copied and only needs to remain alive for this call.
  * @return Result of the evaluated expression
  */
-int RDParser::Parse(const std::string &expr)
+int RDParser::Parse(std::string_view expr) const
+{
+  return TryParse(expr).getValue();
+}
+
+/*
+ * Compile
+ *
+ * Lexes and parses an expression once so that it can be evaluated many times. Lexer and parser errors are thrown
+ * here rather than at evaluation. Variables are assigned binding table slots in order of first appearance.
+ *
+ * @param expr View of the expression to compile. It is not copied and only needs to remain alive for this call.
+ * @return An immutable handle to the compiled expression
+ */
+CompiledExpression RDParser::Compile(std::string_view expr) const
+{
+  return TryCompile(expr).getValue();
+}
+
+/*
+ * Compile
+ *
+ * Compiles an expression against a binding table layout chosen by the caller, so that several expressions can be
+ * evaluated against the same row of values. Names missing from the layout are reported at compile time.
+ *
+ * @param expr View of the expression to compile. It is not copied and only needs to remain alive for this call.
+ * @param variables Name of the variable bound to each slot
+ * @return An immutable handle to the compiled expression
+ */
+CompiledExpression RDParser::Compile(std::string_view expr, const std::vector<std::string> &variables) const
+{
+  return TryCompile(expr, variables).getValue();
+}
+
+/*
+ * Try Parse
+ *
+ * @param expr View of the expression to parse. It is not copied and only needs to remain alive for this call, and
+ *             for as long as the views held by an error are used.
+ * @return Result of the evaluated expression, or a description of the failure
+ */
+Result<int> RDParser::TryParse(std::string_view expr) const
+{
+  Context &context = threadContext();
+  const InstrumentedScope scope(context);
+  int result;
+  if (options.evaluate_directly)
+  {
+    if (!context.evaluate(expr, options.tokenise_first, options.invalid_token_limit, result))
+    {
+      return context.error;
+    }
+
+    return result;
+  }
+
+  if (!context.buildAst(expr, false, options.tokenise_first, options.invalid_token_limit))
+  {
+    return context.error;
+  }
+
+  /* Evaluate the AST, using the remainder of the arena for the node values */
+  int *values = context.node_arena.AllocateArray<int>(context.ast.getNodeCount());
+  const bool evaluated = context.ast.TryEvaluate(values, nullptr, result);
+  context.call.EndPhase(Instrumentation::Phase::Evaluate);
+  if (!evaluated)
+  {
+    context.fail(ExpressionParserErrors::ErrorKind::DivideByZero, {}, 0);
+    return context.error;
+  }
+
+  return result;
+}
+
+/*
+ * Try Compile
+ *
+ * Compile, reporting lexer and parser errors through the result instead of throwing
+ *
+ * @param expr View of the expression to compile. It is not copied and only needs to remain alive for this call, and
+ *             for as long as the views held by an error are used.
+ * @return An immutable handle to the compiled expression, or a description of the failure
+ */
+Result<CompiledExpression> RDParser::TryCompile(std::string_view expr) const
+{
+  Context &context = threadContext();
+  const InstrumentedScope scope(context);
+  context.variable_names.clear();
+  context.variable_slots.clear();
+  context.variable_layout_fixed = false;
+
+  if (!context.buildAst(expr, true, options.tokenise_first, options.invalid_token_limit))
+  {
+    return context.error;
+  }
+
+  return buildProgram(context, std::vector<std::string>(context.variable_names.begin(), context.variable_names.end()));
+}
+
+/*
+ * Try Compile
+ *
+ * Compile against a fixed binding table layout, reporting errors through the result instead of throwing
+ *
+ * @param expr View of the expression to compile. It is not copied and only needs to remain alive for this call, and
+ *             for as long as the views held by an error are used.
+ * @param variables Name of the variable bound to each slot
+ * @return An immutable handle to the compiled expression, or a description of the failure
+ */
+Result<CompiledExpression> RDParser::TryCompile(std::string_view expr,
+                                                const std::vector<std::string> &variables) const
+{
+  Context &context = threadContext();
+  const InstrumentedScope scope(context);
+  context.variable_names.assign(variables.begin(), variables.end());
+  context.variable_slots.clear();
+  for (size_t slot = 0; slot < variables.size(); slot++)
+  {
+    context.variable_slots.emplace(variables[slot], static_cast<int32_t>(slot));
+  }
+  context.variable_layout_fixed = true;
+
+  if (!context.buildAst(expr, true, options.tokenise_first, options.invalid_token_limit))
+  {
+    return context.error;
+  }
+
+  return buildProgram(context, variables);
+}
+
+/*
+ * Thread Context
+ *
+ * @return The calling thread's parse context
+ */
+RDParser::Context &RDParser::threadContext()
+{
+  thread_local Context context;
+  return context;
+}
+
+/*
+ * Build Program
+ *
+ * Packages the node table most recently built by a context as a compiled expression
+ *
+ * @param context The context holding the node table
+ * @param variables Name of the variable bound to each slot
+ * @return An immutable handle to the compiled expression, or a description of the failure
+ */
+Result<CompiledExpression> RDParser::buildProgram(Context &context, std::vector<std::string> variables) const
+{
+  /* Copy the simplified node table out of the context's arena, which is reused by the next call, and lower it to
+     bytecode */
+  auto program = std::make_shared<CompiledExpression::Program>();
+  if (!AstOptimiser::Optimise(context.ast, program->storage, options.optimiser_options, program->ast))
+  {
+    context.fail(ExpressionParserErrors::ErrorKind::DivideByZero, {}, 0);
+    return context.error;
+  }
+  program->bytecode = Bytecode::Compile(program->ast);
+  program->variables = std::move(variables);
+  context.call.EndPhase(Instrumentation::Phase::Lower);
+
+  return CompiledExpression(std::move(program));
+}
+
+/*
+ * Parse Context Constructor
+ *
+ * Initialises the current token pointer to zero
+ */
+RDParser::Context::Context()
+    : end_token{}, tokenised_first(false), variable_layout_fixed(false), divide_by_zero(false), current_token_idx(0),
+      node_count(0), depth(0), max_depth(0)
+{
+}
+
+/*
+ * Build AST
+ *
+ * Tokenises the expression and populates the node table using recursive descent
+ *
+ * @param expr View of the expression to parse
+ * @param allow_variables True if identifiers are accepted as variables
+ * @param tokenise_first True if the whole expression is tokenised before parsing begins, otherwise tokens are
+ *                       scanned as the descent reaches them
+ * @param invalid_token_limit Number of invalid characters after which lexing stops (see Options)
+ * @return True if the table was built, otherwise false with the failure described by the error member
+ */
+bool RDParser::Context::buildAst(std::string_view expr, bool allow_variables, bool tokenise_first,
+                                 size_t invalid_token_limit)
+{
+  if (!beginTokens(expr, allow_variables, tokenise_first, invalid_token_limit))
+  {
+    return false;
+  }
+
+  /* Release the previous expression's nodes; the arena's memory is kept for this one. Every node consumes at least
+     one token, which bounds the size of the table once the tokens are known; when they are scanned on demand the
+     table starts small and grows in the arena as nodes are added. */
+  node_arena.Reset();
+  ast.Reset(node_arena, tokenise_first ? lexer.getTokenCount() : FLAT_AST_MIN_CAPACITY);
+
+  /* Build the abstract syntax tree (AST) using recursive descent; the root is the last node added to the table */
+  const bool parsed = parseExpression() != PARSE_FAILED;
+  if constexpr (Instrumentation::enabled)
+  {
+    node_count = ast.getNodeCount();
+  }
+
+  return finishTokens(parsed);
+}
+
+/*
+ * Evaluate
+ *
+ * Tokenises the expression and evaluates it using recursive descent, without building a node table. Operands are
+ * combined in the order the node table would be swept, and a division by zero is only reported once the whole
+ * expression has been parsed, so the result and any error are those of building the table and evaluating it.
+ *
+ * @param expr View of the expression to evaluate
+ * @param tokenise_first True if the whole expression is tokenised before parsing begins, otherwise tokens are
+ *                       scanned as the descent reaches them
+ * @param invalid_token_limit Number of invalid characters after which lexing stops (see Options)
+ * @param result Receives the result of the evaluated expression
+ * @return True if the expression was evaluated, otherwise false with the failure described by the error member
+ */
+bool RDParser::Context::evaluate(std::string_view expr, bool tokenise_first, size_t invalid_token_limit, int &result)
+{
+  if (!beginTokens(expr, false, tokenise_first, invalid_token_limit))
+  {
+    return false;
+  }
+
+  divide_by_zero = false;
+  int value;
+  if (!finishTokens(evaluateBinary(value)))
+  {
+    return false;
+  }
+
+  if (divide_by_zero)
+  {
+    fail(ExpressionParserErrors::ErrorKind::DivideByZero, {}, 0);
+    return false;
+  }
+
+  result = value;
+  return true;
+}
+
+/*
+ * Begin Tokens
+ *
+ * Prepares the tokens of an expression for the descent
+ *
+ * @param expr View of the expression to parse
+ * @param allow_variables True if identifiers are accepted as variables
+ * @param tokenise_first True if the whole expression is tokenised now, otherwise tokens are scanned on demand
+ * @param invalid_token_limit Number of invalid characters after which lexing stops (see Options)
+ * @return True if parsing may begin, otherwise false with the lexical error described by the error member
+ */
+bool RDParser::Context::beginTokens(std::string_view expr, bool allow_variables, bool tokenise_first,
+                                    size_t invalid_token_limit)
 {
   current_token_idx = 0;
+  error = ExpressionParserErrors::ErrorInfo();
+  tokenised_first = tokenise_first;
 
-  lexer.clearTokens();
-  lexer.Tokenise(expr);
+  if (!tokenise_first)
+  {
+    return scanner.TryBegin(expr, allow_variables, error, invalid_token_limit);
+  }
 
-  /* Build the abstract syntax tree (AST) using recursive descent */
-  std::unique_ptr<Expression> expression = parseExpression();
+  lexer.clearTokens();
+  end_token = Lexer::Token{.operation = Lexer::TokenOperation::None, .value = TOKEN_VALUE_NOT_APPLICABLE, .raw = {},
+                           .position = expr.size()};
+  const bool tokenised = lexer.TryTokenise(expr, allow_variables, error, invalid_token_limit);
+  call.EndPhase(Instrumentation::Phase::Lex);
+  return tokenised;
+}
 
-  if (current_token_idx < lexer.getTokenCount())
+/*
+ * Finish Tokens
+ *
+ * Checks that the descent consumed the whole expression
+ *
+ * @param parsed True if the descent succeeded
+ * @return True if the expression was parsed, otherwise false with the failure described by the error member
+ */
+bool RDParser::Context::finishTokens(bool parsed)
+{
+  if (parsed && currentToken().operation != Lexer::TokenOperation::None)
   {
     /* If we have escaped recursion and still have tokens left, it could only
        be that the parentheses are formatted incorrectly; incorrect parentheses
        will not make it past the parseBinary state. */
-    throw ExpressionParserErrors::UnexpectedParenthesesException();
+    const Lexer::Token &stray_token = currentToken();
+    fail(ExpressionParserErrors::ErrorKind::UnexpectedParentheses, stray_token.raw, stray_token.position);
+    parsed = false;
   }
 
-  /* Evaluate the AST */
-  return expression->Evaluate();
+  /* Lexical errors anywhere in the expression take precedence over the parser's, as they would had the Lexer seen
+     the whole expression first */
+  const bool scanned = tokenised_first || scanner.TryFinish(error);
+  call.EndPhase(Instrumentation::Phase::Parse);
+  return scanned && parsed;
+}
+
+/*
+ * Descend
+ *
+ * Counts the descent entering a parenthesis or, when building a node table, a negation
+ */
+void RDParser::Context::descend()
+{
+  if constexpr (Instrumentation::enabled)
+  {
+    max_depth = std::max(max_depth, ++depth);
+  }
+}
+
+/*
+ * Ascend
+ *
+ * Counts the descent returning from a parenthesis or negation
+ */
+void RDParser::Context::ascend()
+{
+  if constexpr (Instrumentation::enabled)
+  {
+    depth--;
+  }
+}
+
+/*
+ * Finish Call
+ *
+ * Adds the call just made to the calling thread's instrumentation counters
+ */
+void RDParser::Context::finishCall()
+{
+  if constexpr (Instrumentation::enabled)
+  {
+    const size_t token_count = tokenised_first ? lexer.getTokenCount() : scanner.getTokenCount();
+    call.Finish(token_count, node_count, max_depth, error.kind);
+  }
+}
+
+/*
+ * Instrumented Scope Constructor
+ *
+ * @param context The calling thread's context, whose call is measured
+ */
+RDParser::InstrumentedScope::InstrumentedScope(Context &context) : context(context)
+{
+  if constexpr (Instrumentation::enabled)
+  {
+    context.node_count = 0;
+    context.depth = 0;
+    context.max_depth = 0;
+    context.call.Begin();
+  }
+}
+
+/*
+ * Instrumented Scope Destructor
+ *
+ * Records the call once its result has been produced
+ */
+RDParser::InstrumentedScope::~InstrumentedScope()
+{
+  context.finishCall();
+}
+
+/*
+ * Fail
+ *
+ * Records a parse failure so it can be returned once the descent has unwound
+ *
+ * @param kind What went wrong
+ * @param token The offending token's characters
+ * @param position Zero-based offset of the offending token within the expression
+ * @return PARSE_FAILED, for the caller to return
+ */
+FlatAst::NodeIndex RDParser::Context::fail(ExpressionParserErrors::ErrorKind kind, std::string_view token,
+                                           size_t position)
+{
+  error.kind = kind;
+  error.token = token;
+  error.position = position;
+  return PARSE_FAILED;
+}
+
+/*
+ * Current Token
+ *
+ * @return The token the RD algorithm is processing; operation None once the expression has been consumed
+ */
+const Lexer::Token &RDParser::Context::currentToken()
+{
+  if (!tokenised_first)
+  {
+    return scanner.getCurrent();
+  }
+
+  return static_cast<size_t>(current_token_idx) < lexer.getTokenCount() ? lexer.getToken(current_token_idx) : end_token;
+}
+
+/*
+ * Previous Token
+ *
+ * @return The token most recently matched by tokenMatchAndAdvance
+ */
+const Lexer::Token &RDParser::Context::previousToken()
+{
+  return tokenised_first ? lexer.getToken(current_token_idx - 1) : scanner.getPrevious();
 }
 
 /*
@@ -49,15 +467,22 @@ int RDParser::Parse(const std::string &expr)
  * @param operation Reference to token operation to match with
  * @return True if a match is found, otherwise false
  */
-bool RDParser::tokenMatchAndAdvance(const Lexer::TokenOperation &operation)
+bool RDParser::Context::tokenMatchAndAdvance(const Lexer::TokenOperation &operation)
 {
-  if (current_token_idx < lexer.getTokenCount() && (lexer.getToken(current_token_idx)).operation == operation)
+  if (currentToken().operation != operation)
   {
-    current_token_idx++;
-    return true;
+    return false;
   }
 
-  return false;
+  if (tokenised_first)
+  {
+    current_token_idx++;
+  }
+  else
+  {
+    scanner.Advance();
+  }
+  return true;
 }
 
 /*
@@ -66,9 +491,9 @@ bool RDParser::tokenMatchAndAdvance(const Lexer::TokenOperation &operation)
  * Entry point into the recursive parse
  * Fulfils 'Expression -> Binary' portion of the Context-Free-Grammar (CFG) specification.
  *
- * @return Safe pointer to the next tree node
+ * @return Index of the next tree node, or PARSE_FAILED
  */
-std::unique_ptr<RDParser::Expression> RDParser::parseExpression()
+FlatAst::NodeIndex RDParser::Context::parseExpression()
 { 
   return parseBinary(); 
 }
@@ -79,19 +504,29 @@ std::unique_ptr<RDParser::Expression> RDParser::parseExpression()
  * Builds a binary node representing addition, subtraction, multiplication and division
  * 'Binary -> Unary | (("*" | "/" | "+" | "-") Unary)*' portion of the CFG
  *
- * @return Safe pointer to the next tree node
+ * @return Index of the next tree node, or PARSE_FAILED
  */
-std::unique_ptr<RDParser::Expression> RDParser::parseBinary()
+FlatAst::NodeIndex RDParser::Context::parseBinary()
 {
-  std::unique_ptr<Expression> left = parseUnary();
+  FlatAst::NodeIndex left = parseUnary();
+  if (left == PARSE_FAILED)
+  {
+    return PARSE_FAILED;
+  }
 
   while (tokenMatchAndAdvance(Lexer::TokenOperation::Addition) ||
          tokenMatchAndAdvance(Lexer::TokenOperation::Subtraction) ||
          tokenMatchAndAdvance(Lexer::TokenOperation::Multiplication) ||
          tokenMatchAndAdvance(Lexer::TokenOperation::Division))
   {
-    const Lexer::Token &previous_token = lexer.getToken(current_token_idx - 1);
-    left = std::make_unique<Binary>(previous_token.operation, std::move(left), parseUnary());
+    const FlatAst::OpCode op = binaryOpCode(previousToken().operation);
+    const FlatAst::NodeIndex right = parseUnary();
+    if (right == PARSE_FAILED)
+    {
+      return PARSE_FAILED;
+    }
+
+    left = ast.AddBinary(op, left, right);
   }
 
   return left;
@@ -103,13 +538,16 @@ std::unique_ptr<RDParser::Expression> RDParser::parseBinary()
  * Builds a unary node representing negation
  * 'Unary -> ("-") Unary | Primary' portion of the CFG
  *
- * @return Safe pointer to the next tree node
+ * @return Index of the next tree node, or PARSE_FAILED
  */
-std::unique_ptr<RDParser::Expression> RDParser::parseUnary()
+FlatAst::NodeIndex RDParser::Context::parseUnary()
 {
   if (tokenMatchAndAdvance(Lexer::TokenOperation::Subtraction))
   {
-    return std::make_unique<Unary>(parseUnary());
+    descend();
+    const FlatAst::NodeIndex operand = parseUnary();
+    ascend();
+    return operand == PARSE_FAILED ? PARSE_FAILED : ast.AddUnary(operand);
   }
 
   return parsePrimary();
@@ -118,132 +556,243 @@ std::unique_ptr<RDParser::Expression> RDParser::parseUnary()
 /*
  * Parse Primary
  *
- * Build the literal nodes or enters the nesting of parentheses
- * 'Primary -> Literal | "(" Expression ")"' portion of the CFG
+ * Build the literal and variable nodes or enters the nesting of parentheses
+ * 'Primary -> Literal | Identifier | "(" Expression ")"' portion of the CFG
  *
- * @return Safe pointer to the next tree node
+ * @return Index of the next tree node, or PARSE_FAILED
  */
-std::unique_ptr<RDParser::Expression> RDParser::parsePrimary()
+FlatAst::NodeIndex RDParser::Context::parsePrimary()
 {
   if (tokenMatchAndAdvance(Lexer::TokenOperation::Literal))
   {
-    int value = lexer.getToken(current_token_idx - 1).value;
-    return std::make_unique<Literal>(value);
+    int value = previousToken().value;
+    return ast.AddLiteral(value);
+  }
+
+  if (tokenMatchAndAdvance(Lexer::TokenOperation::Identifier))
+  {
+    const Lexer::Token &identifier = previousToken();
+    const int32_t slot = resolveVariable(identifier.raw);
+    if (slot == PARSE_FAILED)
+    {
+      return fail(ExpressionParserErrors::ErrorKind::UnknownVariable, identifier.raw, identifier.position);
+    }
+
+    return ast.AddVariable(slot);
   }
 
   if (tokenMatchAndAdvance(Lexer::TokenOperation::L_Brace))
   {
-    std::unique_ptr<Expression> expression = parseExpression();
+    descend();
+    FlatAst::NodeIndex expression = parseExpression();
+    ascend();
+    if (expression == PARSE_FAILED)
+    {
+      return PARSE_FAILED;
+    }
 
     if (!tokenMatchAndAdvance(Lexer::TokenOperation::R_Brace))
     {
       /* If the next token is not a closing brace, this expression is invalid */
-      throw ExpressionParserErrors::ParenthesesMismatchException();
+      return failMissingBrace();
     }
 
     return expression;
-    ;
   }
 
   /* This branch is only reached in the event of an error; the token has not been expected and the order it appears in
    * is incorrect */
-
-  /* We want to inform the user of which token was unexpected. The token pointer will have been incremented regardless
-   * by this point (see parseBinary), If this is the last token in the expression, an overflow would occur. We
-   * clamp this to avoid that scenario.
-   */
-  int bad_token_idx = current_token_idx;
-  int token_max_index = lexer.getTokenCount() - 1;
-  if (bad_token_idx > token_max_index)
-  {
-    bad_token_idx = token_max_index;
-  }
-
-  const Lexer::Token &bad_token = lexer.getToken(bad_token_idx);
-  throw ExpressionParserErrors::UnexpectedTokenException(bad_token.raw);
+  return failUnexpectedToken();
 }
 
 /*
- * Binary Node Constructor
+ * Evaluate Binary
  *
- * Initialises the binary node with its operation, left, and right hand side expression.
+ * parseBinary, combining the values of the operands instead of building nodes
  *
- * @param op Operation of this term/factor
- * @param left Pointer to expression on the left hand side
- * @param right Pointer to expression on the right hand side
- **/
-RDParser::Binary::Binary(Lexer::TokenOperation op, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right)
-    : operation(op), left(std::move(left)), right(std::move(right))
+ * @param value Receives the value of the production
+ * @return True if the production was parsed
+ */
+bool RDParser::Context::evaluateBinary(int &value)
 {
+  using Ops = Arithmetic<int32_t, false>;
+  if (!evaluateUnary(value))
+  {
+    return false;
+  }
+
+  while (tokenMatchAndAdvance(Lexer::TokenOperation::Addition) ||
+         tokenMatchAndAdvance(Lexer::TokenOperation::Subtraction) ||
+         tokenMatchAndAdvance(Lexer::TokenOperation::Multiplication) ||
+         tokenMatchAndAdvance(Lexer::TokenOperation::Division))
+  {
+    const Lexer::TokenOperation operation = previousToken().operation;
+    int right;
+    if (!evaluateUnary(right))
+    {
+      return false;
+    }
+
+    if constexpr (Instrumentation::enabled)
+    {
+      node_count++;
+    }
+
+    switch (operation)
+    {
+    case Lexer::TokenOperation::Addition: Ops::Add(value, right, value); break;
+    case Lexer::TokenOperation::Subtraction: Ops::Subtract(value, right, value); break;
+    case Lexer::TokenOperation::Multiplication: Ops::Multiply(value, right, value); break;
+    default:
+      /* An evaluation of the node table would have stopped at the first zero divisor, so no later division is
+         performed either */
+      divide_by_zero = divide_by_zero || right == 0;
+      if (divide_by_zero)
+      {
+        value = 0;
+      }
+      else
+      {
+        Ops::Divide(value, right, value);
+      }
+      break;
+    }
+  }
+
+  return true;
 }
 
 /*
- * Binary Evaluate
+ * Evaluate Unary
  *
- * Performs an arithmetic evaluation on the binary node dependent upon its operation
+ * parseUnary and parsePrimary, producing the value of an operand instead of building nodes. Leading negations are
+ * counted rather than recursed into.
  *
- * @return Result of evaluation = left op right
+ * @param value Receives the value of the production
+ * @return True if the production was parsed
  */
-int RDParser::Binary::Evaluate() const
+bool RDParser::Context::evaluateUnary(int &value)
 {
-  switch (operation)
+  bool negate = false;
+  while (tokenMatchAndAdvance(Lexer::TokenOperation::Subtraction))
   {
-  case Lexer::TokenOperation::Addition: return left->Evaluate() + right->Evaluate();
-
-  case Lexer::TokenOperation::Subtraction: return left->Evaluate() - right->Evaluate();
-
-  case Lexer::TokenOperation::Multiplication: return left->Evaluate() * right->Evaluate();
+    negate = !negate;
+    if constexpr (Instrumentation::enabled)
+    {
+      node_count++;
+    }
+  }
 
-  case Lexer::TokenOperation::Division:
+  if (tokenMatchAndAdvance(Lexer::TokenOperation::Literal))
+  {
+    value = previousToken().value;
+    if constexpr (Instrumentation::enabled)
+    {
+      node_count++;
+    }
+  }
+  else if (tokenMatchAndAdvance(Lexer::TokenOperation::L_Brace))
   {
-    int right_value = right->Evaluate();
-    if (right_value == 0)
+    descend();
+    const bool evaluated = evaluateBinary(value);
+    ascend();
+    if (!evaluated)
     {
-      /* Undefined result encountered */
-      throw ExpressionParserErrors::DivideByZeroException();
+      return false;
     }
 
-    return left->Evaluate() / right_value;
+    if (!tokenMatchAndAdvance(Lexer::TokenOperation::R_Brace))
+    {
+      failMissingBrace();
+      return false;
+    }
+  }
+  else
+  {
+    failUnexpectedToken();
+    return false;
   }
 
-  default: throw ExpressionParserErrors::UnknownOperatorException();
+  if (negate)
+  {
+    Arithmetic<int32_t, false>::Negate(value, value);
   }
+
+  return true;
 }
 
 /*
- * Unary Node Constructor
+ * Fail Missing Brace
  *
- * Initialises the unary node with a right hand side expression
+ * Records that a closing brace was expected at the current token
  *
- * @param right Pointer to expression on the right hand side
- **/
-RDParser::Unary::Unary(std::unique_ptr<Expression> right) : right(std::move(right)) {}
+ * @return PARSE_FAILED, for the caller to return
+ */
+FlatAst::NodeIndex RDParser::Context::failMissingBrace()
+{
+  return fail(ExpressionParserErrors::ErrorKind::ParenthesesMismatch, {}, currentToken().position);
+}
 
 /*
- * Unary Evaluate
+ * Fail Unexpected Token
  *
- * @return The negated value of its right hand side expression.
+ * Records that the current token cannot begin an operand
+ *
+ * @return PARSE_FAILED, for the caller to return
  */
-int RDParser::Unary::Evaluate() const 
-{ 
-  return -right->Evaluate(); 
+FlatAst::NodeIndex RDParser::Context::failUnexpectedToken()
+{
+  /* We want to inform the user of which token was unexpected. If the expression ended where an operand was expected,
+   * the last token is reported instead. */
+  const Lexer::Token &bad_token =
+      currentToken().operation == Lexer::TokenOperation::None ? previousToken() : currentToken();
+  return fail(ExpressionParserErrors::ErrorKind::UnexpectedToken, bad_token.raw, bad_token.position);
 }
 
 /*
- * Literal Node Constructor
+ * Resolve Variable
  *
- * Initialises the literal node with an integer value
+ * Maps a variable name onto its binding table slot, assigning the next free slot to names seen for the first time
+ * unless the caller fixed the layout.
  *
- * @param value Integer value to assign to this node
- **/
-RDParser::Literal::Literal(int value) : value(value) {}
+ * @param name Name of the variable as written in the expression
+ * @return Slot the variable's value is read from, or PARSE_FAILED if the name is not part of a fixed layout
+ */
+int32_t RDParser::Context::resolveVariable(std::string_view name)
+{
+  auto existing = variable_slots.find(name);
+  if (existing != variable_slots.end())
+  {
+    return existing->second;
+  }
+
+  if (variable_layout_fixed)
+  {
+    return PARSE_FAILED;
+  }
+
+  const int32_t slot = static_cast<int32_t>(variable_names.size());
+  variable_names.push_back(name);
+  variable_slots.emplace(name, slot);
+  return slot;
+}
 
 /*
- * Unary Evaluate
+ * Binary OpCode
+ *
+ * Maps a binary operator token onto the opcode of the node it produces
  *
- * @return The integer value of the literal
+ * @param operation Reference to the operator token's operation
+ * @return The node opcode performing the operation
  */
-int RDParser::Literal::Evaluate() const 
-{ 
-  return value; 
+FlatAst::OpCode RDParser::binaryOpCode(const Lexer::TokenOperation &operation)
+{
+  switch (operation)
+  {
+  case Lexer::TokenOperation::Addition: return FlatAst::OpCode::Addition;
+  case Lexer::TokenOperation::Subtraction: return FlatAst::OpCode::Subtraction;
+  case Lexer::TokenOperation::Multiplication: return FlatAst::OpCode::Multiplication;
+  case Lexer::TokenOperation::Division: return FlatAst::OpCode::Division;
+  default: throw ExpressionParserErrors::UnknownOperatorException();
+  }
 }
\ No newline at end of file
@@ -4,95 +4,178 @@
  */
 #pragma once
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+#include "compiled_expression.h"
+#include "flat_ast.h"
+#include "instrumentation.h"
 #include "lexer.h"
+#include "optimiser.h"
+#include "result.h"
+#include "token_scanner.h"
+
+#define PARSE_FAILED -1
 
 /*
  * RDParser
  *
  * Performs recursive descent on expression tokens to build an abstract syntax tree.
- * Abstract syntax tree provides evaluation methods to obtain the result.
+ * The tree is stored as a flat table of nodes (see FlatAst) which provides evaluation methods to obtain the result.
+ * The table's arrays are allocated from a per-thread arena, which is reset (not freed) on every call.
+ * Compile performs the same lexing and parsing but returns the tree for repeated evaluation instead. Compiled
+ * expressions may also contain variables, which are resolved to binding table slots as they are parsed, and are
+ * simplified (see AstOptimiser) before being lowered to bytecode.
+ * Parse evaluates an expression only once, so by default it combines the values of the operands as the descent
+ * returns and builds no table at all (see Options::evaluate_directly).
+ * Tokens are scanned one at a time as the descent asks for them (see TokenScanner), so no token vector is built. The
+ * Lexer can instead tokenise the whole expression first (see Options::tokenise_first); the errors are the same.
+ * The Try variants report errors through their Result instead of throwing. Failures propagate out of the descent as
+ * return values, so a malformed expression costs no more than a well-formed one; Parse and Compile throw the
+ * matching exception from errors.h.
+ *
+ * A parser holds only its configuration. The lexer, node table and other scratch state of a call live in a context
+ * owned by the calling thread, so a single parser may be used from any number of threads without locking.
+ *
+ * The descent recurses once per parenthesis and leading negation; untrusted or machine-generated input may be nested
+ * deeply enough to exhaust the stack, and should be parsed with IterativeParser instead.
  *
  * Grammar:
  * Expression -> Binary
  * Binary -> Unary | (("*" | "/" | "+" | "-") Unary)*
  * Unary -> ("-") Unary | Primary
- * Primary -> Literal | "(" Expression ")";
+ * Primary -> Literal | Identifier | "(" Expression ")";
  */
 class RDParser
 {
 public:
-  RDParser();
-  int Parse(const std::string &expr);
-
-private:
   /*
-   * Expression Interface
+   * RDParser Options
    *
-   * Enables a polymorphic representation of the AST for the expression grammar.
+   * Configuration of a parser
    */
-  class Expression
+  struct Options
   {
-  public:
-    int virtual Evaluate() const = 0;
-    virtual ~Expression() = default;
-  };
+    /* Simplifications applied to compiled expressions */
+    AstOptimiser::Options optimiser_options;
 
-  /*
-   * Binary Node
-   *
-   * Represents a term or factor within the AST
-   */
-  class Binary : public Expression
-  {
-  public:
-    Binary(Lexer::TokenOperation op, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right);
-    int Evaluate() const override;
-
-  private:
-    Lexer::TokenOperation operation;
-    std::unique_ptr<Expression> left;
-    std::unique_ptr<Expression> right;
+    /* Tokenise the whole expression with the Lexer before parsing, rather than scanning tokens on demand. Slower, but
+       keeps the two phases apart when diagnosing the lexer. */
+    bool tokenise_first = false;
+
+    /* Parse evaluates the expression as it is parsed instead of building a node table and evaluating that. The
+       result and errors are the same; the node table is only needed to inspect the tree. */
+    bool evaluate_directly = true;
+
+    /* Number of invalid characters after which lexing stops and the expression is rejected, to bound the cost of
+       rejecting large inputs of garbage; the error then lists only those characters. LEXER_NO_INVALID_TOKEN_LIMIT
+       lists every one. */
+    size_t invalid_token_limit = LEXER_NO_INVALID_TOKEN_LIMIT;
   };
 
+  RDParser();
+  explicit RDParser(const AstOptimiser::Options &optimiser_options);
+  explicit RDParser(const Options &options);
+  int Parse(std::string_view expr) const;
+  CompiledExpression Compile(std::string_view expr) const;
+  CompiledExpression Compile(std::string_view expr, const std::vector<std::string> &variables) const;
+  Result<int> TryParse(std::string_view expr) const;
+  Result<CompiledExpression> TryCompile(std::string_view expr) const;
+  Result<CompiledExpression> TryCompile(std::string_view expr, const std::vector<std::string> &variables) const;
+
+private:
   /*
-   * Unary Node
+   * Parse Context
    *
-   * Represents a unary in the AST (currently just negation)
+   * The scratch state of one call. Each thread owns a single context which is reused across calls (and parsers) so
+   * that its memory is only allocated once.
    */
-  class Unary : public Expression
+  struct Context
   {
-  public:
-    Unary(std::unique_ptr<Expression> right);
-    int Evaluate() const override;
+    Context();
+
+    bool buildAst(std::string_view expr, bool allow_variables, bool tokenise_first, size_t invalid_token_limit);
+    bool evaluate(std::string_view expr, bool tokenise_first, size_t invalid_token_limit, int &result);
+    bool beginTokens(std::string_view expr, bool allow_variables, bool tokenise_first, size_t invalid_token_limit);
+    bool finishTokens(bool parsed);
+    FlatAst::NodeIndex fail(ExpressionParserErrors::ErrorKind kind, std::string_view token, size_t position);
+    FlatAst::NodeIndex failMissingBrace();
+    FlatAst::NodeIndex failUnexpectedToken();
+    int32_t resolveVariable(std::string_view name);
+    const Lexer::Token &currentToken();
+    const Lexer::Token &previousToken();
+    bool tokenMatchAndAdvance(const Lexer::TokenOperation &operation);
+    FlatAst::NodeIndex parseExpression();
+    FlatAst::NodeIndex parseBinary();
+    FlatAst::NodeIndex parseUnary();
+    FlatAst::NodeIndex parsePrimary();
+    bool evaluateBinary(int &value);
+    bool evaluateUnary(int &value);
+    void descend();
+    void ascend();
+    void finishCall();
+
+    /* Source of tokens scanned on demand */
+    TokenScanner scanner;
+
+    /* Instance of the lexical analyser class responsible for generating tokens when tokenising first, and the token
+       standing for the end of its expression */
+    Lexer lexer;
+    Lexer::Token end_token;
+    bool tokenised_first;
+
+    /* Storage for the AST of the expression currently being parsed */
+    Arena node_arena;
 
-  private:
-    std::unique_ptr<Expression> right;
+    /* Node table the recursive descent populates */
+    FlatAst ast;
+
+    /* Description of the failure of the most recent call */
+    ExpressionParserErrors::ErrorInfo error;
+
+    /* Names of the variables of the expression being compiled, in slot order, and the reverse mapping */
+    std::vector<std::string_view> variable_names;
+    std::unordered_map<std::string_view, int32_t> variable_slots;
+
+    /* True if variable slots are fixed by the caller and unknown names are an error */
+    bool variable_layout_fixed;
+
+    /* True once an expression being evaluated directly has divided by zero */
+    bool divide_by_zero;
+
+    /* Pointer to the current token the RD algorithm is processing, when tokenising first */
+    int current_token_idx;
+
+    /* Measurements of the current call, and the nodes and nesting it has reached; only kept when instrumentation is
+       enabled */
+    Instrumentation::Call call;
+    size_t node_count;
+    size_t depth;
+    size_t max_depth;
   };
 
   /*
-   * Literal Node
+   * Instrumented Scope
    *
-   * Represents an Integer in the AST
+   * Measures a call to one of the public methods, from construction to destruction (see Instrumentation). Its members
+   * are empty unless instrumentation is enabled.
    */
-  class Literal : public Expression
+  struct InstrumentedScope
   {
-  public:
-    Literal(int value);
-    int Evaluate() const override;
+    explicit InstrumentedScope(Context &context);
+    ~InstrumentedScope();
 
-  private:
-    int value;
+    Context &context;
   };
 
-  bool tokenMatchAndAdvance(const Lexer::TokenOperation &operation);
-  std::unique_ptr<Expression> parseExpression();
-  std::unique_ptr<Expression> parseBinary();
-  std::unique_ptr<Expression> parseUnary();
-  std::unique_ptr<Expression> parsePrimary();
+  static Context &threadContext();
+
+  Result<CompiledExpression> buildProgram(Context &context, std::vector<std::string> variables) const;
 
-  /* Instance of the lexical analyser class responsible for generating tokens */
-  Lexer lexer;
+  static FlatAst::OpCode binaryOpCode(const Lexer::TokenOperation &operation);
 
-  /* Pointer to the current token the RD algorithm is processing */
-  int current_token_idx;
+  /* Simplifications applied to compiled expressions and how the expression is tokenised */
+  Options options;
 };
\ No newline at end of file
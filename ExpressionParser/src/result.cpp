@@ -0,0 +1,106 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "result.h"
+#include "errors.h"
+#include "lexer.h"
+
+#include <vector>
+
+namespace ExpressionParserErrors
+{
+  /*
+   * With Exception
+   *
+   * Constructs the exception the throwing API reports for an error and hands it to a handler, so the message and
+   * the thrown type come from the same place
+   *
+   * @param error The error to describe
+   * @param handler Called with the exception object
+   * @return The handler's result
+   */
+  template <typename Handler> static auto withException(const ErrorInfo &error, Handler handler)
+  {
+    switch (error.kind)
+    {
+    case ErrorKind::InvalidToken:
+    {
+      /* Only the first invalid character was recorded; find the rest again now that they are wanted */
+      std::string characters;
+      std::vector<size_t> positions;
+      characters.reserve(error.count);
+      positions.reserve(error.count);
+      for (size_t offset = error.position; offset < error.expression.size() && positions.size() < error.count;
+           offset++)
+      {
+        if (Lexer::isInvalidCharacter(error.expression[offset], error.identifiers_allowed))
+        {
+          characters.push_back(error.expression[offset]);
+          positions.push_back(offset);
+        }
+      }
+      if (positions.empty())
+      {
+        /* The expression was not retained (see StreamingLexer); report the first character only */
+        characters.assign(error.token);
+        positions.push_back(error.position);
+      }
+      return handler(InvalidTokenException(std::move(characters), std::move(positions), error.truncated));
+    }
+
+    case ErrorKind::EmptyExpression: return handler(EmptyExpressionException());
+
+    case ErrorKind::LiteralOutOfRange: return handler(std::out_of_range("Lexer:: Literal is out of range"));
+
+    case ErrorKind::ParenthesesMismatch: return handler(ParenthesesMismatchException());
+
+    case ErrorKind::UnexpectedParentheses: return handler(UnexpectedParenthesesException());
+
+    case ErrorKind::UnexpectedToken: return handler(UnexpectedTokenException(error.token, error.position));
+
+    case ErrorKind::NestingTooDeep: return handler(NestingTooDeepException(error.position));
+
+    case ErrorKind::DivideByZero: return handler(DivideByZeroException());
+
+    case ErrorKind::Overflow: return handler(OverflowException());
+
+    case ErrorKind::UnknownVariable: return handler(UnknownVariableException(error.token));
+
+    case ErrorKind::UnboundVariable: return handler(UnboundVariableException(error.token));
+
+    default: return handler(std::logic_error("ErrorInfo:: No error recorded"));
+    }
+  }
+
+  /*
+   * Message
+   *
+   * Builds the message the matching exception carries. This is the only point at which an error string is
+   * allocated, so callers that only test the kind never pay for it.
+   *
+   * @return Human readable description of the error, empty if there is no error
+   */
+  std::string ErrorInfo::Message() const
+  {
+    if (kind == ErrorKind::None)
+    {
+      return {};
+    }
+
+    return withException(*this, [](const std::exception &exception) { return std::string(exception.what()); });
+  }
+
+  /*
+   * Throw
+   *
+   * Raises the exception the throwing API reports for this error
+   */
+  void ErrorInfo::Throw() const
+  {
+    withException(*this, [](const auto &exception) { throw exception; });
+
+    /* Not reached; every branch above throws */
+    throw std::logic_error("ErrorInfo:: No error recorded");
+  }
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace ExpressionParserErrors
+{
+  /*
+   * Error Kind
+   *
+   * Identifies a failure reported without throwing. Each kind corresponds to one of the exceptions in errors.h.
+   */
+  enum class ErrorKind
+  {
+    None,
+    InvalidToken,
+    EmptyExpression,
+    LiteralOutOfRange,
+    ParenthesesMismatch,
+    UnexpectedParentheses,
+    UnexpectedToken,
+    NestingTooDeep,
+    DivideByZero,
+    Overflow,
+    UnknownVariable,
+    UnboundVariable
+  };
+
+  /*
+   * Error Information
+   *
+   * Describes a failure without building a message. The views refer into the caller's expression (or the compiled
+   * expression's variable names) and are only valid while that buffer is alive.
+   */
+  struct ErrorInfo
+  {
+    /* What went wrong */
+    ErrorKind kind = ErrorKind::None;
+
+    /* Zero-based offset of the offending token within the expression; the end of the expression if the failure was
+       running out of tokens, and 0 for failures found during evaluation */
+    size_t position = 0;
+
+    /* The offending token's characters, or the variable name for variable errors. Empty if there is none. */
+    std::string_view token;
+
+    /* The expression being parsed; empty if it was not retained, as for streamed input */
+    std::string_view expression;
+
+    /* Number of invalid characters found in the expression, starting with the one at position */
+    size_t count = 0;
+
+    /* True if lexing stopped at the invalid token limit, leaving the rest of the expression unscanned, so it may hold
+       more than count invalid characters */
+    bool truncated = false;
+
+    /* True if the expression was lexed with identifiers permitted, so letters are not invalid characters */
+    bool identifiers_allowed = false;
+
+    std::string Message() const;
+
+    [[noreturn]] void Throw() const;
+  };
+}
+
+/*
+ * Result
+ *
+ * Holds either the value of a successful call or a description of its failure, for callers that would rather test
+ * for failure than catch it. Asking a failed result for its value throws the exception the throwing API would have.
+ */
+template <typename T> class Result
+{
+public:
+  Result(T value) : contents(std::in_place_index<0>, std::move(value)) {}
+
+  Result(const ExpressionParserErrors::ErrorInfo &error) : contents(std::in_place_index<1>, error) {}
+
+  /*
+   * Has Value
+   *
+   * @return True if the call succeeded
+   */
+  bool hasValue() const { return contents.index() == 0; }
+
+  explicit operator bool() const { return hasValue(); }
+
+  /*
+   * Get Value
+   *
+   * @return The value of the successful call. Throws the exception matching the error if the call failed.
+   */
+  const T &getValue() const
+  {
+    if (!hasValue())
+    {
+      std::get<1>(contents).Throw();
+    }
+    return std::get<0>(contents);
+  }
+
+  /*
+   * Get Error
+   *
+   * @return Description of the failure; kind is ErrorKind::None if the call succeeded
+   */
+  const ExpressionParserErrors::ErrorInfo &getError() const
+  {
+    static const ExpressionParserErrors::ErrorInfo no_error;
+    return hasValue() ? no_error : std::get<1>(contents);
+  }
+
+private:
+  std::variant<T, ExpressionParserErrors::ErrorInfo> contents;
+};
\ No newline at end of file
@@ -0,0 +1,241 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "streaming_lexer.h"
+
+#include <algorithm>
+#include <limits>
+
+#define STREAMING_LITERAL_MAX_RAW 32
+
+/*
+ * Streaming Lexer Constructor
+ *
+ * Creates a lexer ready for the first chunk of an expression
+ */
+StreamingLexer::StreamingLexer()
+{
+  Reset();
+}
+
+/*
+ * Push
+ *
+ * Scans the next chunk of the expression. Characters are classified exactly as Lexer::TryTokenise classifies them.
+ * Once a lexical error has been found no further tokens are produced, but the rest of the stream is still scanned
+ * so that invalid characters take precedence over an out of range literal, as they do for Lexer.
+ *
+ * @param chunk The next characters of the expression. Only needs to remain alive until the next call.
+ * @return The tokens completed by this chunk. Their raw views are valid until the next call to Push, Finish or
+ *         Reset; a literal carried over from earlier chunks reports at most its first STREAMING_LITERAL_MAX_RAW
+ *         characters.
+ */
+const std::vector<Lexer::Token> &StreamingLexer::Push(std::string_view chunk)
+{
+  tokens.clear();
+  completed_literal.clear();
+
+  /* Start of the current literal within this chunk, and whether it is instead one carried over from earlier chunks */
+  size_t literal_start = 0;
+  bool carrying_literal = in_literal;
+
+  for (size_t offset = 0; offset < chunk.size(); offset++)
+  {
+    const char character = chunk[offset];
+
+    if (in_literal)
+    {
+      if (Lexer::isDigit(character))
+      {
+        const int digit = character - '0';
+        if (literal_value > (std::numeric_limits<int>::max() - digit) / 10)
+        {
+          literal_out_of_range = true;
+          if (error.kind == ExpressionParserErrors::ErrorKind::None)
+          {
+            error.kind = ExpressionParserErrors::ErrorKind::LiteralOutOfRange;
+          }
+        }
+        else
+        {
+          literal_value = literal_value * 10 + digit;
+        }
+        continue;
+      }
+
+      if (carrying_literal)
+      {
+        /* The literal began in an earlier chunk; join its digits with the ones from this chunk */
+        carrying_literal = false;
+        completed_literal = partial_literal;
+        completed_literal.append(chunk.substr(0, std::min(offset, STREAMING_LITERAL_MAX_RAW - partial_literal.size())));
+        completeLiteral(completed_literal);
+      }
+      else
+      {
+        completeLiteral(chunk.substr(literal_start, offset - literal_start));
+      }
+    }
+
+    Lexer::Token token{.operation = Lexer::TokenOperation::None,
+                       .value = TOKEN_VALUE_NOT_APPLICABLE,
+                       .raw = chunk.substr(offset, 1),
+                       .position = stream_position + offset};
+
+    switch (character)
+    {
+    case ' ': continue;
+    case '(': token.operation = Lexer::TokenOperation::L_Brace; break;
+    case ')': token.operation = Lexer::TokenOperation::R_Brace; break;
+    case '-': token.operation = Lexer::TokenOperation::Subtraction; break;
+    case '+': token.operation = Lexer::TokenOperation::Addition; break;
+    case '*': token.operation = Lexer::TokenOperation::Multiplication; break;
+    case '/': token.operation = Lexer::TokenOperation::Division; break;
+    default:
+      if (Lexer::isDigit(character))
+      {
+        in_literal = true;
+        literal_value = character - '0';
+        literal_position = token.position;
+        literal_start = offset;
+        continue;
+      }
+
+      if (invalid_count++ == 0)
+      {
+        first_invalid = character;
+        first_invalid_position = token.position;
+      }
+
+      /* Invalid characters take precedence over every other error */
+      error.kind = ExpressionParserErrors::ErrorKind::InvalidToken;
+      error.position = first_invalid_position;
+      error.token = std::string_view(&first_invalid, 1);
+      error.count = invalid_count;
+      continue;
+    }
+
+    produced_tokens = true;
+    if (error.kind == ExpressionParserErrors::ErrorKind::None)
+    {
+      tokens.push_back(token);
+    }
+  }
+
+  if (in_literal)
+  {
+    /* Carry the literal's digits into the next chunk */
+    if (!carrying_literal)
+    {
+      partial_literal.clear();
+    }
+    const std::string_view digits = chunk.substr(literal_start);
+    partial_literal.append(digits.substr(0, STREAMING_LITERAL_MAX_RAW - partial_literal.size()));
+  }
+
+  stream_position += chunk.size();
+  return tokens;
+}
+
+/*
+ * Finish
+ *
+ * Marks the end of the expression, completing a literal left open by the last chunk and deciding the lexical error,
+ * if any
+ *
+ * @return The tokens completed by the end of the stream
+ */
+const std::vector<Lexer::Token> &StreamingLexer::Finish()
+{
+  tokens.clear();
+  completed_literal.clear();
+
+  if (in_literal)
+  {
+    completed_literal = partial_literal;
+    completeLiteral(completed_literal);
+  }
+
+  if (!produced_tokens && error.kind == ExpressionParserErrors::ErrorKind::None)
+  {
+    error.kind = ExpressionParserErrors::ErrorKind::EmptyExpression;
+  }
+
+  return tokens;
+}
+
+/*
+ * Reset
+ *
+ * Prepares the lexer for a new stream
+ */
+void StreamingLexer::Reset()
+{
+  tokens.clear();
+  partial_literal.clear();
+  completed_literal.clear();
+  in_literal = false;
+  literal_value = 0;
+  literal_position = 0;
+  stream_position = 0;
+  invalid_count = 0;
+  first_invalid_position = 0;
+  first_invalid = '\0';
+  literal_out_of_range = false;
+  produced_tokens = false;
+  error = ExpressionParserErrors::ErrorInfo();
+}
+
+/*
+ * Has Error
+ *
+ * @return True once a lexical error has been found; no more tokens are produced after that
+ */
+bool StreamingLexer::hasError() const
+{
+  return error.kind != ExpressionParserErrors::ErrorKind::None;
+}
+
+/*
+ * Get Error
+ *
+ * Only the first invalid character is reported, as the stream is not retained. The views are valid until Reset.
+ *
+ * @return Description of the lexical error found so far; final once Finish has been called
+ */
+const ExpressionParserErrors::ErrorInfo &StreamingLexer::getError() const
+{
+  return error;
+}
+
+/*
+ * Get Position
+ *
+ * @return Number of characters pushed since the stream was started
+ */
+size_t StreamingLexer::getPosition() const
+{
+  return stream_position;
+}
+
+/*
+ * Complete Literal
+ *
+ * Emits the literal currently being scanned
+ *
+ * @param raw The literal's characters
+ */
+void StreamingLexer::completeLiteral(std::string_view raw)
+{
+  in_literal = false;
+  produced_tokens = true;
+
+  if (error.kind == ExpressionParserErrors::ErrorKind::None)
+  {
+    tokens.push_back(Lexer::Token{.operation = Lexer::TokenOperation::Literal,
+                                  .value = literal_value,
+                                  .raw = raw,
+                                  .position = literal_position});
+  }
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lexer.h"
+#include "result.h"
+
+/*
+ * Streaming Lexical Analyser
+ *
+ * Performs the same lexical analysis as Lexer on an expression which arrives in chunks. Each chunk is scanned as it
+ * is pushed and the tokens it completes are handed back straight away; a literal cut off by the end of a chunk is
+ * carried over and completed by the next one. Only the tokens of the latest chunk are held, so memory use is bounded
+ * by the chunk size rather than the length of the expression.
+ *
+ * Identifiers are not supported. Token positions are offsets from the start of the whole stream. The raw characters
+ * of tokens and errors may view the lexer's own buffers, so it can be neither copied nor moved.
+ */
+class StreamingLexer
+{
+public:
+  StreamingLexer();
+
+  StreamingLexer(const StreamingLexer &) = delete;
+  StreamingLexer &operator=(const StreamingLexer &) = delete;
+
+  const std::vector<Lexer::Token> &Push(std::string_view chunk);
+
+  const std::vector<Lexer::Token> &Finish();
+
+  void Reset();
+
+  bool hasError() const;
+
+  const ExpressionParserErrors::ErrorInfo &getError() const;
+
+  size_t getPosition() const;
+
+private:
+  void completeLiteral(std::string_view raw);
+
+  /* Tokens completed by the latest call to Push or Finish */
+  std::vector<Lexer::Token> tokens;
+
+  /* Digits of a literal which may continue into the next chunk, and of the carried literal completed by the latest
+     chunk. Literal digits are only kept up to the length of the largest int. */
+  std::string partial_literal;
+  std::string completed_literal;
+
+  /* The literal currently being scanned, if any */
+  bool in_literal;
+  int literal_value;
+  size_t literal_position;
+
+  /* Offset of the next character to arrive from the start of the stream */
+  size_t stream_position;
+
+  /* Invalid characters found so far; only the first one is kept */
+  size_t invalid_count;
+  size_t first_invalid_position;
+  char first_invalid;
+
+  /* True if any literal is too large to be represented */
+  bool literal_out_of_range;
+
+  /* True once any token has been produced */
+  bool produced_tokens;
+
+  /* Description of the lexical error, once Finish has been called */
+  ExpressionParserErrors::ErrorInfo error;
+};
\ No newline at end of file
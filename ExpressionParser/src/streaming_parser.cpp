@@ -0,0 +1,250 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "streaming_parser.h"
+#include "arithmetic.h"
+
+/*
+ * Streaming Parser Constructor
+ *
+ * Creates a parser ready for the first chunk of an expression
+ */
+StreamingParser::StreamingParser()
+{
+  Reset();
+}
+
+/*
+ * Push
+ *
+ * Lexes and evaluates the next chunk of the expression
+ *
+ * @param chunk The next characters of the expression. It is not retained.
+ */
+void StreamingParser::Push(std::string_view chunk)
+{
+  consumeAll(lexer.Push(chunk));
+}
+
+/*
+ * Finish
+ *
+ * Marks the end of the expression and reports its value
+ *
+ * @return Result of the evaluated expression, or a description of the failure. The views held by an error are
+ *         valid until the next call to Push or Reset.
+ */
+Result<int> StreamingParser::Finish()
+{
+  consumeAll(lexer.Finish());
+
+  if (lexer.hasError())
+  {
+    return lexer.getError();
+  }
+
+  if (error.kind == ExpressionParserErrors::ErrorKind::None)
+  {
+    if (expect_operand)
+    {
+      /* The expression ended where an operand was required; as with RDParser, the last token is reported */
+      fail(ExpressionParserErrors::ErrorKind::UnexpectedToken, last_token, last_token_position);
+    }
+    else if (frames.size() > 1)
+    {
+      fail(ExpressionParserErrors::ErrorKind::ParenthesesMismatch, {}, lexer.getPosition());
+    }
+    else if (divide_by_zero)
+    {
+      fail(ExpressionParserErrors::ErrorKind::DivideByZero, {}, 0);
+    }
+  }
+
+  if (error.kind != ExpressionParserErrors::ErrorKind::None)
+  {
+    return error;
+  }
+
+  return frames.front().value;
+}
+
+/*
+ * Reset
+ *
+ * Prepares the parser for a new expression. Memory already allocated is kept.
+ */
+void StreamingParser::Reset()
+{
+  lexer.Reset();
+  frames.clear();
+  frames.push_back(Frame{.value = 0, .has_value = false, .pending = Lexer::TokenOperation::None, .negate = false});
+  expect_operand = true;
+  last_token.clear();
+  last_token_position = 0;
+  error = ExpressionParserErrors::ErrorInfo();
+  error_token.clear();
+  divide_by_zero = false;
+}
+
+/*
+ * Get Depth
+ *
+ * @return Number of parentheses currently open
+ */
+size_t StreamingParser::getDepth() const
+{
+  return frames.size() - 1;
+}
+
+/*
+ * Consume All
+ *
+ * @param tokens The tokens completed by the latest chunk
+ */
+void StreamingParser::consumeAll(const std::vector<Lexer::Token> &tokens)
+{
+  for (const Lexer::Token &token : tokens)
+  {
+    consume(token);
+  }
+
+  if (!tokens.empty())
+  {
+    /* The lexer reuses the tokens' memory, so keep a copy of the last one */
+    last_token = tokens.back().raw;
+    last_token_position = tokens.back().position;
+  }
+}
+
+/*
+ * Consume
+ *
+ * Advances the parse by one token. The states correspond to the points of RDParser's descent at which the same
+ * token would be examined, and fail in the same way.
+ *
+ * @param token The next token of the expression
+ */
+void StreamingParser::consume(const Lexer::Token &token)
+{
+  if (error.kind != ExpressionParserErrors::ErrorKind::None)
+  {
+    return;
+  }
+
+  if (expect_operand)
+  {
+    /* 'Unary -> ("-") Unary | Primary' and 'Primary -> Literal | "(" Expression ")"' */
+    switch (token.operation)
+    {
+    case Lexer::TokenOperation::Subtraction: frames.back().negate = !frames.back().negate; return;
+
+    case Lexer::TokenOperation::Literal:
+      expect_operand = false;
+      foldOperand(token.value);
+      return;
+
+    case Lexer::TokenOperation::L_Brace:
+      frames.push_back(Frame{.value = 0, .has_value = false, .pending = Lexer::TokenOperation::None, .negate = false});
+      return;
+
+    default: fail(ExpressionParserErrors::ErrorKind::UnexpectedToken, token.raw, token.position); return;
+    }
+  }
+
+  /* 'Binary -> Unary | (("*" | "/" | "+" | "-") Unary)*' */
+  switch (token.operation)
+  {
+  case Lexer::TokenOperation::Addition:
+  case Lexer::TokenOperation::Subtraction:
+  case Lexer::TokenOperation::Multiplication:
+  case Lexer::TokenOperation::Division:
+    frames.back().pending = token.operation;
+    expect_operand = true;
+    return;
+
+  case Lexer::TokenOperation::R_Brace:
+    if (frames.size() > 1)
+    {
+      const int value = frames.back().value;
+      frames.pop_back();
+      foldOperand(value);
+      return;
+    }
+
+    fail(ExpressionParserErrors::ErrorKind::UnexpectedParentheses, token.raw, token.position);
+    return;
+
+  default:
+    if (frames.size() > 1)
+    {
+      /* A closing brace was expected */
+      fail(ExpressionParserErrors::ErrorKind::ParenthesesMismatch, {}, token.position);
+      return;
+    }
+
+    fail(ExpressionParserErrors::ErrorKind::UnexpectedParentheses, token.raw, token.position);
+    return;
+  }
+}
+
+/*
+ * Fold Operand
+ *
+ * Applies the negations preceding a completed operand and combines it with the running value of its level
+ *
+ * @param value Value of the operand
+ */
+void StreamingParser::foldOperand(int value)
+{
+  using Ops = Arithmetic<int32_t, false>;
+  Frame &frame = frames.back();
+
+  if (frame.negate)
+  {
+    Ops::Negate(value, value);
+    frame.negate = false;
+  }
+
+  if (!frame.has_value)
+  {
+    frame.value = value;
+    frame.has_value = true;
+    return;
+  }
+
+  switch (frame.pending)
+  {
+  case Lexer::TokenOperation::Addition: Ops::Add(frame.value, value, frame.value); break;
+  case Lexer::TokenOperation::Subtraction: Ops::Subtract(frame.value, value, frame.value); break;
+  case Lexer::TokenOperation::Multiplication: Ops::Multiply(frame.value, value, frame.value); break;
+  default:
+    if (value == 0)
+    {
+      /* Reported once the whole expression has been parsed, as parse errors take precedence */
+      divide_by_zero = true;
+      frame.value = 0;
+      break;
+    }
+
+    Ops::Divide(frame.value, value, frame.value);
+    break;
+  }
+}
+
+/*
+ * Fail
+ *
+ * Records the first parse error; later tokens are still lexed but no longer parsed
+ *
+ * @param kind What went wrong
+ * @param token The offending token's characters
+ * @param position Offset of the offending token from the start of the stream
+ */
+void StreamingParser::fail(ExpressionParserErrors::ErrorKind kind, std::string_view token, size_t position)
+{
+  error_token = token;
+  error.kind = kind;
+  error.token = error_token;
+  error.position = position;
+}
\ No newline at end of file
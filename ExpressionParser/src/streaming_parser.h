@@ -0,0 +1,91 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lexer.h"
+#include "result.h"
+#include "streaming_lexer.h"
+
+/*
+ * Streaming Parser
+ *
+ * Evaluates an expression which arrives in chunks, using the same grammar as RDParser::Parse. Tokens from the
+ * streaming lexer are consumed as each chunk is pushed. Operators of equal precedence fold from the left, so each
+ * level of parentheses only needs its running value and pending operator; no tree is built and memory use is
+ * bounded by the nesting depth of the expression and the size of a chunk.
+ *
+ * Errors are reported by Finish with the same kind and precedence as RDParser::TryParse: lexical errors first, then
+ * the first parse error, then division by zero. Like its lexer, the parser can be neither copied nor moved.
+ */
+class StreamingParser
+{
+public:
+  StreamingParser();
+
+  StreamingParser(const StreamingParser &) = delete;
+  StreamingParser &operator=(const StreamingParser &) = delete;
+
+  void Push(std::string_view chunk);
+
+  Result<int> Finish();
+
+  void Reset();
+
+  size_t getDepth() const;
+
+private:
+  /*
+   * Nesting Frame
+   *
+   * The state of one level of parentheses (the outermost level is the whole expression)
+   */
+  struct Frame
+  {
+    /* Value of the operands folded so far */
+    int value;
+
+    /* False until the first operand of the level has been folded */
+    bool has_value;
+
+    /* Operator waiting for its right-hand operand */
+    Lexer::TokenOperation pending;
+
+    /* True if an odd number of negations precede the operand being parsed */
+    bool negate;
+  };
+
+  void consume(const Lexer::Token &token);
+
+  void consumeAll(const std::vector<Lexer::Token> &tokens);
+
+  void foldOperand(int value);
+
+  void fail(ExpressionParserErrors::ErrorKind kind, std::string_view token, size_t position);
+
+  /* Lexical analyser the chunks are passed through */
+  StreamingLexer lexer;
+
+  /* One frame per open parenthesis, plus the outermost level */
+  std::vector<Frame> frames;
+
+  /* True if the next token must begin an operand, false if it must be an operator or closing brace */
+  bool expect_operand;
+
+  /* The last token consumed, reported if the expression ends while an operand is expected */
+  std::string last_token;
+  size_t last_token_position;
+
+  /* The first parse error and its offending token */
+  ExpressionParserErrors::ErrorInfo error;
+  std::string error_token;
+
+  /* True if any division by zero was evaluated */
+  bool divide_by_zero;
+};
\ No newline at end of file
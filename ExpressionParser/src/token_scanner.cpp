@@ -0,0 +1,203 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include "token_scanner.h"
+
+#include <limits>
+
+/*
+ * Token Scanner Constructor
+ *
+ * Creates a scanner with no expression; TryBegin must be called before tokens are read.
+ */
+TokenScanner::TokenScanner()
+    : expression(UNINITIALISED_EXPRESSION), allow_identifiers(false), position(0), current{}, previous{},
+      token_count(0), invalid_count(0), first_invalid_position(0), invalid_limit(std::numeric_limits<size_t>::max()),
+      truncated(false), literal_out_of_range(false)
+{
+}
+
+/*
+ * Try Begin
+ *
+ * Starts scanning an expression by reading its first token
+ *
+ * @param expr The expression to scan. Tokens refer back into the caller's buffer, which must outlive them.
+ * @param allow_identifiers True if variable names ([A-Za-z_][A-Za-z0-9_]*) are permitted, otherwise letters are
+ *                          reported as invalid tokens
+ * @param error Receives the description of the failure, if any
+ * @param invalid_token_limit Number of invalid characters after which the expression is no longer scanned;
+ *                            LEXER_NO_INVALID_TOKEN_LIMIT scans it all
+ * @return True if the expression may be parsed, false if it holds no tokens
+ */
+bool TokenScanner::TryBegin(std::string_view expr, bool allow_identifiers, ExpressionParserErrors::ErrorInfo &error,
+                            size_t invalid_token_limit)
+{
+  expression = expr;
+  this->allow_identifiers = allow_identifiers;
+  position = 0;
+  previous = Lexer::Token{};
+  token_count = 0;
+  invalid_count = 0;
+  first_invalid_position = 0;
+  invalid_limit =
+      invalid_token_limit == LEXER_NO_INVALID_TOKEN_LIMIT ? std::numeric_limits<size_t>::max() : invalid_token_limit;
+  truncated = false;
+  literal_out_of_range = false;
+
+  error.expression = expression;
+  error.identifiers_allowed = allow_identifiers;
+
+  current = scan();
+  if (current.operation == Lexer::TokenOperation::None)
+  {
+    /* Nothing but spaces and invalid characters, which take precedence */
+    if (TryFinish(error))
+    {
+      error.kind = ExpressionParserErrors::ErrorKind::EmptyExpression;
+    }
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Try Finish
+ *
+ * Reads the tokens the parser did not consume, so that lexical errors anywhere in the expression are reported. Called
+ * once parsing has finished, successfully or not; the Lexer reports invalid characters, and then literals out of
+ * range, ahead of any parse error, so either replaces whatever the error holds.
+ *
+ * @param error Receives the description of the failure, if any
+ * @return False if the expression holds invalid characters or a literal too large to be represented
+ */
+bool TokenScanner::TryFinish(ExpressionParserErrors::ErrorInfo &error)
+{
+  while (current.operation != Lexer::TokenOperation::None)
+  {
+    Advance();
+  }
+
+  if (invalid_count != 0)
+  {
+    error.kind = ExpressionParserErrors::ErrorKind::InvalidToken;
+    error.position = first_invalid_position;
+    error.token = expression.substr(first_invalid_position, 1);
+    error.count = invalid_count;
+    error.truncated = truncated;
+    return false;
+  }
+
+  if (literal_out_of_range)
+  {
+    error.kind = ExpressionParserErrors::ErrorKind::LiteralOutOfRange;
+    error.token = {};
+    error.position = 0;
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Advance
+ *
+ * Consumes the current token and reads the one after it
+ */
+void TokenScanner::Advance()
+{
+  if constexpr (Instrumentation::enabled)
+  {
+    token_count++;
+  }
+
+  previous = current;
+  current = scan();
+}
+
+/*
+ * Scan
+ *
+ * Reads the token at the current position of an expression known to hold only valid characters
+ *
+ * @return The token, with operation None at the end of the expression
+ */
+Lexer::Token TokenScanner::scan()
+{
+  while (true)
+  {
+    while (position < expression.size() && expression[position] == ' ')
+    {
+      position++;
+    }
+
+    Lexer::Token token{.operation = Lexer::TokenOperation::None, .value = TOKEN_VALUE_NOT_APPLICABLE, .raw = {},
+                       .position = position};
+    if (position == expression.size())
+    {
+      return token;
+    }
+
+    const char character = expression[position];
+    switch (character)
+    {
+    case '(': token.operation = Lexer::TokenOperation::L_Brace; break;
+    case ')': token.operation = Lexer::TokenOperation::R_Brace; break;
+    case '-': token.operation = Lexer::TokenOperation::Subtraction; break;
+    case '+': token.operation = Lexer::TokenOperation::Addition; break;
+    case '*': token.operation = Lexer::TokenOperation::Multiplication; break;
+    case '/': token.operation = Lexer::TokenOperation::Division; break;
+    default:
+      if (Lexer::isDigit(character))
+      {
+        token.operation = Lexer::TokenOperation::Literal;
+        token.value = 0;
+        while (position < expression.size() && Lexer::isDigit(expression[position]))
+        {
+          const int digit = expression[position] - '0';
+          if (token.value > (std::numeric_limits<int>::max() - digit) / 10)
+          {
+            literal_out_of_range = true;
+          }
+          else
+          {
+            token.value = token.value * 10 + digit;
+          }
+          position++;
+        }
+      }
+      else if (!Lexer::isInvalidCharacter(character, allow_identifiers))
+      {
+        token.operation = Lexer::TokenOperation::Identifier;
+        while (position < expression.size() && Lexer::isWordCharacter(expression[position]))
+        {
+          position++;
+        }
+      }
+      else
+      {
+        /* Skipped, so that parsing can go on to the end of the expression where the error is reported */
+        if (invalid_count++ == 0)
+        {
+          first_invalid_position = position;
+        }
+        position++;
+        if (invalid_count == invalid_limit)
+        {
+          /* Nothing further can change the error; end the expression here */
+          truncated = position < expression.size();
+          position = expression.size();
+        }
+        continue;
+      }
+
+      token.raw = expression.substr(token.position, position - token.position);
+      return token;
+    }
+
+    token.raw = expression.substr(position++, 1);
+    return token;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "instrumentation.h"
+#include "lexer.h"
+#include "result.h"
+
+/*
+ * Token Scanner
+ *
+ * Performs the same lexical analysis as Lexer but produces the tokens one at a time, as a parser asks for them,
+ * instead of storing them all first. Only the token being looked at and the one before it are held, so the memory
+ * used does not depend on the length of the expression.
+ *
+ * The Lexer reports invalid characters, and then literals too large to be represented, ahead of any parse error. To
+ * keep that order without a second pass over the expression, invalid characters are skipped and counted as tokens
+ * are read, and TryFinish, called once parsing has finished, reads whatever the parser left unread and reports any
+ * lexical error in place of the parser's own. Once the invalid token limit given to TryBegin is reached, the scanner
+ * jumps to the end of the expression, so the parser finishes at once and the rest of the expression is never read.
+ */
+class TokenScanner
+{
+public:
+  TokenScanner();
+
+  bool TryBegin(std::string_view expr, bool allow_identifiers, ExpressionParserErrors::ErrorInfo &error,
+                size_t invalid_token_limit = LEXER_NO_INVALID_TOKEN_LIMIT);
+
+  bool TryFinish(ExpressionParserErrors::ErrorInfo &error);
+
+  void Advance();
+
+  /*
+   * Get Current
+   *
+   * @return The next token to be consumed; operation None, positioned at the end of the expression, once every
+   *         token has been consumed
+   */
+  const Lexer::Token &getCurrent() const { return current; }
+
+  /*
+   * Get Previous
+   *
+   * @return The most recently consumed token
+   */
+  const Lexer::Token &getPrevious() const { return previous; }
+
+  /*
+   * Get Token Count
+   *
+   * @return Number of tokens consumed since TryBegin; only counted when instrumentation is enabled
+   */
+  size_t getTokenCount() const { return token_count; }
+
+private:
+  Lexer::Token scan();
+
+  /* The expression being scanned. A view onto the caller's buffer; it is never copied. */
+  std::string_view expression;
+
+  /* True if variable names are lexed as identifiers */
+  bool allow_identifiers;
+
+  /* Offset of the first character not yet scanned */
+  size_t position;
+
+  /* Lookahead of one token, and the token consumed before it */
+  Lexer::Token current;
+  Lexer::Token previous;
+
+  /* Tokens consumed so far, for instrumentation */
+  size_t token_count;
+
+  /* Invalid characters skipped so far; only the first one is kept */
+  size_t invalid_count;
+  size_t first_invalid_position;
+
+  /* Invalid characters after which the rest of the expression is skipped, and whether that happened */
+  size_t invalid_limit;
+  bool truncated;
+
+  /* True if any literal scanned so far is too large to be represented */
+  bool literal_out_of_range;
+};
\ No newline at end of file
@@ -0,0 +1,859 @@
+/*
+ * Author: Jaydan Cowell
+ * Date: 2024-06-02
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../ExpressionParser/src/constant_parser.h"
+#include "../ExpressionParser/src/errors.h"
+#include "../ExpressionParser/src/expression_cache.h"
+#include "../ExpressionParser/src/expression_catalogue.h"
+#include "../ExpressionParser/src/expression_dag.h"
+#include "../ExpressionParser/src/incremental_evaluator.h"
+#include "../ExpressionParser/src/iterative_parser.h"
+#include "../ExpressionParser/src/rd_parser.h"
+#include "../ExpressionParser/src/streaming_parser.h"
+
+/*
+ * Differential tester for every evaluation engine.
+ *
+ * Each expression is evaluated by the reference, RDParser::Parse with the options it had before tokens were scanned
+ * on demand and expressions evaluated directly, and then by every other engine: the other RDParser configurations,
+ * IterativeParser, StreamingParser, ConstantParser, and compiled expressions run on the interpreter, checked and
+ * 64-bit arithmetic, the batch kernels, native code, a catalogue image, a DAG, an incremental evaluator and the
+ * cache. Every engine must produce the reference's value, or fail with the reference's ErrorKind; the throwing
+ * methods must throw the errors.h exception of that kind. Engines reading the same text must also report the same
+ * error position.
+ *
+ * Without FUZZ_LIBFUZZER the program generates its own expressions, valid and invalid, with deep nesting, stacks of
+ * negations, large literals and variables:
+ *
+ *   Fuzz [--iterations N] [--seed S]
+ *
+ * With FUZZ_LIBFUZZER defined (and built with -fsanitize=fuzzer, or /fsanitize=fuzzer under MSVC) it is a libFuzzer
+ * target instead, treating each input as the text of one expression and aborting on the first disagreement.
+ */
+
+#define FUZZ_DEFAULT_ITERATIONS 100000
+
+/* Parentheses the generator nests at most, below CONSTANT_PARSER_MAX_DEPTH so that every parser accepts them */
+#define FUZZ_MAX_DEPTH 200
+
+/* Variable names the generator binds */
+static const char *const fuzz_variables[] = {"a", "b", "c", "rate", "x_1"};
+
+/*
+ * Outcome
+ *
+ * What an engine made of an expression
+ */
+struct Outcome
+{
+  ExpressionParserErrors::ErrorKind kind = ExpressionParserErrors::ErrorKind::None;
+  int value = 0;
+  size_t position = 0;
+};
+
+/*
+ * Case
+ *
+ * One expression to check. Engines which do not take variables read reference_text, in which each variable is
+ * replaced by its bound value; compiled expressions read text and are given the bindings.
+ */
+struct Case
+{
+  std::string text;
+  std::string reference_text;
+  std::vector<std::pair<std::string, int>> bindings;
+
+  /* False if compiled expressions, which permit identifiers, would not lex text as the other engines do */
+  bool compilable = true;
+};
+
+/*
+ * Kind Name
+ *
+ * @param kind An error kind
+ * @return Its name, for reports
+ */
+static const char *kindName(ExpressionParserErrors::ErrorKind kind)
+{
+  static const char *const names[] = {"None",
+                                      "InvalidToken",
+                                      "EmptyExpression",
+                                      "LiteralOutOfRange",
+                                      "ParenthesesMismatch",
+                                      "UnexpectedParentheses",
+                                      "UnexpectedToken",
+                                      "NestingTooDeep",
+                                      "DivideByZero",
+                                      "Overflow",
+                                      "UnknownVariable",
+                                      "UnboundVariable"};
+  return names[static_cast<size_t>(kind)];
+}
+
+/*
+ * From Result
+ *
+ * @param result The result of a non-throwing method
+ * @return Its outcome
+ */
+static Outcome fromResult(const Result<int> &result)
+{
+  Outcome outcome;
+  if (result)
+  {
+    outcome.value = result.getValue();
+  }
+  else
+  {
+    outcome.kind = result.getError().kind;
+    outcome.position = result.getError().position;
+  }
+  return outcome;
+}
+
+/*
+ * Catching
+ *
+ * Runs a throwing method, mapping the exception it throws back onto the kind of error it reports
+ *
+ * @param evaluate Returns the value of the expression or throws
+ * @return Its outcome, without a position
+ */
+template <typename Evaluate> static Outcome catching(Evaluate evaluate)
+{
+  using ExpressionParserErrors::ErrorKind;
+  Outcome outcome;
+  try
+  {
+    outcome.value = evaluate();
+  }
+  catch (const ExpressionParserErrors::InvalidTokenException &)
+  {
+    outcome.kind = ErrorKind::InvalidToken;
+  }
+  catch (const ExpressionParserErrors::EmptyExpressionException &)
+  {
+    outcome.kind = ErrorKind::EmptyExpression;
+  }
+  catch (const std::out_of_range &)
+  {
+    outcome.kind = ErrorKind::LiteralOutOfRange;
+  }
+  catch (const ExpressionParserErrors::ParenthesesMismatchException &)
+  {
+    outcome.kind = ErrorKind::ParenthesesMismatch;
+  }
+  catch (const ExpressionParserErrors::UnexpectedParenthesesException &)
+  {
+    outcome.kind = ErrorKind::UnexpectedParentheses;
+  }
+  catch (const ExpressionParserErrors::UnexpectedTokenException &)
+  {
+    outcome.kind = ErrorKind::UnexpectedToken;
+  }
+  catch (const ExpressionParserErrors::NestingTooDeepException &)
+  {
+    outcome.kind = ErrorKind::NestingTooDeep;
+  }
+  catch (const ExpressionParserErrors::DivideByZeroException &)
+  {
+    outcome.kind = ErrorKind::DivideByZero;
+  }
+  catch (const ExpressionParserErrors::OverflowException &)
+  {
+    outcome.kind = ErrorKind::Overflow;
+  }
+  catch (const ExpressionParserErrors::UnknownVariableException &)
+  {
+    outcome.kind = ErrorKind::UnknownVariable;
+  }
+  catch (const ExpressionParserErrors::UnboundVariableException &)
+  {
+    outcome.kind = ErrorKind::UnboundVariable;
+  }
+  return outcome;
+}
+
+/*
+ * Differential Tester
+ *
+ * Holds an instance of every engine and compares their outcomes
+ */
+class DifferentialTester
+{
+public:
+  DifferentialTester()
+      : reference(referenceOptions()), tokenising_direct(tokenisingDirectOptions()),
+        scanning_tabled(scanningTabledOptions()), unoptimised(AstOptimiser::Options{false, false, false})
+  {
+  }
+
+  bool Check(const Case &test, uint32_t chunk_seed);
+
+  size_t getErrorCount() const { return error_count; }
+
+private:
+  static RDParser::Options referenceOptions();
+  static RDParser::Options tokenisingDirectOptions();
+  static RDParser::Options scanningTabledOptions();
+
+  bool compare(const Case &test, const char *engine, const Outcome &expected, const Outcome &actual,
+               bool compare_position);
+
+  Outcome streamed(std::string_view text, uint32_t chunk_seed);
+
+  Outcome compiled(const Case &test, const Result<CompiledExpression> &compiled, const Outcome &expected,
+                   const char *engine, bool &agreed);
+
+  RDParser reference;
+  RDParser fused;
+  RDParser tokenising_direct;
+  RDParser scanning_tabled;
+  RDParser unoptimised;
+  IterativeParser iterative;
+  StreamingParser streaming;
+  ExpressionCache cache;
+
+  size_t error_count = 0;
+};
+
+/*
+ * Reference Options
+ *
+ * @return The configuration RDParser::Parse had before the scanner and direct evaluation: the whole expression
+ *         tokenised first, and evaluated from the node table
+ */
+RDParser::Options DifferentialTester::referenceOptions()
+{
+  RDParser::Options options;
+  options.tokenise_first = true;
+  options.evaluate_directly = false;
+  return options;
+}
+
+/*
+ * Tokenising Direct Options
+ *
+ * @return Tokenised first, evaluated while parsing
+ */
+RDParser::Options DifferentialTester::tokenisingDirectOptions()
+{
+  RDParser::Options options;
+  options.tokenise_first = true;
+  options.evaluate_directly = true;
+  return options;
+}
+
+/*
+ * Scanning Tabled Options
+ *
+ * @return Scanned on demand, evaluated from the node table
+ */
+RDParser::Options DifferentialTester::scanningTabledOptions()
+{
+  RDParser::Options options;
+  options.tokenise_first = false;
+  options.evaluate_directly = false;
+  return options;
+}
+
+/*
+ * Check
+ *
+ * Runs one case through every engine
+ *
+ * @param test The case
+ * @param chunk_seed Chooses where the streamed expression is split into chunks
+ * @return True if every engine agreed with the reference
+ */
+bool DifferentialTester::Check(const Case &test, uint32_t chunk_seed)
+{
+  const std::string_view text = test.reference_text;
+  const Outcome expected = fromResult(reference.TryParse(text));
+  if (expected.kind != ExpressionParserErrors::ErrorKind::None)
+  {
+    error_count++;
+  }
+
+  bool agreed = compare(test, "RDParser::Parse (reference)", expected,
+                        catching([&]() { return reference.Parse(text); }), false);
+  agreed &= compare(test, "RDParser::TryParse", expected, fromResult(fused.TryParse(text)), true);
+  agreed &= compare(test, "RDParser::Parse", expected, catching([&]() { return fused.Parse(text); }), false);
+  agreed &= compare(test, "RDParser::TryParse (tokenised, direct)", expected,
+                    fromResult(tokenising_direct.TryParse(text)), true);
+  agreed &= compare(test, "RDParser::TryParse (scanned, node table)", expected,
+                    fromResult(scanning_tabled.TryParse(text)), true);
+  agreed &= compare(test, "IterativeParser::TryParse", expected, fromResult(iterative.TryParse(text)), true);
+  agreed &= compare(test, "IterativeParser::Parse", expected, catching([&]() { return iterative.Parse(text); }),
+                    false);
+  agreed &= compare(test, "StreamingParser", expected, streamed(text, chunk_seed), true);
+
+  /* Deeper nesting than its fixed stack allows is rejected by design */
+  if (static_cast<size_t>(std::count(text.begin(), text.end(), '(')) < CONSTANT_PARSER_MAX_DEPTH)
+  {
+    Outcome constant;
+    ExpressionParserErrors::ErrorInfo error;
+    if (!ConstantParser::TryParse(text, constant.value, error))
+    {
+      constant = Outcome{.kind = error.kind, .value = 0, .position = error.position};
+    }
+    agreed &= compare(test, "ConstantParser::TryParse", expected, constant, true);
+  }
+
+  if (!test.compilable)
+  {
+    return agreed;
+  }
+
+  /* Optimisation must not change checked evaluation either, including where it overflows, so every optimised
+     compilation's checked outcome is compared with the unoptimised one whatever the unchecked reference says */
+  const Outcome checked =
+      compiled(test, unoptimised.TryCompile(test.text), expected, "CompiledExpression (unoptimised)", agreed);
+  const Outcome fused_checked = compiled(test, fused.TryCompile(test.text), expected, "CompiledExpression", agreed);
+  const Outcome tokenised_checked = compiled(test, tokenising_direct.TryCompile(test.text), expected,
+                                             "CompiledExpression (tokenised)", agreed);
+  const Outcome iterative_checked =
+      compiled(test, iterative.TryCompile(test.text), expected, "CompiledExpression (iterative)", agreed);
+  const Outcome cache_checked = compiled(test, cache.Get(test.text), expected, "ExpressionCache", agreed);
+  agreed &= compare(test, "CompiledExpression checked", checked, fused_checked, false);
+  agreed &= compare(test, "CompiledExpression (tokenised) checked", checked, tokenised_checked, false);
+  agreed &= compare(test, "CompiledExpression (iterative) checked", checked, iterative_checked, false);
+  agreed &= compare(test, "ExpressionCache checked", checked, cache_checked, false);
+  return agreed;
+}
+
+/*
+ * Compare
+ *
+ * @param test The case being checked
+ * @param engine Name of the engine, for reports
+ * @param expected The reference's outcome
+ * @param actual The engine's outcome
+ * @param compare_position True if the engine read the same text as the reference, so reports the same position
+ * @return True if the outcomes agree
+ */
+bool DifferentialTester::compare(const Case &test, const char *engine, const Outcome &expected, const Outcome &actual,
+                                 bool compare_position)
+{
+  const bool agree = expected.kind == actual.kind &&
+                     (expected.kind != ExpressionParserErrors::ErrorKind::None || expected.value == actual.value) &&
+                     (!compare_position || expected.kind == ExpressionParserErrors::ErrorKind::None ||
+                      expected.position == actual.position);
+  if (!agree)
+  {
+    std::fprintf(stderr, "Mismatch in %s\n  expression: \"%s\"\n  reference:  \"%s\"\n", engine, test.text.c_str(),
+                 test.reference_text.c_str());
+    std::fprintf(stderr, "  expected %s value %d position %zu\n  actual   %s value %d position %zu\n",
+                 kindName(expected.kind), expected.value, expected.position, kindName(actual.kind), actual.value,
+                 actual.position);
+  }
+  return agree;
+}
+
+/*
+ * Streamed
+ *
+ * @param text The expression
+ * @param chunk_seed Chooses the lengths of the chunks, from 1 to 8 characters
+ * @return StreamingParser's outcome for the expression pushed in chunks
+ */
+Outcome DifferentialTester::streamed(std::string_view text, uint32_t chunk_seed)
+{
+  std::minstd_rand chunk_lengths(chunk_seed + 1);
+  streaming.Reset();
+  for (size_t offset = 0; offset < text.size();)
+  {
+    const size_t length = std::min<size_t>(1 + chunk_lengths() % 8, text.size() - offset);
+    streaming.Push(text.substr(offset, length));
+    offset += length;
+  }
+  return fromResult(streaming.Finish());
+}
+
+/*
+ * Compiled
+ *
+ * Evaluates a compiled expression on every engine which runs one, comparing each with the reference
+ *
+ * @param test The case being checked
+ * @param compiled The expression compiled from the case's text, or the error compiling it
+ * @param expected The reference's outcome
+ * @param engine Name of the compiler, for reports
+ * @param agreed Cleared if any engine disagrees
+ * @return The outcome of checked int32 evaluation, or the error compiling the expression
+ */
+Outcome DifferentialTester::compiled(const Case &test, const Result<CompiledExpression> &compiled,
+                                     const Outcome &expected, const char *engine, bool &agreed)
+{
+  const std::string name = engine;
+  if (!compiled)
+  {
+    const Outcome failure{.kind = compiled.getError().kind, .value = 0, .position = 0};
+    agreed &= compare(test, (name + " compile").c_str(), expected, failure, false);
+    return failure;
+  }
+
+  const CompiledExpression &expression = compiled.getValue();
+  std::vector<int> bindings(expression.getVariableCount());
+  std::vector<int64_t> wide_bindings(bindings.size());
+  for (const std::pair<std::string, int> &binding : test.bindings)
+  {
+    for (size_t slot = 0; slot < bindings.size(); slot++)
+    {
+      if (expression.getVariableName(slot) == binding.first)
+      {
+        bindings[slot] = binding.second;
+        wide_bindings[slot] = binding.second;
+      }
+    }
+  }
+
+  const Outcome interpreted = fromResult(expression.TryEvaluate(bindings));
+  agreed &= compare(test, (name + " interpreter").c_str(), expected, interpreted, false);
+
+  /* Checked arithmetic may only differ by reporting overflow, and if it does not the 64-bit result cannot differ */
+  const Outcome checked = fromResult(expression.TryEvaluateAs<int32_t, true>(bindings));
+  if (checked.kind != ExpressionParserErrors::ErrorKind::Overflow)
+  {
+    agreed &= compare(test, (name + " checked").c_str(), expected, checked, false);
+
+    const Result<int64_t> wide = expression.TryEvaluateAs<int64_t>(wide_bindings);
+    const Outcome wide_outcome{.kind = wide ? ExpressionParserErrors::ErrorKind::None : wide.getError().kind,
+                               .value = wide ? static_cast<int>(wide.getValue()) : 0,
+                               .position = 0};
+    agreed &= compare(test, (name + " int64").c_str(), expected, wide_outcome, false);
+  }
+
+  /* The same row three times, so that the vector kernels run */
+  constexpr size_t rows = 3;
+  std::vector<std::vector<int>> column_values(bindings.size(), std::vector<int>(rows));
+  std::vector<const int *> columns(bindings.size());
+  for (size_t slot = 0; slot < bindings.size(); slot++)
+  {
+    column_values[slot].assign(rows, bindings[slot]);
+    columns[slot] = column_values[slot].data();
+  }
+  int results[rows];
+  uint8_t error_mask[rows];
+  expression.EvaluateBatch(columns, rows, results, error_mask);
+  for (size_t row = 0; row < rows; row++)
+  {
+    const Outcome batched{.kind = error_mask[row] != 0 ? ExpressionParserErrors::ErrorKind::DivideByZero
+                                                        : ExpressionParserErrors::ErrorKind::None,
+                          .value = results[row],
+                          .position = 0};
+    agreed &= compare(test, (name + " batch").c_str(), expected, batched, false);
+  }
+
+  ExpressionCatalogue::Builder builder;
+  builder.Add(test.text, expression);
+  const std::string image = builder.Serialise();
+  const ExpressionCatalogue catalogue(image);
+  agreed &= compare(test, (name + " catalogue").c_str(), expected, fromResult(catalogue[0].TryEvaluate(bindings)),
+                    false);
+
+  ExpressionDag dag;
+  dag.Add(expression);
+  dag.Add(expression);
+  std::vector<int> dag_bindings(dag.getVariableCount());
+  for (size_t slot = 0; slot < dag_bindings.size(); slot++)
+  {
+    dag_bindings[slot] = bindings[expression.getSlot(dag.getVariableName(slot))];
+  }
+  int dag_results[2];
+  uint8_t dag_errors[2];
+  dag.Evaluate(dag_bindings, dag_results, dag_errors);
+  const Outcome shared{.kind = dag_errors[1] != 0 ? ExpressionParserErrors::ErrorKind::DivideByZero
+                                                   : ExpressionParserErrors::ErrorKind::None,
+                       .value = dag_results[1],
+                       .position = 0};
+  agreed &= compare(test, (name + " DAG").c_str(), expected, shared, false);
+
+  /* Starts from all zeros, so that every variable is then updated */
+  IncrementalEvaluator incremental(expression, std::vector<int>(bindings.size()));
+  for (size_t slot = 0; slot < bindings.size(); slot++)
+  {
+    incremental.Update(slot, bindings[slot]);
+  }
+  agreed &= compare(test, (name + " incremental").c_str(), expected, fromResult(incremental.TryGetValue()), false);
+
+  /* Translated last, since every copy of the handle uses native code afterwards */
+  if (expression.CompileNative())
+  {
+    agreed &= compare(test, (name + " native").c_str(), expected, fromResult(expression.TryEvaluate(bindings)),
+                      false);
+  }
+
+  return checked;
+}
+
+/*
+ * Expression Generator
+ *
+ * Produces random expressions in the parser's grammar, mostly valid, together with the same expression with its
+ * variables replaced by their values
+ */
+class ExpressionGenerator
+{
+public:
+  explicit ExpressionGenerator(uint32_t seed) : random(seed) {}
+
+  Case Generate();
+
+  uint32_t Next() { return static_cast<uint32_t>(random()); }
+
+private:
+  void expression(Case &test, size_t depth);
+
+  void unary(Case &test, size_t depth);
+
+  void primary(Case &test, size_t depth);
+
+  void emit(Case &test, std::string_view text);
+
+  void space(Case &test);
+
+  void mutate(Case &test);
+
+  int bindingValue();
+
+  bool chance(uint32_t percent) { return random() % 100 < percent; }
+
+  std::mt19937 random;
+
+  /* True if the expression being generated may use variables */
+  bool variables = false;
+};
+
+/*
+ * Generate
+ *
+ * @return A new case. Around a third use variables; of the rest, around a third have random characters inserted,
+ *         deleted or replaced to make them (usually) invalid.
+ */
+Case ExpressionGenerator::Generate()
+{
+  Case test;
+  variables = chance(30);
+
+  if (chance(5))
+  {
+    /* Deeply nested, at the limit of the constant parser's stack */
+    const size_t depth = FUZZ_MAX_DEPTH - random() % 20;
+    emit(test, std::string(depth, '('));
+    expression(test, FUZZ_MAX_DEPTH);
+    emit(test, std::string(depth, ')'));
+  }
+  else
+  {
+    expression(test, 0);
+  }
+
+  if (!variables && chance(35))
+  {
+    mutate(test);
+  }
+
+  return test;
+}
+
+/*
+ * Expression
+ *
+ * Appends operands joined by binary operators
+ *
+ * @param test The case being built
+ * @param depth Parentheses open around the position
+ */
+void ExpressionGenerator::expression(Case &test, size_t depth)
+{
+  static const char operators[] = {'+', '-', '*', '/'};
+  const size_t operands = 1 + random() % (depth < 8 ? 5 : 2);
+  for (size_t operand = 0; operand < operands; operand++)
+  {
+    if (operand != 0)
+    {
+      space(test);
+      emit(test, std::string_view(&operators[random() % 4], 1));
+      space(test);
+    }
+    unary(test, depth);
+  }
+}
+
+/*
+ * Unary
+ *
+ * Appends an operand, usually without negations and occasionally under a long stack of them
+ *
+ * @param test The case being built
+ * @param depth Parentheses open around the position
+ */
+void ExpressionGenerator::unary(Case &test, size_t depth)
+{
+  size_t negations = 0;
+  if (chance(25))
+  {
+    negations = chance(10) ? 20 + random() % 60 : 1 + random() % 3;
+  }
+
+  for (size_t negation = 0; negation < negations; negation++)
+  {
+    emit(test, "-");
+    if (chance(20))
+    {
+      space(test);
+    }
+  }
+  primary(test, depth);
+}
+
+/*
+ * Primary
+ *
+ * Appends a literal, a variable or a parenthesised expression
+ *
+ * @param test The case being built
+ * @param depth Parentheses open around the position
+ */
+void ExpressionGenerator::primary(Case &test, size_t depth)
+{
+  if (depth < FUZZ_MAX_DEPTH && chance(depth < 4 ? 30 : 10))
+  {
+    emit(test, "(");
+    space(test);
+    expression(test, depth + 1);
+    space(test);
+    emit(test, ")");
+    return;
+  }
+
+  if (variables && chance(40))
+  {
+    const char *name = fuzz_variables[random() % std::size(fuzz_variables)];
+    bool bound = false;
+    int value = 0;
+    for (const std::pair<std::string, int> &binding : test.bindings)
+    {
+      if (binding.first == name)
+      {
+        bound = true;
+        value = binding.second;
+      }
+    }
+    if (!bound)
+    {
+      value = bindingValue();
+      test.bindings.emplace_back(name, value);
+    }
+
+    /* Spaces keep the name from running into a neighbouring literal or name */
+    test.text += ' ';
+    test.text += name;
+    test.text += ' ';
+    test.reference_text += value == std::numeric_limits<int>::min() ? std::string("(0 - 2147483647 - 1)")
+                                                                     : "(" + std::to_string(value) + ")";
+    return;
+  }
+
+  const uint32_t kind = random() % 100;
+  if (kind < 15)
+  {
+    emit(test, "0");
+  }
+  else if (kind < 70)
+  {
+    emit(test, std::to_string(random() % 10));
+  }
+  else if (kind < 90)
+  {
+    emit(test, std::to_string(random() % 100000));
+  }
+  else if (kind < 97)
+  {
+    emit(test, std::to_string(std::numeric_limits<int>::max() - random() % 3));
+  }
+  else
+  {
+    /* Just beyond int */
+    emit(test, std::to_string(uint64_t(std::numeric_limits<int>::max()) + 1 + random() % 1000));
+  }
+}
+
+/*
+ * Emit
+ *
+ * @param test The case being built
+ * @param text Characters appended to both of its expressions
+ */
+void ExpressionGenerator::emit(Case &test, std::string_view text)
+{
+  test.text += text;
+  test.reference_text += text;
+}
+
+/*
+ * Space
+ *
+ * Appends nothing, or one or two spaces
+ *
+ * @param test The case being built
+ */
+void ExpressionGenerator::space(Case &test)
+{
+  const uint32_t spaces = random() % 4;
+  if (spaces >= 2)
+  {
+    emit(test, std::string(spaces - 1, ' '));
+  }
+}
+
+/*
+ * Mutate
+ *
+ * Inserts, deletes or replaces up to three characters of an expression without variables
+ *
+ * @param test The case being built; its expressions are identical
+ */
+void ExpressionGenerator::mutate(Case &test)
+{
+  static const char characters[] = "()()+-*/ 0123456789#.$x";
+  const size_t mutations = 1 + random() % 3;
+  for (size_t mutation = 0; mutation < mutations; mutation++)
+  {
+    const size_t position = test.text.empty() ? 0 : random() % (test.text.size() + 1);
+    const char character = characters[random() % (sizeof(characters) - 1)];
+    switch (random() % 3)
+    {
+    case 0: test.text.insert(test.text.begin() + position, character); break;
+
+    case 1:
+      if (position < test.text.size())
+      {
+        test.text.erase(position, 1);
+      }
+      break;
+
+    default:
+      if (position < test.text.size())
+      {
+        test.text[position] = character;
+      }
+      break;
+    }
+  }
+
+  /* A letter is an invalid token to the parsers but an identifier to the compiler */
+  test.compilable = test.text.find('x') == std::string::npos;
+  test.reference_text = test.text;
+}
+
+/*
+ * Binding Value
+ *
+ * @return A value for a variable, often zero or at the edge of int
+ */
+int ExpressionGenerator::bindingValue()
+{
+  switch (random() % 6)
+  {
+  case 0: return 0;
+  case 1: return static_cast<int>(random() % 5) - 2;
+  case 2: return std::numeric_limits<int>::max();
+  case 3: return std::numeric_limits<int>::min();
+  default: return static_cast<int>(random());
+  }
+}
+
+#ifdef FUZZ_LIBFUZZER
+
+/*
+ * LLVM Fuzzer Test One Input
+ *
+ * libFuzzer's entry point. The input is one expression; compiled expressions are only checked when it has no
+ * letters, which the compiler would read as variables.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  static DifferentialTester tester;
+
+  Case test;
+  test.text.assign(reinterpret_cast<const char *>(data), size);
+  test.reference_text = test.text;
+  for (const char character : test.text)
+  {
+    if (Lexer::isWordCharacter(character) && !Lexer::isDigit(character))
+    {
+      test.compilable = false;
+    }
+  }
+
+  if (!tester.Check(test, static_cast<uint32_t>(size)))
+  {
+    std::abort();
+  }
+  return 0;
+}
+
+#else
+
+/*
+ * Main
+ *
+ * Checks generated expressions until one disagrees or the iterations run out
+ *
+ * @return 0 if every engine agreed on every expression, 1 otherwise
+ */
+int main(int argc, char **argv)
+{
+  size_t iterations = FUZZ_DEFAULT_ITERATIONS;
+  uint32_t seed = 1;
+  for (int argument = 1; argument < argc; argument++)
+  {
+    if (std::strcmp(argv[argument], "--iterations") == 0 && argument + 1 < argc)
+    {
+      iterations = std::strtoull(argv[++argument], nullptr, 10);
+    }
+    else if (std::strcmp(argv[argument], "--seed") == 0 && argument + 1 < argc)
+    {
+      seed = static_cast<uint32_t>(std::strtoul(argv[++argument], nullptr, 10));
+    }
+    else
+    {
+      std::fprintf(stderr, "Usage: %s [--iterations N] [--seed S]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  ExpressionGenerator generator(seed);
+  DifferentialTester tester;
+  for (size_t iteration = 0; iteration < iterations; iteration++)
+  {
+    const Case test = generator.Generate();
+    if (!tester.Check(test, generator.Next()))
+    {
+      std::fprintf(stderr, "Failed at iteration %zu with seed %u\n", iteration, seed);
+      return 1;
+    }
+  }
+
+  std::printf("%zu expressions, %zu erroneous, every engine agreed\n", iterations, tester.getErrorCount());
+  return 0;
+}
+
+#endif
\ No newline at end of file
@@ -4,7 +4,31 @@
  */
 #include "CppUnitTest.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "../ExpressionParser/src/arena.h"
+#include "../ExpressionParser/src/batch_engine.h"
+#include "../ExpressionParser/src/batch_kernels.h"
+#include "../ExpressionParser/src/bulk_evaluator.h"
+#include "../ExpressionParser/src/bytecode.h"
+#include "../ExpressionParser/src/constant_parser.h"
+#include "../ExpressionParser/src/evaluation_service.h"
+#include "../ExpressionParser/src/expression_cache.h"
+#include "../ExpressionParser/src/expression_catalogue.h"
+#include "../ExpressionParser/src/expression_dag.h"
+#include "../ExpressionParser/src/flat_ast.h"
+#include "../ExpressionParser/src/incremental_evaluator.h"
+#include "../ExpressionParser/src/instrumentation.h"
+#include "../ExpressionParser/src/iterative_parser.h"
+#include "../ExpressionParser/src/mapped_file.h"
+#include "../ExpressionParser/src/native_code.h"
 #include "../ExpressionParser/src/rd_parser.h"
+#include "../ExpressionParser/src/streaming_parser.h"
 #include "../ExpressionParser/src/errors.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -119,5 +143,1127 @@ namespace Tests
             int result = parser.Parse("----5+---6*6");
             Assert::AreEqual(result, -6);
 		}
+
+		TEST_METHOD(EmptyExpressionExcepts)
+		{
+			RDParser parser;
+			auto function = [&parser] { parser.Parse("   "); };
+			Assert::ExpectException<ExpressionParserErrors::EmptyExpressionException>(function);
+		}
+
+		TEST_METHOD(InvalidTokenPositionsReported)
+		{
+			Lexer lexer;
+			try
+			{
+				lexer.Tokenise("1 + a * 2b");
+				Assert::Fail();
+			}
+			catch (const ExpressionParserErrors::InvalidTokenException &e)
+			{
+				Assert::AreEqual(e.getPositions().size(), size_t(2));
+				Assert::AreEqual(e.getPositions()[0], size_t(4));
+				Assert::AreEqual(e.getPositions()[1], size_t(9));
+			}
+			Assert::AreEqual(lexer.getTokenCount(), size_t(0));
+		}
+
+		TEST_METHOD(MultiDigitLiteralsTokenised)
+		{
+			Lexer lexer;
+			lexer.Tokenise("123+(45)");
+			Assert::AreEqual(lexer.getTokenCount(), size_t(5));
+			Assert::AreEqual(lexer.getToken(0).value, 123);
+			Assert::AreEqual(lexer.getToken(3).value, 45);
+		}
+
+		TEST_METHOD(UnexpectedTokenPositionReported)
+		{
+			RDParser parser;
+			try
+			{
+				parser.Parse("5 + )6 *+ 4");
+				Assert::Fail();
+			}
+			catch (const ExpressionParserErrors::UnexpectedTokenException &e)
+			{
+				Assert::AreEqual(e.getPosition(), size_t(4));
+			}
+		}
+
+		TEST_METHOD(ParseFromStringViewSubrange)
+		{
+			RDParser parser;
+			std::string_view buffer = "(2 * 3) trailing text";
+			int result = parser.Parse(buffer.substr(0, 7));
+			Assert::AreEqual(result, 6);
+		}
+
+		TEST_METHOD(ArenaMemoryReusedAfterReset)
+		{
+			Arena arena(64);
+			void *first = arena.Allocate(48, 8);
+			arena.Allocate(48, 8);
+			arena.Reset();
+			Assert::IsTrue(arena.Allocate(48, 8) == first);
+		}
+
+		TEST_METHOD(ParserReusableAcrossExpressions)
+		{
+			RDParser parser;
+			Assert::AreEqual(parser.Parse("1 + 2 * 3 - 4 / 2"), 2);
+			Assert::AreEqual(parser.Parse("-(8)"), -8);
+			Assert::AreEqual(parser.Parse("1 + 2 * 3 - 4 / 2"), 2);
+		}
+
+		TEST_METHOD(FlatAstEvaluatesLastNodeAsRoot)
+		{
+			Arena arena;
+			FlatAst ast;
+			ast.Reset(arena, 4);
+			FlatAst::NodeIndex left = ast.AddLiteral(7);
+			FlatAst::NodeIndex right = ast.AddUnary(ast.AddLiteral(2));
+			ast.AddBinary(FlatAst::OpCode::Multiplication, left, right);
+			Assert::AreEqual(ast.getNodeCount(), size_t(4));
+			int values[4];
+			Assert::AreEqual(ast.Evaluate(values), -14);
+		}
+
+		TEST_METHOD(FlatAstGrowsWhenFull)
+		{
+			/* Tables built while tokens are scanned on demand start empty and grow in the arena */
+			Arena arena;
+			FlatAst ast;
+			ast.Reset(arena, 0);
+			FlatAst::NodeIndex sum = ast.AddLiteral(1);
+			for (int i = 2; i <= 100; i++)
+			{
+				sum = ast.AddBinary(FlatAst::OpCode::Addition, sum, ast.AddLiteral(i));
+			}
+			Assert::AreEqual(ast.getNodeCount(), size_t(199));
+			std::vector<int> values(ast.getNodeCount());
+			Assert::AreEqual(ast.Evaluate(values.data()), 5050);
+
+			std::string expression = "0";
+			for (int i = 1; i <= 100; i++)
+			{
+				expression += " + " + std::to_string(i);
+			}
+			RDParser parser;
+			Assert::AreEqual(parser.Compile(expression).Evaluate(), 5050);
+		}
+
+		TEST_METHOD(CompiledExpressionOutlivesParserState)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("4 + (12 / (1 * 2))");
+			Assert::AreEqual(parser.Parse("1 + 3"), 4);
+			Assert::AreEqual(compiled.Evaluate(), 10);
+			Assert::AreEqual(compiled.Evaluate(), 10);
+		}
+
+		TEST_METHOD(CompileReportsParseErrors)
+		{
+			RDParser parser;
+			auto function = [&parser] { parser.Compile("(1 + (12 * 2) "); };
+			Assert::ExpectException<ExpressionParserErrors::ParenthesesMismatchException>(function);
+		}
+
+		TEST_METHOD(CompiledDivideByZeroExceptsOnEvaluate)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("5 / (3 - 3)");
+			auto function = [&compiled] { compiled.Evaluate(); };
+			Assert::ExpectException<ExpressionParserErrors::DivideByZeroException>(function);
+		}
+
+		TEST_METHOD(VariablesBoundBySlot)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("rate * (hours - 2) + rate");
+			Assert::AreEqual(compiled.getVariableCount(), size_t(2));
+			Assert::AreEqual(compiled.getSlot("rate"), 0);
+			Assert::AreEqual(compiled.getSlot("hours"), 1);
+
+			int row[] = {3, 10};
+			Assert::AreEqual(compiled.Evaluate(row), 27);
+			row[1] = 4;
+			Assert::AreEqual(compiled.Evaluate(row), 9);
+		}
+
+		TEST_METHOD(VariablesResolvedAgainstFixedLayout)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("b - a", {"a", "b", "c"});
+			int row[] = {1, 5, 9};
+			Assert::AreEqual(compiled.Evaluate(row), 4);
+
+			auto function = [&parser] { parser.Compile("a + d", {"a", "b", "c"}); };
+			Assert::ExpectException<ExpressionParserErrors::UnknownVariableException>(function);
+		}
+
+		TEST_METHOD(UnboundVariableExcepts)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("x + y");
+			int row[] = {1};
+			auto function = [&compiled, &row] { compiled.Evaluate(row); };
+			Assert::ExpectException<ExpressionParserErrors::UnboundVariableException>(function);
+		}
+
+		TEST_METHOD(BytecodeLoweredToPostfix)
+		{
+			Arena arena;
+			FlatAst ast;
+			ast.Reset(arena, 4);
+			FlatAst::NodeIndex left = ast.AddVariable(0);
+			ast.AddBinary(FlatAst::OpCode::Subtraction, left, ast.AddUnary(ast.AddLiteral(3)));
+
+			Bytecode bytecode = Bytecode::Compile(ast);
+			Assert::AreEqual(bytecode.getInstructions().size(), size_t(4));
+			Assert::IsTrue(bytecode.getInstructions()[0].op == Bytecode::OpCode::PushVariable);
+			Assert::IsTrue(bytecode.getInstructions()[3].op == Bytecode::OpCode::Subtraction);
+			Assert::AreEqual(bytecode.getMaxStackDepth(), size_t(2));
+
+			int row[] = {10};
+			Assert::AreEqual(bytecode.Execute(row), 13);
+		}
+
+		TEST_METHOD(DeepRightNestingExceedsFixedStack)
+		{
+			std::string expression;
+			for (int i = 0; i < BYTECODE_STACK_SIZE * 2; i++)
+			{
+				expression += "1 - (";
+			}
+			expression += "1" + std::string(BYTECODE_STACK_SIZE * 2, ')');
+
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile(expression);
+			Assert::AreEqual(compiled.Evaluate(), parser.Parse(expression));
+		}
+
+		TEST_METHOD(BatchMatchesScalarEvaluation)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("(a * 3 - -b) / (a - 2) + 7");
+
+			const size_t rows = BATCH_BLOCK_SIZE * 3 + 17;
+			std::vector<int> a(rows), b(rows), results(rows);
+			std::vector<uint8_t> errors(rows);
+			for (size_t row = 0; row < rows; row++)
+			{
+				a[row] = static_cast<int>(row % 5);
+				b[row] = static_cast<int>(row) - 100;
+			}
+
+			const int *columns[] = {a.data(), b.data()};
+			size_t error_count = compiled.EvaluateBatch(columns, rows, results.data(), errors.data());
+
+			size_t expected_errors = 0;
+			for (size_t row = 0; row < rows; row++)
+			{
+				if (a[row] == 2)
+				{
+					expected_errors++;
+					Assert::AreEqual(errors[row], uint8_t(1));
+					continue;
+				}
+
+				int bindings[] = {a[row], b[row]};
+				Assert::AreEqual(errors[row], uint8_t(0));
+				Assert::AreEqual(results[row], compiled.Evaluate(bindings));
+			}
+			Assert::AreEqual(error_count, expected_errors);
+		}
+
+		TEST_METHOD(VectorKernelsMatchScalar)
+		{
+			const size_t count = 37;
+			std::vector<int> left(count), right(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				left[i] = static_cast<int>(i * 7919) - 100000;
+				right[i] = static_cast<int>(i % 9) - 4;
+			}
+
+			const BatchKernels &scalar = BatchKernels::Get(BatchKernels::InstructionSet::Scalar);
+			for (BatchKernels::InstructionSet instruction_set :
+				 {BatchKernels::InstructionSet::SSE42, BatchKernels::InstructionSet::AVX2})
+			{
+				if (!BatchKernels::IsSupported(instruction_set))
+				{
+					continue;
+				}
+
+				const BatchKernels &vector = BatchKernels::Get(instruction_set);
+				std::vector<int> expected(count), actual(count);
+				std::vector<uint8_t> expected_errors(count), actual_errors(count);
+
+				for (BatchKernels::BinaryKernel BatchKernels::*kernel :
+					 {&BatchKernels::add, &BatchKernels::subtract, &BatchKernels::multiply})
+				{
+					(scalar.*kernel)(left.data(), right.data(), expected.data(), count);
+					(vector.*kernel)(left.data(), right.data(), actual.data(), count);
+					Assert::IsTrue(expected == actual);
+				}
+
+				scalar.negate(left.data(), expected.data(), count);
+				vector.negate(left.data(), actual.data(), count);
+				Assert::IsTrue(expected == actual);
+
+				scalar.divide(left.data(), right.data(), expected.data(), expected_errors.data(), count);
+				vector.divide(left.data(), right.data(), actual.data(), actual_errors.data(), count);
+				Assert::IsTrue(expected == actual);
+				Assert::IsTrue(expected_errors == actual_errors);
+			}
+		}
+
+		TEST_METHOD(ConstantSubtreesFolded)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("seconds / (60 * 60 * 24)");
+			Assert::AreEqual(compiled.getNodeCount(), size_t(3));
+
+			int row[] = {172800};
+			Assert::AreEqual(compiled.Evaluate(row), 2);
+		}
+
+		TEST_METHOD(DoubleNegationAndIdentitiesRemoved)
+		{
+			RDParser parser;
+			Assert::AreEqual(parser.Compile("----5+---6*6").getNodeCount(), size_t(1));
+			Assert::AreEqual(parser.Compile("----5+---6*6").Evaluate(), -6);
+			Assert::AreEqual(parser.Compile("--x * 1 + 0").getNodeCount(), size_t(3));
+			Assert::AreEqual(parser.Compile("---x").getNodeCount(), size_t(4));
+
+			int row[] = {9};
+			Assert::AreEqual(parser.Compile("0 + (x - 0) / 1").Evaluate(row), 9);
+		}
+
+		TEST_METHOD(FoldedDivideByZeroReportedWhenRequested)
+		{
+			AstOptimiser::Options options;
+			options.report_divide_by_zero = true;
+			RDParser parser(options);
+			auto function = [&parser] { parser.Compile("x + 5 / (3 - 3)"); };
+			Assert::ExpectException<ExpressionParserErrors::DivideByZeroException>(function);
+		}
+
+		TEST_METHOD(OptimisationCanBeDisabled)
+		{
+			AstOptimiser::Options options;
+			options.fold_constants = false;
+			options.simplify_identities = false;
+			RDParser parser(options);
+			Assert::AreEqual(parser.Compile("--(2 * 3)").getNodeCount(), size_t(5));
+			Assert::AreEqual(parser.Compile("--(2 * 3)").Evaluate(), 6);
+		}
+
+		TEST_METHOD(TryParseReportsErrorsWithoutThrowing)
+		{
+			using ExpressionParserErrors::ErrorKind;
+			RDParser parser;
+
+			Result<int> result = parser.TryParse("1 + * 2");
+			Assert::IsFalse(result.hasValue());
+			Assert::IsTrue(result.getError().kind == ErrorKind::UnexpectedToken);
+			Assert::IsTrue(result.getError().token == "*");
+			Assert::AreEqual(result.getError().position, size_t(4));
+
+			Assert::IsTrue(parser.TryParse("(1 + 2").getError().kind == ErrorKind::ParenthesesMismatch);
+			Assert::IsTrue(parser.TryParse("1 + 2)").getError().kind == ErrorKind::UnexpectedParentheses);
+			Assert::IsTrue(parser.TryParse("   ").getError().kind == ErrorKind::EmptyExpression);
+			Assert::IsTrue(parser.TryParse("4 / (2 - 2)").getError().kind == ErrorKind::DivideByZero);
+			Assert::IsTrue(parser.TryCompile("x + y", {"x"}).getError().kind == ErrorKind::UnknownVariable);
+
+			result = parser.TryParse("(1 + 2) * 3");
+			Assert::IsTrue(result.hasValue());
+			Assert::AreEqual(result.getValue(), 9);
+			Assert::IsTrue(result.getError().kind == ErrorKind::None);
+		}
+
+		TEST_METHOD(ErrorMessageMatchesThrownException)
+		{
+			RDParser parser;
+			const std::string expression = "1 + a $ 2";
+			ExpressionParserErrors::ErrorInfo error = parser.TryParse(expression).getError();
+			Assert::IsTrue(error.kind == ExpressionParserErrors::ErrorKind::InvalidToken);
+			Assert::AreEqual(error.position, size_t(4));
+			Assert::AreEqual(error.count, size_t(2));
+
+			try
+			{
+				parser.Parse(expression);
+				Assert::Fail();
+			}
+			catch (const ExpressionParserErrors::InvalidTokenException &exception)
+			{
+				Assert::AreEqual(error.Message(), std::string(exception.what()));
+				Assert::IsTrue(exception.getPositions() == std::vector<size_t>({4, 6}));
+			}
+
+			CompiledExpression compiled = parser.Compile("a / b");
+			int row[] = {1, 0};
+			Assert::IsTrue(compiled.TryEvaluate(row).getError().kind == ExpressionParserErrors::ErrorKind::DivideByZero);
+			Assert::AreEqual(compiled.TryEvaluate(row).getError().Message(), std::string("RDParser:: Division by zero"));
+			auto function = [&compiled] { compiled.TryEvaluate().getValue(); };
+			Assert::ExpectException<ExpressionParserErrors::UnboundVariableException>(function);
+		}
+
+		TEST_METHOD(SharedParserUsedAcrossThreads)
+		{
+			const RDParser parser;
+			const CompiledExpression shared = parser.Compile("a * 2 - b");
+			std::vector<int> failures(8, 0);
+
+			std::vector<std::thread> workers;
+			for (int worker = 0; worker < 8; worker++)
+			{
+				workers.emplace_back([&parser, &shared, &failures, worker] {
+					for (int i = 0; i < 2000; i++)
+					{
+						const std::string expression = std::to_string(worker) + " + " + std::to_string(i) + " * 2";
+						const int row[] = {i, worker};
+						if (parser.Parse(expression) != (worker + i) * 2 || shared.Evaluate(row) != i * 2 - worker ||
+							parser.TryParse("1 + * 2").hasValue())
+						{
+							failures[worker]++;
+						}
+					}
+				});
+			}
+
+			for (std::thread &worker : workers)
+			{
+				worker.join();
+			}
+
+			Assert::IsTrue(failures == std::vector<int>(8, 0));
+		}
+
+		TEST_METHOD(ParallelEngineMatchesBatchEvaluation)
+		{
+			RDParser parser;
+			CompiledExpression quotient = parser.Compile("(a * 3 - -b) / (a - 2) + 7", {"a", "b"});
+			CompiledExpression product = parser.Compile("b * a", {"a", "b"});
+
+			const size_t rows = 10000;
+			std::vector<int> a(rows), b(rows);
+			for (size_t row = 0; row < rows; row++)
+			{
+				a[row] = static_cast<int>(row % 5);
+				b[row] = static_cast<int>(row) - 100;
+			}
+			const int *columns[] = {a.data(), b.data()};
+
+			BatchEngine engine(3, 64);
+			const size_t chunks = engine.getChunkCount(rows);
+			std::vector<int> quotients(rows), products(rows), expected(rows);
+			std::vector<uint8_t> quotient_errors(rows), product_errors(rows), expected_errors(rows);
+			std::vector<size_t> chunk_errors(chunks);
+			BatchEngine::Job jobs[] = {
+				{&quotient, columns, rows, quotients.data(), quotient_errors.data(), chunk_errors.data()},
+				{&product, columns, rows, products.data(), product_errors.data(), nullptr}};
+
+			Assert::AreEqual(engine.Run(jobs), size_t(2000));
+			Assert::AreEqual(engine.Run(jobs), size_t(2000));
+
+			quotient.EvaluateBatch(columns, rows, expected.data(), expected_errors.data());
+			Assert::IsTrue(quotients == expected);
+			Assert::IsTrue(quotient_errors == expected_errors);
+			product.EvaluateBatch(columns, rows, expected.data(), expected_errors.data());
+			Assert::IsTrue(products == expected);
+			Assert::IsTrue(product_errors == expected_errors);
+
+			for (size_t chunk = 0; chunk < chunks; chunk++)
+			{
+				const size_t chunk_rows = std::min<size_t>(64, rows - chunk * 64);
+				const size_t flagged = std::count(quotient_errors.begin() + chunk * 64,
+												  quotient_errors.begin() + chunk * 64 + chunk_rows, uint8_t(1));
+				Assert::AreEqual(chunk_errors[chunk], flagged);
+			}
+		}
+
+		TEST_METHOD(CacheSharesEntriesAcrossSpacing)
+		{
+			std::string key;
+			ExpressionCache::Normalise("  12 +  ( ab  3 )* -c ", key);
+			Assert::AreEqual(key, std::string("12+(ab 3)*-c"));
+
+			ExpressionCache cache;
+			int row[] = {3, 4};
+			Assert::AreEqual(cache.Get("x * 2 + y").getValue().Evaluate(row), 10);
+			Assert::AreEqual(cache.Get("x*2+y").getValue().Evaluate(row), 10);
+			Assert::IsTrue(cache.Get("1 2").getError().kind == ExpressionParserErrors::ErrorKind::UnexpectedParentheses);
+
+			/* A repeated malformed expression is served from the cache, with positions in the caller's spelling */
+			const std::string spaced = "1 +   * 2";
+			Result<CompiledExpression> first = cache.Get("1+*2");
+			Result<CompiledExpression> second = cache.Get(spaced);
+			Assert::AreEqual(first.getError().position, size_t(2));
+			Assert::AreEqual(second.getError().position, size_t(6));
+			Assert::IsTrue(second.getError().token == "*");
+			Assert::AreEqual(second.getError().Message(),
+							 std::string("RDParser:: Unexpected token encountered: * at column 7"));
+
+			ExpressionCache::Statistics statistics = cache.getStatistics();
+			Assert::AreEqual(statistics.hits, size_t(2));
+			Assert::AreEqual(statistics.misses, size_t(3));
+			Assert::AreEqual(statistics.entries, size_t(3));
+		}
+
+		TEST_METHOD(CacheEvictsLeastRecentlyUsed)
+		{
+			ExpressionCache cache(4096, RDParser(), 1);
+			for (int i = 0; i < 200; i++)
+			{
+				Assert::AreEqual(cache.Get(std::to_string(i) + " + 1").getValue().Evaluate(), i + 1);
+				cache.Get("0");
+			}
+
+			ExpressionCache::Statistics statistics = cache.getStatistics();
+			Assert::IsTrue(statistics.evictions > 0);
+			Assert::IsTrue(statistics.memory_usage <= 4096);
+			Assert::AreEqual(statistics.entries + statistics.evictions, size_t(201));
+
+			/* The expression used on every iteration was never the least recently used */
+			const size_t misses = statistics.misses;
+			cache.Get("0");
+			Assert::AreEqual(cache.getStatistics().misses, misses);
+		}
+
+		TEST_METHOD(StreamedChunksMatchWholeExpression)
+		{
+			RDParser parser;
+			StreamingParser streaming;
+			const std::string expression = "12 * -(34 + 5) / 3 - (7)";
+			for (size_t chunk_size = 1; chunk_size <= expression.size(); chunk_size++)
+			{
+				streaming.Reset();
+				for (size_t offset = 0; offset < expression.size(); offset += chunk_size)
+				{
+					streaming.Push(std::string_view(expression).substr(offset, chunk_size));
+				}
+				Assert::AreEqual(streaming.Finish().getValue(), parser.Parse(expression));
+			}
+
+			/* A literal split across chunks is carried over */
+			streaming.Reset();
+			streaming.Push("1");
+			streaming.Push("23");
+			streaming.Push("4 * (2");
+			Assert::AreEqual(streaming.getDepth(), size_t(1));
+			streaming.Push(")");
+			Assert::AreEqual(streaming.Finish().getValue(), 2468);
+
+			streaming.Reset();
+			streaming.Push("1 + (2 * ");
+			streaming.Push(") / 0");
+			Result<int> result = streaming.Finish();
+			Assert::IsTrue(result.getError().kind == ExpressionParserErrors::ErrorKind::UnexpectedToken);
+			Assert::AreEqual(result.getError().Message(),
+							 std::string("RDParser:: Unexpected token encountered: ) at column 10"));
+
+			streaming.Reset();
+			streaming.Push("(1 + 2");
+			Assert::IsTrue(streaming.Finish().getError().kind == ExpressionParserErrors::ErrorKind::ParenthesesMismatch);
+
+			auto function = [&streaming] {
+				streaming.Reset();
+				streaming.Push("4 / (2 - 2");
+				streaming.Push(")");
+				streaming.Finish().getValue();
+			};
+			Assert::ExpectException<ExpressionParserErrors::DivideByZeroException>(function);
+		}
+
+		TEST_METHOD(BulkOutputKeptInInputOrder)
+		{
+			/* Tiny blocks spread the lines over many blocks, which four threads finish out of order */
+			std::string input;
+			std::string expected_text;
+			std::vector<int32_t> expected_records;
+			for (int line = 0; line < 200; line++)
+			{
+				input += std::to_string(line) + " * 2 - 1" + (line % 3 == 0 ? "\r\n" : "\n");
+				expected_text += std::to_string(line * 2 - 1) + "\n";
+				expected_records.push_back(line * 2 - 1);
+			}
+
+			BulkEvaluator::Options options;
+			options.thread_count = 4;
+			options.block_size = 16;
+			std::FILE *output = std::tmpfile();
+			std::FILE *errors = std::tmpfile();
+			Assert::AreEqual(BulkEvaluator(options).Run(input, output, errors), size_t(0));
+			Assert::AreEqual(readFile(output), expected_text);
+			Assert::AreEqual(readFile(errors), std::string());
+			std::fclose(output);
+			std::fclose(errors);
+
+			options.format = BulkEvaluator::OutputFormat::Binary;
+			output = std::tmpfile();
+			errors = std::tmpfile();
+			Assert::AreEqual(BulkEvaluator(options).Run(input, output, errors), size_t(0));
+			const std::string records = readFile(output);
+			Assert::AreEqual(records.size(), expected_records.size() * sizeof(int32_t));
+			Assert::IsTrue(std::memcmp(records.data(), expected_records.data(), records.size()) == 0);
+			std::fclose(output);
+			std::fclose(errors);
+		}
+
+		TEST_METHOD(BulkErrorsReportedByLine)
+		{
+			/* The final line has no newline, and the CRLF line's '\r' is not part of its expression */
+			const std::string input = "1 + 2\r\n(1 + 2\n\n4 / 0\r\n5 * 5";
+			RDParser parser;
+			const std::string mismatch = parser.TryParse("(1 + 2").getError().Message();
+			const std::string empty = parser.TryParse("").getError().Message();
+			const std::string divide_by_zero = parser.TryParse("4 / 0").getError().Message();
+
+			BulkEvaluator::Options options;
+			options.thread_count = 2;
+			options.block_size = 4;
+			std::FILE *output = std::tmpfile();
+			std::FILE *errors = std::tmpfile();
+			Assert::AreEqual(BulkEvaluator(options).Run(input, output, errors), size_t(3));
+			Assert::AreEqual(readFile(output), "3\nerror: " + mismatch + "\nerror: " + empty + "\nerror: " + divide_by_zero + "\n25\n");
+			Assert::AreEqual(readFile(errors), std::string());
+			std::fclose(output);
+			std::fclose(errors);
+
+			/* Binary output writes 0 for failed lines and reports them on the error stream */
+			options.format = BulkEvaluator::OutputFormat::Binary;
+			output = std::tmpfile();
+			errors = std::tmpfile();
+			Assert::AreEqual(BulkEvaluator(options).Run(input, output, errors), size_t(3));
+			const int32_t expected_records[] = {3, 0, 0, 0, 25};
+			const std::string records = readFile(output);
+			Assert::AreEqual(records.size(), sizeof(expected_records));
+			Assert::IsTrue(std::memcmp(records.data(), expected_records, records.size()) == 0);
+			Assert::AreEqual(readFile(errors), "line 2: " + mismatch + "\nline 3: " + empty + "\nline 4: " + divide_by_zero + "\n");
+			std::fclose(output);
+			std::fclose(errors);
+		}
+
+		TEST_METHOD(MappedFileRoundTrip)
+		{
+			const std::filesystem::path path = std::filesystem::temp_directory_path() / "expression_parser_mapped_file.txt";
+			const std::string contents = "1 + 2\n3 * 4\n";
+			std::ofstream(path, std::ios::binary) << contents;
+			{
+				MappedFile file(path.string());
+				Assert::AreEqual(std::string(file.getContents()), contents);
+			}
+
+			/* An empty file cannot be mapped, but is still viewed as empty */
+			std::ofstream(path, std::ios::binary | std::ios::trunc).close();
+			{
+				MappedFile file(path.string());
+				Assert::AreEqual(file.getContents().size(), size_t(0));
+			}
+			std::filesystem::remove(path);
+		}
+
+		TEST_METHOD(IterativeParserMatchesRecursiveParser)
+		{
+			RDParser recursive;
+			IterativeParser iterative;
+			const char *expressions[] = {"5+6*6", "--(1 - 3) * -4", "((2))/(1+1)", "(1 + 2", "1 + 2)", "(1 + 2))", "1 + * 2", "1 -", "()", "4 / (2 - 2)", "1 + 3 + test"};
+			for (const char *expression : expressions)
+			{
+				Result<int> expected = recursive.TryParse(expression);
+				Result<int> actual = iterative.TryParse(expression);
+				Assert::AreEqual(expected.hasValue(), actual.hasValue());
+				Assert::IsTrue(expected.getError().kind == actual.getError().kind);
+				Assert::AreEqual(expected.getError().position, actual.getError().position);
+				Assert::AreEqual(expected.getError().Message(), actual.getError().Message());
+				if (expected)
+				{
+					Assert::AreEqual(expected.getValue(), actual.getValue());
+				}
+			}
+
+			CompiledExpression compiled = iterative.Compile("-(x + y) * x", {"y", "x"});
+			Assert::AreEqual(compiled.getNodeCount(), recursive.Compile("-(x + y) * x", {"y", "x"}).getNodeCount());
+			int row[] = {2, 3};
+			Assert::AreEqual(compiled.Evaluate(row), -15);
+		}
+
+		TEST_METHOD(IterativeParserHandlesDeepNesting)
+		{
+			IterativeParser::Options options;
+			options.max_depth = 100000;
+			IterativeParser parser(options);
+
+			const std::string nested = std::string(100000, '(') + "7" + std::string(100000, ')');
+			Assert::AreEqual(parser.Parse(nested), 7);
+			Assert::AreEqual(parser.Parse(std::string(100001, '-') + "7"), -7);
+
+			options.max_depth = 3;
+			IterativeParser shallow(options);
+			Assert::AreEqual(shallow.Parse("(((1)))"), 1);
+			Result<int> result = shallow.TryParse("(((( 1))))");
+			Assert::IsTrue(result.getError().kind == ExpressionParserErrors::ErrorKind::NestingTooDeep);
+			Assert::AreEqual(result.getError().position, size_t(3));
+			auto function = [&shallow] { shallow.Parse("((((1))))"); };
+			Assert::ExpectException<ExpressionParserErrors::NestingTooDeepException>(function);
+		}
+
+		TEST_METHOD(CheckedEvaluationReportsOverflow)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("a * b + 1");
+			int32_t narrow_row[] = {65536, 32768};
+			Result<int32_t> narrow = compiled.TryEvaluateAs<int32_t, true>(narrow_row);
+			Assert::IsTrue(narrow.getError().kind == ExpressionParserErrors::ErrorKind::Overflow);
+			auto function = [&compiled, &narrow_row] { compiled.EvaluateAs<int32_t, true>(narrow_row); };
+			Assert::ExpectException<ExpressionParserErrors::OverflowException>(function);
+
+			int32_t fitting_row[] = {-65536, 32768};
+			Assert::AreEqual(compiled.EvaluateAs<int32_t, true>(fitting_row), -2147483647);
+
+			int64_t wide_row[] = {65536, 32768};
+			Assert::AreEqual(compiled.EvaluateAs<int64_t, true>(wide_row), int64_t(2147483649));
+
+			/* Constants that overflow int are not folded, so they are computed at the evaluation's width */
+			CompiledExpression constant = parser.Compile("2147483647 + 1");
+			Assert::AreEqual(constant.EvaluateAs<int64_t>(), int64_t(2147483648));
+			Assert::IsTrue(constant.TryEvaluateAs<int32_t, true>().getError().kind == ExpressionParserErrors::ErrorKind::Overflow);
+
+			int32_t minimum_row[] = {-2147483647 - 1, 1};
+			CompiledExpression quotient = parser.Compile("a / -b");
+			Assert::IsTrue(quotient.TryEvaluateAs<int32_t, true>(minimum_row).getError().kind == ExpressionParserErrors::ErrorKind::Overflow);
+
+			/* A double negation of a variable is not cancelled, as its inner negation may overflow */
+			CompiledExpression double_negation = parser.Compile("--a");
+			Assert::IsTrue(double_negation.TryEvaluateAs<int32_t, true>(minimum_row).getError().kind == ExpressionParserErrors::ErrorKind::Overflow);
+			Assert::AreEqual(double_negation.Evaluate(minimum_row), -2147483647 - 1);
+		}
+
+		TEST_METHOD(ConstantParserEvaluatesAtCompileTime)
+		{
+			static_assert(ConstantParser::Evaluate("4 + (12 / (1 * 2))") == 10);
+			constexpr int value = ConstantParser::Parse("--(3 - 5) * -2");
+			Assert::AreEqual(value, 4);
+
+			RDParser parser;
+			const char *expressions[] = {"5+6*6", "(1 + 2", "1 + 2)", "1 + * 2", "1 -", "4 / (2 - 2)", "1 + 3 + test", "", "99999999999"};
+			for (const char *expression : expressions)
+			{
+				Result<int> expected = parser.TryParse(expression);
+				ExpressionParserErrors::ErrorInfo error;
+				int result = 0;
+				Assert::AreEqual(expected.hasValue(), ConstantParser::TryParse(expression, result, error));
+				Assert::IsTrue(expected.getError().kind == error.kind);
+				Assert::AreEqual(expected.getError().Message(), error.Message());
+				if (expected)
+				{
+					Assert::AreEqual(expected.getValue(), result);
+				}
+			}
+
+			auto function = [] { ConstantParser::Parse("(1 + 2"); };
+			Assert::ExpectException<ExpressionParserErrors::ParenthesesMismatchException>(function);
+		}
+
+		TEST_METHOD(HotCacheEntriesRunNativeCode)
+		{
+			ExpressionCache cache(EXPRESSION_CACHE_DEFAULT_BUDGET, RDParser(), 1, 3);
+			for (int lookup = 0; lookup < 3; lookup++)
+			{
+				Assert::IsFalse(cache.Get("a / b - 1").getValue().isNative());
+			}
+
+			CompiledExpression hot = cache.Get("a / b - 1").getValue();
+			Assert::AreEqual(hot.isNative(), NativeCode::isSupported());
+			Assert::AreEqual(cache.getStatistics().native_compilations, size_t(NativeCode::isSupported() ? 1 : 0));
+
+			int row[] = {-7, 2};
+			Assert::AreEqual(hot.Evaluate(row), -4);
+			row[1] = -1;
+			Assert::AreEqual(hot.Evaluate(row), 6);
+			row[1] = 0;
+			auto function = [&hot, &row] { hot.Evaluate(row); };
+			Assert::ExpectException<ExpressionParserErrors::DivideByZeroException>(function);
+		}
+
+		TEST_METHOD(FusedLexingMatchesTokenisingFirst)
+		{
+			RDParser fused;
+			RDParser::Options options;
+			options.tokenise_first = true;
+			RDParser tokenising(options);
+
+			/* Invalid characters and out of range literals are lexical errors and are reported ahead of parse errors */
+			const char *expressions[] = {"5+6*6", "--(1 - 3) * -4", "(1 + 2", "1 + 2)", "1 + * 2", "1 -", "()", "", "   ", "4 / (2 - 2)", "1 + ) # 2", "(1 + 99999999999", "1 + * 99999999999", "3 % 99999999999"};
+			for (const char *expression : expressions)
+			{
+				Result<int> expected = tokenising.TryParse(expression);
+				Result<int> actual = fused.TryParse(expression);
+				Assert::AreEqual(expected.hasValue(), actual.hasValue());
+				Assert::IsTrue(expected.getError().kind == actual.getError().kind);
+				Assert::AreEqual(expected.getError().position, actual.getError().position);
+				Assert::AreEqual(expected.getError().Message(), actual.getError().Message());
+				if (expected)
+				{
+					Assert::AreEqual(expected.getValue(), actual.getValue());
+				}
+			}
+
+			Result<int> invalid = fused.TryParse("1 + ) # 2");
+			Assert::IsTrue(invalid.getError().kind == ExpressionParserErrors::ErrorKind::InvalidToken);
+			Assert::AreEqual(invalid.getError().position, size_t(6));
+
+			CompiledExpression compiled = fused.Compile("-(x + y) * x");
+			Assert::AreEqual(compiled.getNodeCount(), tokenising.Compile("-(x + y) * x").getNodeCount());
+			int row[] = {3, 2};
+			Assert::AreEqual(compiled.Evaluate(row), -15);
+		}
+
+		TEST_METHOD(DirectEvaluationMatchesNodeTable)
+		{
+			RDParser direct;
+			RDParser::Options options;
+			options.evaluate_directly = false;
+			RDParser tabled(options);
+
+			/* Division by zero is only reported once the whole expression has parsed, and stops any later division */
+			const char *expressions[] = {"5+6*6", "--(1 - 3) * -4", "---7", "((2))/(1+1)", "4 / (2 - 2)", "1 / 0 + )", "(1 / 0", "1 / 0 / 0", "(1 / 0) + (0 - 2147483647 - 1) / -1", "1 -", "()", "1 # 2"};
+			for (const char *expression : expressions)
+			{
+				Result<int> expected = tabled.TryParse(expression);
+				Result<int> actual = direct.TryParse(expression);
+				Assert::AreEqual(expected.hasValue(), actual.hasValue());
+				Assert::IsTrue(expected.getError().kind == actual.getError().kind);
+				Assert::AreEqual(expected.getError().position, actual.getError().position);
+				Assert::AreEqual(expected.getError().Message(), actual.getError().Message());
+				if (expected)
+				{
+					Assert::AreEqual(expected.getValue(), actual.getValue());
+				}
+			}
+
+			Assert::IsTrue(direct.TryParse("(1 / 0").getError().kind == ExpressionParserErrors::ErrorKind::ParenthesesMismatch);
+			Assert::AreEqual(direct.Parse("5+6*6"), 66);
+		}
+
+		TEST_METHOD(InstrumentationCountsCalls)
+		{
+			RDParser parser;
+			const Instrumentation::Statistics before = Instrumentation::Snapshot();
+			Assert::AreEqual(parser.Parse("1 + 2"), 3);
+			Assert::AreEqual(parser.Parse("-(-(4))"), 4);
+			Assert::IsTrue(parser.TryParse("4 / 0").getError().kind == ExpressionParserErrors::ErrorKind::DivideByZero);
+			Assert::IsTrue(parser.TryParse("1 # 2").getError().kind == ExpressionParserErrors::ErrorKind::InvalidToken);
+			const Instrumentation::Statistics after = Instrumentation::Snapshot();
+
+			if (!Instrumentation::enabled)
+			{
+				Assert::AreEqual(after.calls, size_t(0));
+				Assert::AreEqual(after.tokens, size_t(0));
+				Assert::AreEqual(after.getErrorCount(ExpressionParserErrors::ErrorKind::DivideByZero), size_t(0));
+				return;
+			}
+
+			Assert::AreEqual(after.calls - before.calls, size_t(4));
+			Assert::IsTrue(after.tokens - before.tokens >= size_t(3 + 7 + 3));
+			Assert::IsTrue(after.nodes - before.nodes >= size_t(3 + 3 + 3));
+			Assert::IsTrue(after.max_depth >= size_t(4));
+			Assert::AreEqual(after.getErrorCount(ExpressionParserErrors::ErrorKind::DivideByZero) - before.getErrorCount(ExpressionParserErrors::ErrorKind::DivideByZero), size_t(1));
+			Assert::AreEqual(after.getErrorCount(ExpressionParserErrors::ErrorKind::InvalidToken) - before.getErrorCount(ExpressionParserErrors::ErrorKind::InvalidToken), size_t(1));
+			Assert::IsTrue(after.timed_calls >= before.timed_calls);
+		}
+
+		TEST_METHOD(CatalogueRoundTripsCompiledExpressions)
+		{
+			RDParser parser;
+			const char *expressions[] = {"5+6*6", "-(x + y) * x", "price * quantity - discount", "x / (y - y)"};
+			ExpressionCatalogue::Builder builder;
+			for (const char *expression : expressions)
+			{
+				builder.Add(expression, parser.Compile(expression));
+			}
+
+			const std::string image = builder.Serialise();
+			ExpressionCatalogue catalogue(image);
+			Assert::AreEqual(catalogue.getExpressionCount(), size_t(4));
+
+			Assert::AreEqual(catalogue[0].Evaluate(), 66);
+			Assert::AreEqual(std::string(catalogue[1].getExpression()), std::string("-(x + y) * x"));
+			int row[] = {3, 2};
+			Assert::AreEqual(catalogue[1].Evaluate(row), parser.Compile("-(x + y) * x").Evaluate(row));
+			Assert::AreEqual(catalogue[2].getSlot("discount"), 2);
+			Assert::AreEqual(std::string(catalogue[2].getVariableName(1)), std::string("quantity"));
+			int order[] = {4, 5, 6};
+			Assert::AreEqual(catalogue[2].Evaluate(order), 14);
+			Assert::IsTrue(catalogue[2].TryEvaluate(row).getError().kind == ExpressionParserErrors::ErrorKind::UnboundVariable);
+			Assert::IsTrue(catalogue[3].TryEvaluate(row).getError().kind == ExpressionParserErrors::ErrorKind::DivideByZero);
+			int64_t wide[] = {2147483647, 2};
+			Assert::AreEqual(catalogue[1].TryEvaluateAs<int64_t>(wide).getValue(), -int64_t(2147483649) * 2147483647);
+
+			/* Truncated, corrupted and mismatched images are rejected when loaded */
+			Assert::ExpectException<ExpressionParserErrors::CatalogueFormatException>([&]() { ExpressionCatalogue(std::string_view(image).substr(0, image.size() - 1)); });
+			std::string version = image;
+			version[8] = CATALOGUE_FORMAT_VERSION + 1;
+			Assert::ExpectException<ExpressionParserErrors::CatalogueFormatException>([&]() { ExpressionCatalogue{version}; });
+			std::string opcode = image;
+			opcode[32 + 4 * 32 + 5 * 8] = 0x7f;
+			Assert::ExpectException<ExpressionParserErrors::CatalogueFormatException>([&]() { ExpressionCatalogue{opcode}; });
+		}
+
+		TEST_METHOD(CatalogueExpressionOutlivesCatalogue)
+		{
+			RDParser parser;
+			ExpressionCatalogue::Builder builder;
+			builder.Add("a * b - 1", parser.Compile("a * b - 1"));
+			const std::filesystem::path path = std::filesystem::temp_directory_path() / "expression_parser_catalogue.bin";
+			builder.Write(path.string());
+
+			/* The expression keeps the mapped file open after the catalogue it came from is destroyed */
+			{
+				const ExpressionCatalogue::Expression expression = ExpressionCatalogue::Open(path.string())[0];
+				int row[] = {6, 7};
+				Assert::AreEqual(expression.Evaluate(row), 41);
+				Assert::AreEqual(std::string(expression.getVariableName(1)), std::string("b"));
+				Assert::AreEqual(std::string(expression.getExpression()), std::string("a * b - 1"));
+			}
+			std::filesystem::remove(path);
+		}
+
+		TEST_METHOD(ExpressionDagSharesSubexpressions)
+		{
+			RDParser parser;
+			const char *expressions[] = {"(a - b) * c + 1", "2 * ((a - b) * c)", "-((a - b) * c) / d", "c * (a - b) + 1"};
+			ExpressionDag dag;
+			for (const char *expression : expressions)
+			{
+				dag.Add(parser.Compile(expression));
+			}
+
+			/* The shared term is stored once, and c * (a - b) + 1 is the first expression with its operands swapped */
+			Assert::AreEqual(dag.getRootCount(), size_t(4));
+			Assert::AreEqual(dag.getSourceNodeCount(), size_t(7 + 7 + 8 + 7));
+			Assert::AreEqual(dag.getNodeCount(), size_t(12));
+			Assert::AreEqual(dag.getVariableCount(), size_t(4));
+
+			int bindings[4];
+			bindings[dag.getSlot("a")] = 7;
+			bindings[dag.getSlot("b")] = 3;
+			bindings[dag.getSlot("c")] = 5;
+			bindings[dag.getSlot("d")] = 0;
+			int results[4];
+			uint8_t error_mask[4];
+			Assert::AreEqual(dag.Evaluate(bindings, results, error_mask), size_t(1));
+			Assert::AreEqual(results[0], 21);
+			Assert::AreEqual(results[1], 40);
+			Assert::AreEqual(int(error_mask[2]), 1);
+			Assert::AreEqual(results[2], 0);
+			Assert::AreEqual(results[3], 21);
+
+			bindings[dag.getSlot("d")] = 4;
+			Assert::AreEqual(dag.Evaluate(bindings, results, error_mask), size_t(0));
+			Assert::AreEqual(results[2], -5);
+			Assert::ExpectException<ExpressionParserErrors::UnboundVariableException>([&]() { dag.Evaluate(std::span<const int>(bindings, 3), results, error_mask); });
+		}
+
+		TEST_METHOD(IncrementalEvaluatorRecomputesDirtyPath)
+		{
+			RDParser parser;
+			CompiledExpression compiled = parser.Compile("((a + b) * (c - d)) + ((e * f) / (g - h))");
+			int bindings[] = {1, 2, 3, 4, 5, 6, 9, 7};
+			IncrementalEvaluator evaluator(compiled, bindings);
+			Assert::AreEqual(evaluator.getValue(), compiled.Evaluate(bindings));
+
+			/* Only h, g - h, the division and the root depend on h */
+			bindings[7] = 6;
+			Assert::AreEqual(evaluator.Update(size_t(compiled.getSlot("h")), 6), size_t(4));
+			Assert::AreEqual(evaluator.getValue(), compiled.Evaluate(bindings));
+
+			/* Once e is zero, changing f leaves e * f as it was, so the update stops there */
+			bindings[4] = 0;
+			bindings[5] = 9;
+			evaluator.Update(size_t(compiled.getSlot("e")), 0);
+			Assert::AreEqual(evaluator.Update(size_t(compiled.getSlot("f")), 9), size_t(2));
+			Assert::AreEqual(evaluator.getBinding(size_t(compiled.getSlot("f"))), 9);
+			Assert::AreEqual(evaluator.getValue(), compiled.Evaluate(bindings));
+			Assert::AreEqual(evaluator.Update(size_t(compiled.getSlot("f")), 9), size_t(0));
+
+			/* Division by zero is reported until the divisor changes again */
+			evaluator.Update(size_t(compiled.getSlot("g")), 6);
+			Assert::IsTrue(evaluator.TryGetValue().getError().kind == ExpressionParserErrors::ErrorKind::DivideByZero);
+			evaluator.Update(size_t(compiled.getSlot("h")), 1);
+			bindings[6] = 6;
+			bindings[7] = 1;
+			Assert::AreEqual(evaluator.getValue(), compiled.Evaluate(bindings));
+		}
+
+		TEST_METHOD(DividingMinimumByMinusOneNegates)
+		{
+			/* The quotient does not fit an int, so it wraps to the dividend instead of trapping, on every engine */
+			const int minimum = -2147483647 - 1;
+			const char *expression = "(0 - 2147483647 - 1) / -1";
+			RDParser direct;
+			RDParser::Options options;
+			options.evaluate_directly = false;
+			RDParser tabled(options);
+			Assert::AreEqual(direct.Parse(expression), minimum);
+			Assert::AreEqual(tabled.Parse(expression), minimum);
+			Assert::AreEqual(IterativeParser().Parse(expression), minimum);
+			Assert::AreEqual(ConstantParser::Parse(expression), minimum);
+			static_assert(ConstantParser::Evaluate("(0 - 2147483647 - 1) / -1") == -2147483647 - 1);
+
+			StreamingParser streaming;
+			streaming.Push(expression);
+			Assert::AreEqual(streaming.Finish().getValue(), minimum);
+
+			CompiledExpression compiled = tabled.Compile("a / b");
+			int row[] = {minimum, -1};
+			Assert::AreEqual(compiled.Evaluate(row), minimum);
+			int64_t wide_row[] = {minimum, -1};
+			Assert::AreEqual(compiled.EvaluateAs<int64_t>(wide_row), int64_t(2147483648));
+			Assert::IsTrue(compiled.TryEvaluateAs<int32_t, true>(row).getError().kind == ExpressionParserErrors::ErrorKind::Overflow);
+
+			const size_t rows = 3;
+			int left[rows] = {minimum, 7, minimum};
+			int right[rows] = {-1, -1, 2};
+			const int *columns[] = {left, right};
+			int results[rows];
+			uint8_t errors[rows];
+			Assert::AreEqual(compiled.EvaluateBatch(columns, rows, results, errors), size_t(0));
+			Assert::AreEqual(results[0], minimum);
+			Assert::AreEqual(results[1], -7);
+			Assert::AreEqual(results[2], minimum / 2);
+		}
+
+		TEST_METHOD(InvalidTokenLimitStopsLexing)
+		{
+			const std::string expression = "1 + a * (b $ c) - d";
+			RDParser unlimited;
+			ExpressionParserErrors::ErrorInfo full = unlimited.TryParse(expression).getError();
+			Assert::AreEqual(full.count, size_t(5));
+			Assert::IsFalse(full.truncated);
+			Assert::AreEqual(full.Message(), std::string("Lexer:: Invalid token(s) detected in expression : a,b,$,c,d,"));
+
+			/* Every engine stops at the limit, reporting the same first character as a full scan */
+			RDParser::Options options;
+			options.invalid_token_limit = 2;
+			RDParser::Options tokenising_options = options;
+			tokenising_options.tokenise_first = true;
+			IterativeParser::Options iterative_options;
+			iterative_options.invalid_token_limit = 2;
+			const Result<int> results[] = {RDParser(options).TryParse(expression),
+				RDParser(tokenising_options).TryParse(expression), IterativeParser(iterative_options).TryParse(expression)};
+			for (const Result<int> &result : results)
+			{
+				Assert::IsTrue(result.getError().kind == ExpressionParserErrors::ErrorKind::InvalidToken);
+				Assert::AreEqual(result.getError().position, full.position);
+				Assert::AreEqual(result.getError().count, size_t(2));
+				Assert::IsTrue(result.getError().truncated);
+				Assert::AreEqual(result.getError().Message(), std::string("Lexer:: Invalid token(s) detected in expression : a,b,..."));
+			}
+
+			try
+			{
+				RDParser(options).Parse(expression);
+				Assert::Fail();
+			}
+			catch (const ExpressionParserErrors::InvalidTokenException &exception)
+			{
+				Assert::IsTrue(exception.getPositions() == std::vector<size_t>({4, 9}));
+				Assert::IsTrue(exception.isTruncated());
+				Assert::AreEqual(std::string(exception.what()), results[0].getError().Message());
+			}
+
+			/* Reaching the limit on the last character scans the whole expression, so nothing is left out */
+			Assert::IsFalse(RDParser(options).TryParse("1 + a b").getError().truncated);
+			Assert::IsTrue(RDParser(options).TryCompile("1 + $ $ $").getError().truncated);
+
+			const std::string garbage(1024 * 1024, '#');
+			ExpressionParserErrors::ErrorInfo rejected = RDParser(options).TryParse(garbage).getError();
+			Assert::AreEqual(rejected.count, size_t(2));
+			Assert::IsTrue(rejected.truncated);
+		}
+
+		TEST_METHOD(EvaluationServiceBatchesRequests)
+		{
+			/* The latency limit is long enough that only full batches are dispatched */
+			EvaluationService::Options options;
+			options.batch_size = 4;
+			options.max_latency = std::chrono::seconds(30);
+			options.thread_count = 2;
+			std::vector<std::future<int>> futures;
+			int callback_value = 0;
+			ExpressionParserErrors::ErrorKind callback_error = ExpressionParserErrors::ErrorKind::None;
+			{
+				EvaluationService service(options);
+				futures.push_back(service.Submit("a + b * 2", {1, 2}));
+				futures.push_back(service.Submit("a+b*2", {3, 4}));
+				futures.push_back(service.Submit("a + b * 2", {5, 6}));
+				futures.push_back(service.Submit("1 / a", {0}));
+				futures.push_back(service.Submit("a + b * 2", {7}));
+				futures.push_back(service.Submit("(1 + 2", {}));
+				futures.push_back(service.Submit("5+6*6"));
+				futures.push_back(service.Submit("1 / a", {4}));
+
+				Assert::AreEqual(futures[0].get(), 6);
+				Assert::AreEqual(futures[1].get(), 14);
+				Assert::AreEqual(futures[2].get(), 22);
+				Assert::ExpectException<ExpressionParserErrors::DivideByZeroException>([&futures] { futures[3].get(); });
+				Assert::ExpectException<ExpressionParserErrors::UnboundVariableException>([&futures] { futures[4].get(); });
+				Assert::ExpectException<ExpressionParserErrors::ParenthesesMismatchException>([&futures] { futures[5].get(); });
+				Assert::AreEqual(futures[6].get(), 66);
+				Assert::AreEqual(futures[7].get(), 0);
+
+				EvaluationService::Statistics statistics = service.getStatistics();
+				Assert::AreEqual(statistics.requests, size_t(8));
+				Assert::AreEqual(statistics.batches, size_t(2));
+				Assert::AreEqual(statistics.jobs, size_t(5));
+
+				/* "a+b*2" shares the cache entry of "a + b * 2" */
+				Assert::AreEqual(service.getCacheStatistics().misses, size_t(4));
+
+				/* A request waiting on an unfilled batch is completed when the service is destroyed */
+				service.Submit("x - 1", {10}, [&callback_value](const Result<int> &result) { callback_value = result.getValue(); });
+				service.Submit("x $ 1", {10}, [&callback_error](const Result<int> &result) { callback_error = result.getError().kind; });
+			}
+			Assert::AreEqual(callback_value, 9);
+			Assert::IsTrue(callback_error == ExpressionParserErrors::ErrorKind::InvalidToken);
+		}
+
+		TEST_METHOD(EvaluationServiceSurvivesThrowingCallback)
+		{
+			EvaluationService::Options options;
+			options.batch_size = 3;
+			options.max_latency = std::chrono::seconds(30);
+			EvaluationService service(options);
+			service.Submit("1 + 1", {}, [](const Result<int> &) { throw std::runtime_error("callback failed"); });
+			std::future<int> same_batch = service.Submit("2 * 3");
+			std::future<int> also_same_batch = service.Submit("a - 1", {5});
+			Assert::AreEqual(same_batch.get(), 6);
+			Assert::AreEqual(also_same_batch.get(), 4);
+
+			/* The dispatcher is still running and fills the next batch */
+			std::future<int> next_batch = service.Submit("7");
+			service.Submit("8");
+			service.Submit("9");
+			Assert::AreEqual(next_batch.get(), 7);
+		}
+
+	private:
+		/* Reads back everything written to a temporary file */
+		static std::string readFile(std::FILE *file)
+		{
+			std::string contents;
+			std::rewind(file);
+			char buffer[4096];
+			for (size_t read = std::fread(buffer, 1, sizeof(buffer), file); read != 0; read = std::fread(buffer, 1, sizeof(buffer), file))
+			{
+				contents.append(buffer, read);
+			}
+
+			return contents;
+		}
 	};
 }